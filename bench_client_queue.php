@@ -0,0 +1,79 @@
+<?php
+
+function usage($e = null) {
+	global $argv;
+	if ($e) {
+		fprintf(STDERR, "ERROR: %s\n\n", $e);
+	}
+	fprintf(STDERR, "Usage: %s -u <URL> -n <requests,...> [-s (skip transfers, only enqueue/dequeue)]\n", $argv[0]);
+	fprintf(STDERR, "\nDefaults: -u http://localhost/ -n 100,1000,5000\n\n");
+	exit(-1);
+}
+
+function queue($url, $n) {
+	$client = new http\Client;
+	$requests = array();
+	for ($i = 0; $i < $n; ++$i) {
+		$requests[] = new http\Client\Request("GET", $url);
+	}
+	return array($client, $requests);
+}
+
+function bench_queue($url, $n) {
+	list($client, $requests) = queue($url, $n);
+
+	$time = microtime(true);
+	foreach ($requests as $request) {
+		$client->enqueue($request);
+	}
+	$enqueue = microtime(true) - $time;
+
+	$time = microtime(true);
+	foreach (array_reverse($requests) as $request) {
+		$client->dequeue($request);
+	}
+	$dequeue = microtime(true) - $time;
+
+	return array($enqueue, $dequeue);
+}
+
+function bench_complete($url, $n) {
+	list($client, $requests) = queue($url, $n);
+
+	$count = 0;
+	foreach ($requests as $request) {
+		$client->enqueue($request, function($response) use (&$count) {
+			++$count;
+		});
+	}
+
+	$time = microtime(true);
+	try {
+		$client->send();
+	} catch (Exception $e) {
+		fprintf(STDERR, "%s\n", $e->getMessage());
+	}
+	$send = microtime(true) - $time;
+
+	$count == $n or fprintf(STDERR, "Only %d of %d finished\n", $count, $n);
+
+	return $send;
+}
+
+isset($argv) or $argv = $_SERVER['argv'];
+defined('STDERR') or define('STDERR', fopen('php://stderr', 'w'));
+
+$opts = getopt("u:n:sh");
+isset($opts["h"]) and usage();
+isset($opts["u"]) or $opts["u"] = "http://localhost/";
+isset($opts["n"]) or $opts["n"] = "100,1000,5000";
+
+printf("%8s %14s %14s %14s\n", "queued", "enqueue/req", "dequeue/req", "send/req");
+
+foreach (array_map("intval", explode(",", $opts["n"])) as $n) {
+	list($enqueue, $dequeue) = bench_queue($opts["u"], $n);
+	$send = isset($opts["s"]) ? 0 : bench_complete($opts["u"], $n);
+
+	printf("%8d %12.3fus %12.3fus %12.3fus\n", $n,
+		$enqueue / $n * 1e6, $dequeue / $n * 1e6, $send / $n * 1e6);
+}
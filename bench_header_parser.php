@@ -0,0 +1,66 @@
+<?php
+
+function usage($e = null) {
+	global $argv;
+	if ($e) {
+		fprintf(STDERR, "ERROR: %s\n\n", $e);
+	}
+	fprintf(STDERR, "Usage: %s -s <sizes in KB,...> -n <iterations> [-c <chunk size>]\n", $argv[0]);
+	fprintf(STDERR, "\nDefaults: -s 4,8,16,32 -n 1000 -c 0 (whole block at once)\n\n");
+	exit(-1);
+}
+
+/* a response header block of roughly $size bytes, dominated by Set-Cookie and CSP like real ones */
+function headers($size) {
+	$lines = array(
+		"HTTP/1.1 200 OK",
+		"Date: " . gmdate("D, d M Y H:i:s") . " GMT",
+		"Server: bench",
+		"Content-Type: text/html; charset=utf-8",
+		"Cache-Control: private, no-cache, no-store, must-revalidate",
+		"Content-Security-Policy: default-src 'self'; script-src 'self' " . implode(" ", array_map(function($i) {
+			return "https://cdn$i.example.com";
+		}, range(1, 20))) . "; style-src 'self' 'unsafe-inline'",
+	);
+	$block = implode("\r\n", $lines);
+	for ($i = 0; strlen($block) < $size - 4; ++$i) {
+		$block .= sprintf("\r\nSet-Cookie: session_%d=%s; Path=/; Domain=.example.com; Expires=%s; Secure; HttpOnly",
+			$i, str_repeat(md5($i), 4), gmdate("D, d-M-Y H:i:s T", 1e9));
+	}
+	return $block . "\r\n\r\n";
+}
+
+function bench($block, $n, $chunk) {
+	$time = microtime(true);
+	for ($i = 0; $i < $n; ++$i) {
+		$parser = new http\Header\Parser;
+		$headers = array();
+		if ($chunk) {
+			foreach (str_split($block, $chunk) as $part) {
+				$parser->parse($part, 0, $headers);
+			}
+		} else {
+			$parser->parse($block, http\Header\Parser::CLEANUP, $headers);
+		}
+	}
+	return (microtime(true) - $time) / $n;
+}
+
+isset($argv) or $argv = $_SERVER['argv'];
+defined('STDERR') or define('STDERR', fopen('php://stderr', 'w'));
+
+$opts = getopt("s:n:c:h");
+isset($opts["h"]) and usage();
+isset($opts["s"]) or $opts["s"] = "4,8,16,32";
+isset($opts["n"]) or $opts["n"] = 1000;
+isset($opts["c"]) or $opts["c"] = 0;
+
+printf("%8s %8s %14s %12s\n", "size", "headers", "parse", "MB/s");
+
+foreach (array_map("intval", explode(",", $opts["s"])) as $kb) {
+	$block = headers($kb * 1024);
+	$time = bench($block, (int) $opts["n"], (int) $opts["c"]);
+
+	printf("%7dK %8d %12.3fus %12.2f\n", $kb, substr_count($block, "\r\n") - 2,
+		$time * 1e6, strlen($block) / $time / 1024 / 1024);
+}
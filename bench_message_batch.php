@@ -0,0 +1,57 @@
+<?php
+
+function usage($e = null) {
+	global $argv;
+	if ($e) {
+		fprintf(STDERR, "ERROR: %s\n\n", $e);
+	}
+	fprintf(STDERR, "Usage: %s -n <messages,...> [-b <body size>]\n", $argv[0]);
+	fprintf(STDERR, "\nDefaults: -n 100,1000,10000 -b 64\n\n");
+	exit(-1);
+}
+
+function stream_of($n, $b) {
+	$body = str_repeat("x", $b);
+	$data = "";
+	for ($i = 0; $i < $n; ++$i) {
+		$data .= "POST /$i HTTP/1.1\r\nHost: localhost\r\nUser-Agent: bench\r\nContent-Length: $b\r\n\r\n$body";
+	}
+	return $data;
+}
+
+function bench_chain($data) {
+	$time = microtime(true);
+	$message = new http\Message($data, true);
+	$count = 0;
+	foreach ($message->reverse() as $m) {
+		++$count;
+	}
+	return array(microtime(true) - $time, $count);
+}
+
+function bench_batch($data) {
+	$time = microtime(true);
+	$count = count(http\Message\Parser::parseAll($data));
+	return array(microtime(true) - $time, $count);
+}
+
+isset($argv) or $argv = $_SERVER['argv'];
+defined('STDERR') or define('STDERR', fopen('php://stderr', 'w'));
+
+$opts = getopt("n:b:h");
+isset($opts["h"]) and usage();
+isset($opts["n"]) or $opts["n"] = "100,1000,10000";
+isset($opts["b"]) or $opts["b"] = 64;
+
+printf("%8s %14s %14s\n", "messages", "chain/msg", "batch/msg");
+
+foreach (array_map("intval", explode(",", $opts["n"])) as $n) {
+	$data = stream_of($n, (int) $opts["b"]);
+	list($chain, $c1) = bench_chain($data);
+	list($batch, $c2) = bench_batch($data);
+
+	$c1 == $n or fprintf(STDERR, "chain: only %d of %d parsed\n", $c1, $n);
+	$c2 == $n or fprintf(STDERR, "batch: only %d of %d parsed\n", $c2, $n);
+
+	printf("%8d %12.3fus %12.3fus\n", $n, $chain / $n * 1e6, $batch / $n * 1e6);
+}
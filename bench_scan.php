@@ -0,0 +1,95 @@
+<?php
+
+function usage($e = null) {
+	global $argv;
+	if ($e) {
+		fprintf(STDERR, "ERROR: %s\n\n", $e);
+	}
+	fprintf(STDERR, "Usage: %s -n <iterations> [-i <scalar,sse2,avx2>]\n", $argv[0]);
+	fprintf(STDERR, "\nDefaults: -n 2000 -i scalar,sse2,avx2\n");
+	fprintf(STDERR, "\nRuns each scanner implementation in its own process (PHP_HTTP_SCAN).\n\n");
+	exit(-1);
+}
+
+function scanner() {
+	ob_start();
+	phpinfo(INFO_MODULES);
+	return preg_match("/^Scanner => (\w+)/m", ob_get_clean(), $match) ? $match[1] : "unknown";
+}
+
+function headers() {
+	$block = "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\n";
+	for ($i = 0; strlen($block) < 16384; ++$i) {
+		$block .= "Set-Cookie: cookie_$i=" . str_repeat(md5($i), 3) . "; Path=/; Secure; HttpOnly\r\n";
+	}
+	return $block . "\r\n";
+}
+
+function chunked() {
+	$data = "";
+	for ($i = 0; $i < 256; ++$i) {
+		$chunk = str_repeat(chr(ord("a") + $i % 26), 64 + $i);
+		$data .= sprintf("%x\r\n%s\r\n", strlen($chunk), $chunk);
+	}
+	return $data . "0\r\n\r\n";
+}
+
+function multipart() {
+	$body = new http\Message\Body;
+	for ($i = 0; $i < 64; ++$i) {
+		$body->addPart(new http\Message("Content-Type: text/plain\r\nX-Part: $i\r\n\r\n" . str_repeat("line of text\r\n", 32)));
+	}
+	return new http\Message("Content-Type: multipart/mixed; boundary=\"" . $body->getBoundary() . "\"\r\n\r\n" . $body);
+}
+
+function bench($name, $n, $func) {
+	$time = microtime(true);
+	for ($i = 0; $i < $n; ++$i) {
+		$func();
+	}
+	printf(" %12.3fus", (microtime(true) - $time) / $n * 1e6);
+}
+
+function worker($n) {
+	$headers = headers();
+	$chunked = chunked();
+	$multipart = multipart();
+
+	printf("%-8s", scanner());
+	bench("headers", $n, function() use ($headers) {
+		$parser = new http\Header\Parser;
+		$parser->parse($headers, http\Header\Parser::CLEANUP, $result);
+	});
+	bench("dechunk", $n, function() use ($chunked) {
+		http\Encoding\Stream\Dechunk::decode($chunked);
+	});
+	bench("dechunk stream", $n, function() use ($chunked) {
+		$stream = new http\Encoding\Stream\Dechunk;
+		foreach (str_split($chunked, 4096) as $part) {
+			$stream->update($part);
+		}
+		$stream->finish();
+	});
+	bench("multipart", $n, function() use ($multipart) {
+		$multipart->splitMultipartBody();
+	});
+	printf("\n");
+}
+
+isset($argv) or $argv = $_SERVER['argv'];
+defined('STDERR') or define('STDERR', fopen('php://stderr', 'w'));
+
+$opts = getopt("n:i:wh");
+isset($opts["h"]) and usage();
+isset($opts["n"]) or $opts["n"] = 2000;
+isset($opts["i"]) or $opts["i"] = "scalar,sse2,avx2";
+
+if (isset($opts["w"])) {
+	worker((int) $opts["n"]);
+	exit;
+}
+
+printf("%-8s %14s %14s %14s %14s\n", "scanner", "headers 16K", "dechunk 24K", "dechunk strm", "multipart");
+foreach (explode(",", $opts["i"]) as $impl) {
+	passthru(sprintf("PHP_HTTP_SCAN=%s %s %s -w -n %d", escapeshellarg($impl), escapeshellarg(PHP_BINARY), escapeshellarg($argv[0]), $opts["n"]));
+}
@@ -12,6 +12,10 @@ PHP_ARG_WITH([http-libevent-dir], [],
 [  --with-http-libevent-dir[=DIR] HTTP: where to find libevent], $PHP_HTTP_LIBCURL_DIR, "")
 PHP_ARG_WITH([http-libidn-dir], [],
 [  --with-http-libidn-dir[=DIR]   HTTP: where to find libidn], $PHP_HTTP_LIBCURL_DIR, "")
+PHP_ARG_WITH([http-libbrotli-dir], [],
+[  --with-http-libbrotli-dir[=DIR] HTTP: where to find libbrotli], $PHP_HTTP, "")
+PHP_ARG_WITH([http-libzstd-dir], [],
+[  --with-http-libzstd-dir[=DIR]  HTTP: where to find libzstd], $PHP_HTTP, "")
 
 if test "$PHP_HTTP" != "no"; then
 
@@ -136,6 +140,28 @@ dnl ----
 	PHP_CHECK_FUNC(iswalnum)
 	PHP_CHECK_FUNC(inet_pton)
 
+dnl ----
+dnl SIMD
+dnl ----
+	AC_MSG_CHECKING([for AVX2 support with runtime detection])
+	AC_TRY_COMPILE([
+		#include <immintrin.h>
+		__attribute__((target("avx2"))) static int test(const char *p) {
+			__m256i v = _mm256_loadu_si256((const __m256i *) p);
+			return _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+		}
+	], [
+		char buf[32] = {0};
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") ? test(buf) : __builtin_ctz(1);
+	], [
+		AC_MSG_RESULT([yes])
+		AC_DEFINE([PHP_HTTP_HAVE_AVX2], [1], [Have AVX2 intrinsics and runtime CPU detection])
+	], [
+		AC_MSG_RESULT([no])
+		AC_DEFINE([PHP_HTTP_HAVE_AVX2], [0], [ ])
+	])
+
 dnl ----
 dnl IDN
 dnl ----
@@ -480,6 +506,106 @@ dnl ----
 		fi
 	fi
 
+dnl ----
+dnl BROTLI
+dnl ----
+
+	if test "$PHP_HTTP_LIBBROTLI_DIR" = "no"; then
+		AC_DEFINE([PHP_HTTP_HAVE_BROTLI], [0], [ ])
+	else
+		AC_MSG_CHECKING([for brotli/encode.h])
+		BROTLI_DIR=
+		for i in "$PHP_HTTP_LIBBROTLI_DIR" /usr/local /usr /opt; do
+			if test -f "$i/include/brotli/encode.h" && test -f "$i/include/brotli/decode.h"; then
+				BROTLI_DIR=$i
+				break
+			fi
+		done
+		if test "x$BROTLI_DIR" = "x"; then
+			AC_MSG_RESULT([not found])
+			AC_MSG_WARN([continuing without brotli support])
+			AC_DEFINE([PHP_HTTP_HAVE_BROTLI], [0], [ ])
+		else
+			AC_MSG_RESULT([found in $BROTLI_DIR])
+			
+			PHP_ADD_INCLUDE($BROTLI_DIR/include)
+			PHP_ADD_LIBRARY_WITH_PATH(brotlienc, $BROTLI_DIR/$PHP_LIBDIR, HTTP_SHARED_LIBADD)
+			PHP_ADD_LIBRARY_WITH_PATH(brotlidec, $BROTLI_DIR/$PHP_LIBDIR, HTTP_SHARED_LIBADD)
+			AC_DEFINE([PHP_HTTP_HAVE_BROTLI], [1], [Have brotli support])
+		fi
+	fi
+
+dnl ----
+dnl ZSTD
+dnl ----
+
+	if test "$PHP_HTTP_LIBZSTD_DIR" = "no"; then
+		AC_DEFINE([PHP_HTTP_HAVE_ZSTD], [0], [ ])
+	else
+		AC_MSG_CHECKING([for zstd.h])
+		ZSTD_DIR=
+		for i in "$PHP_HTTP_LIBZSTD_DIR" /usr/local /usr /opt; do
+			if test -f "$i/include/zstd.h"; then
+				ZSTD_DIR=$i
+				break
+			fi
+		done
+		if test "x$ZSTD_DIR" = "x"; then
+			AC_MSG_RESULT([not found])
+			AC_MSG_WARN([continuing without zstd support])
+			AC_DEFINE([PHP_HTTP_HAVE_ZSTD], [0], [ ])
+		else
+			AC_MSG_RESULT([found in $ZSTD_DIR])
+			
+			AC_MSG_CHECKING([for zstd version >= 1.4.0])
+			ZSTD_VER="`$AWK '/^#define ZSTD_VERSION_(MAJOR|MINOR|RELEASE)/ {printf(\"%s%s\", s, $3); s=\".\"}' < $ZSTD_DIR/include/zstd.h`"
+			AC_MSG_RESULT([$ZSTD_VER])
+			
+			if test `echo $ZSTD_VER | $AWK -F. '{printf("%d", $1 * 10000 + $2 * 100 + $3)}'` -lt 10400; then
+				AC_MSG_WARN([continuing without zstd support])
+				AC_DEFINE([PHP_HTTP_HAVE_ZSTD], [0], [ ])
+			else
+				PHP_ADD_INCLUDE($ZSTD_DIR/include)
+				PHP_ADD_LIBRARY_WITH_PATH(zstd, $ZSTD_DIR/$PHP_LIBDIR, HTTP_SHARED_LIBADD)
+				AC_DEFINE([PHP_HTTP_HAVE_ZSTD], [1], [Have zstd support])
+			fi
+		fi
+	fi
+
+dnl ----
+dnl EPOLL
+dnl ----
+
+	AC_MSG_CHECKING([for epoll support])
+	AC_TRY_COMPILE([
+		#include <sys/epoll.h>
+	], [
+		struct epoll_event ev;
+		int fd = epoll_create1(EPOLL_CLOEXEC);
+		return epoll_ctl(fd, EPOLL_CTL_ADD, 0, &ev) || epoll_wait(fd, &ev, 1, 0);
+	], [
+		AC_MSG_RESULT([yes])
+		AC_DEFINE([PHP_HTTP_HAVE_EPOLL], [1], [Have epoll support for cURL])
+	], [
+		AC_MSG_RESULT([no])
+		AC_DEFINE([PHP_HTTP_HAVE_EPOLL], [0], [ ])
+	])
+
+dnl ----
+dnl PTHREAD
+dnl ----
+
+	AC_CHECK_HEADER([pthread.h], [
+		AC_CHECK_LIB([pthread], [pthread_create], [
+			PHP_ADD_LIBRARY(pthread, 1, HTTP_SHARED_LIBADD)
+			AC_DEFINE([PHP_HTTP_HAVE_PTHREAD], [1], [Have pthread support for parallel deflate])
+		], [
+			AC_DEFINE([PHP_HTTP_HAVE_PTHREAD], [0], [ ])
+		])
+	], [
+		AC_DEFINE([PHP_HTTP_HAVE_PTHREAD], [0], [ ])
+	])
+
 dnl ----
 dnl RAPHF
 dnl ----
@@ -583,6 +709,9 @@ dnl ----
 		php_http_cookie.c \
 		php_http_curl.c \
 		php_http_encoding.c \
+		php_http_encoding_brotli.c \
+		php_http_encoding_parallel.c \
+		php_http_encoding_zstd.c \
 		php_http_env.c \
 		php_http_env_request.c \
 		php_http_env_response.c \
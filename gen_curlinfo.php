@@ -50,36 +50,8 @@ $translate = array(
 	'COOKIELIST' => 'cookies',
 );
 
-$templates = array(
-'STRING' => 
-'	if (CURLE_OK == curl_easy_getinfo(ch, %s, &c)) {
-		add_assoc_string_ex(&array, "%s", sizeof("%2$s"), c ? c : "", 1);
-	}
-',
-'DOUBLE' => 
-'	if (CURLE_OK == curl_easy_getinfo(ch, %s, &d)) {
-		add_assoc_double_ex(&array, "%s", sizeof("%2$s"), d);
-	}
-',
-'LONG' => 
-'	if (CURLE_OK == curl_easy_getinfo(ch, %s, &l)) {
-		add_assoc_long_ex(&array, "%s", sizeof("%2$s"), l);
-	}
-',
-'SLIST' =>
-'	if (CURLE_OK == curl_easy_getinfo(ch, %s, &s)) {
-		MAKE_STD_ZVAL(subarray);
-		array_init(subarray);
-		for (p = s; p; p = p->next) {
-			if (p->data) {
-				add_next_index_string(subarray, p->data, 1);
-			}
-		}
-		add_assoc_zval_ex(&array, "%s", sizeof("%2$s"), subarray);
-		curl_slist_free_all(s);
-	}
-',
-);
+$template = '	{ZEND_STRS("%2$s"), %1$s},
+';
 
 $infos = file_re('curl.h', '/^\s*(CURLINFO_(\w+))\s*=\s*CURLINFO_(STRING|LONG|DOUBLE|SLIST)\s*\+\s*\d+\s*,?\s*$/m');
 
@@ -88,12 +60,12 @@ foreach ($infos as $info) {
 	list(, $full, $short, $type) = $info;
 	if (in_array($short, $exclude)) continue;
 	if (isset($ifdefs[$short])) printf("#if %s\n", $ifdefs[$short]);
-	printf($templates[$type], $full, strtolower((isset($translate[$short])) ? $translate[$short] : $short));
+	printf($template, $full, strtolower((isset($translate[$short])) ? $translate[$short] : $short));
 	if (isset($ifdefs[$short])) printf("#endif\n");
 }
 
 file_put_contents("php_http_client_curl.c", 
-	preg_replace('/(\/\* BEGIN::CURLINFO \*\/\n).*(\n\s*\/\* END::CURLINFO \*\/)/s', '$1'. ob_get_contents() .'$2',
+	preg_replace('/(\/\* BEGIN::CURLINFO \*\/\n).*(\n?\t\/\* END::CURLINFO \*\/)/s', '$1'. ob_get_contents() .'$2',
 		file_get_contents("php_http_client_curl.c")));
 
 ?>
@@ -33,6 +33,12 @@
 #elif PHP_HTTP_HAVE_IDN
 #	include <idna.h>
 #endif
+#if PHP_HTTP_HAVE_BROTLI
+#	include <brotli/encode.h>
+#endif
+#if PHP_HTTP_HAVE_ZSTD
+#	include <zstd.h>
+#endif
 
 ZEND_DECLARE_MODULE_GLOBALS(php_http);
 
@@ -105,6 +111,15 @@ static void php_http_globals_init_once(zend_php_http_globals *G)
 	memset(G, 0, sizeof(*G));
 }
 
+#ifdef ZTS
+/* every thread has its own globals, which MSHUTDOWN cannot reach */
+static void php_http_globals_dtor(zend_php_http_globals *G)
+{
+	php_http_env_response_cache_dtor(&G->env);
+	php_http_encoding_pool_dtor(&G->encoding);
+}
+#endif
+
 #if 0
 static inline void php_http_globals_init(zend_php_http_globals *G TSRMLS_DC)
 {
@@ -125,13 +140,21 @@ zend_php_http_globals *php_http_globals(void)
 
 PHP_INI_BEGIN()
 	STD_PHP_INI_ENTRY("http.etag.mode", "crc32b", PHP_INI_ALL, OnUpdateString, env.etag_mode, zend_php_http_globals, php_http_globals)
+	/* encoded bodies up to this size are kept per process, keyed on a SHA-1 digest
+	 * of the unencoded body, its size, the content encoding and the encoder flags */
+	STD_PHP_INI_ENTRY("http.encoding.cache_size", "0", PHP_INI_SYSTEM, OnUpdateLong, env.encoding_cache.size, zend_php_http_globals, php_http_globals)
+	STD_PHP_INI_ENTRY("http.encoding.deflate_threads", "1", PHP_INI_SYSTEM, OnUpdateLong, encoding.deflate_threads, zend_php_http_globals, php_http_globals)
+	STD_PHP_INI_ENTRY("http.parser.header_bytes", "0", PHP_INI_ALL, OnUpdateLong, parser.header_bytes, zend_php_http_globals, php_http_globals)
+	STD_PHP_INI_ENTRY("http.parser.header_count", "0", PHP_INI_ALL, OnUpdateLong, parser.header_count, zend_php_http_globals, php_http_globals)
+	STD_PHP_INI_ENTRY("http.parser.body_size", "0", PHP_INI_ALL, OnUpdateLong, parser.body_size, zend_php_http_globals, php_http_globals)
 PHP_INI_END()
 
 PHP_MINIT_FUNCTION(http)
 {
 	http_module_number = module_number;
-	ZEND_INIT_MODULE_GLOBALS(php_http, php_http_globals_init_once, NULL);
+	ZEND_INIT_MODULE_GLOBALS(php_http, php_http_globals_init_once, php_http_globals_dtor);
 	REGISTER_INI_ENTRIES();
+	php_http_scan_init();
 	
 	if (0
 	|| SUCCESS != PHP_MINIT_CALL(http_exception)
@@ -170,12 +193,15 @@ PHP_MSHUTDOWN_FUNCTION(http)
 	UNREGISTER_INI_ENTRIES();
 	
 	if (0
+	|| SUCCESS != PHP_MSHUTDOWN_CALL(http_header)
 	|| SUCCESS != PHP_MSHUTDOWN_CALL(http_message)
 #if PHP_HTTP_HAVE_CURL
 	|| SUCCESS != PHP_MSHUTDOWN_CALL(http_client_curl)
 	|| SUCCESS != PHP_MSHUTDOWN_CALL(http_curl)
 #endif
 	|| SUCCESS != PHP_MSHUTDOWN_CALL(http_client)
+	|| SUCCESS != PHP_MSHUTDOWN_CALL(http_encoding)
+	|| SUCCESS != PHP_MSHUTDOWN_CALL(http_env_response)
 	) {
 		return FAILURE;
 	}
@@ -203,6 +229,7 @@ PHP_MINFO_FUNCTION(http)
 	php_info_print_table_start();
 	php_info_print_table_header(2, "HTTP Support", "enabled");
 	php_info_print_table_row(2, "Extension Version", PHP_PECL_HTTP_VERSION);
+	php_info_print_table_row(2, "Scanner", php_http_scan_impl());
 	php_info_print_table_end();
 	
 	php_info_print_table_start();
@@ -235,7 +262,23 @@ PHP_MINFO_FUNCTION(http)
 	php_info_print_table_row(3, "libidn (IDNA2003)", PHP_HTTP_LIBIDN_VERSION, "unknown");
 #endif
 
+#if PHP_HTTP_HAVE_BROTLI
+	{
+		uint32_t bv = BrotliEncoderVersion();
+
+		php_http_buffer_appendf(&buf, "%u.%u.%u", bv >> 24, (bv >> 12) & 0xfff, bv & 0xfff);
+		php_http_buffer_fix(&buf);
+		php_info_print_table_row(3, "libbrotli", "unknown", buf.data);
+		php_http_buffer_reset(&buf);
+	}
+#endif
+
+#if PHP_HTTP_HAVE_ZSTD
+	php_info_print_table_row(3, "libzstd", ZSTD_VERSION_STRING, ZSTD_versionString());
+#endif
+
 	php_info_print_table_end();
+	php_http_buffer_dtor(&buf);
 	
 	DISPLAY_INI_ENTRIES();
 }
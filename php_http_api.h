@@ -106,6 +106,8 @@
 
 ZEND_BEGIN_MODULE_GLOBALS(php_http)
 	struct php_http_env_globals env;
+	struct php_http_encoding_globals encoding;
+	struct php_http_message_parser_globals parser;
 ZEND_END_MODULE_GLOBALS(php_http)
 
 ZEND_EXTERN_MODULE_GLOBALS(php_http);
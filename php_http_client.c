@@ -174,11 +174,17 @@ php_http_client_t *php_http_client_init(php_http_client_t *h, php_http_client_op
 	}
 	zend_llist_init(&h->requests, sizeof(php_http_client_enqueue_t), queue_dtor, 0);
 	zend_llist_init(&h->responses, sizeof(void *), NULL, 0);
+	zend_hash_init(&h->index.requests, 0, NULL, NULL, 0);
+	zend_hash_init(&h->index.handles, 0, NULL, NULL, 0);
 	TSRMLS_SET_CTX(h->ts);
 
 	if (h->ops->init) {
+		php_http_client_t *init_h = h;
+
 		if (!(h = h->ops->init(h, init_arg))) {
 			php_error_docref(NULL TSRMLS_CC, E_WARNING, "Could not initialize client");
+			zend_hash_destroy(&init_h->index.requests);
+			zend_hash_destroy(&init_h->index.handles);
 			if (free_h) {
 				efree(free_h);
 			}
@@ -206,6 +212,9 @@ void php_http_client_dtor(php_http_client_t *h)
 	}
 
 	php_resource_factory_free(&h->rf);
+
+	zend_hash_destroy(&h->index.requests);
+	zend_hash_destroy(&h->index.handles);
 }
 
 void php_http_client_free(php_http_client_t **h) {
@@ -247,6 +256,16 @@ ZEND_RESULT_CODE php_http_client_dequeue(php_http_client_t *h, php_http_message_
 	return FAILURE;
 }
 
+static inline zend_llist_element *php_http_client_index_find(HashTable *index, void *ptr)
+{
+	zend_llist_element **el;
+
+	if (ptr && SUCCESS == zend_hash_index_find(index, (ulong) ptr, (void *) &el)) {
+		return *el;
+	}
+	return NULL;
+}
+
 php_http_client_enqueue_t *php_http_client_enqueued(php_http_client_t *h, void *compare_arg, php_http_client_enqueue_cmp_func_t compare_func)
 {
 	zend_llist_element *el = NULL;
@@ -258,15 +277,70 @@ php_http_client_enqueue_t *php_http_client_enqueued(php_http_client_t *h, void *
 			}
 		}
 	} else {
-		for (el = h->requests.head; el; el = el->next) {
-			if (((php_http_client_enqueue_t *) el->data)->request == compare_arg) {
-				break;
-			}
-		}
+		el = php_http_client_index_find(&h->index.requests, compare_arg);
 	}
 	return el ? (php_http_client_enqueue_t *) el->data : NULL;
 }
 
+php_http_client_enqueue_t *php_http_client_enqueued_handle(php_http_client_t *h, void *handle)
+{
+	zend_llist_element *el = php_http_client_index_find(&h->index.handles, handle);
+
+	return el ? (php_http_client_enqueue_t *) el->data : NULL;
+}
+
+php_http_client_enqueue_t *php_http_client_enqueued_add(php_http_client_t *h, php_http_client_enqueue_t *enqueue, void *handle)
+{
+	zend_llist_element *el;
+	php_http_message_t *request = enqueue->request;
+
+	zend_llist_add_element(&h->requests, enqueue);
+	el = h->requests.tail;
+
+	zend_hash_index_update(&h->index.requests, (ulong) request, &el, sizeof(el), NULL);
+	if (handle) {
+		zend_hash_index_update(&h->index.handles, (ulong) handle, &el, sizeof(el), NULL);
+	}
+
+	return (php_http_client_enqueue_t *) el->data;
+}
+
+void php_http_client_enqueued_del(php_http_client_t *h, php_http_client_enqueue_t *enqueue, void *handle)
+{
+	zend_llist_element *el;
+	php_http_message_t *request = enqueue->request;
+
+	if (!(el = php_http_client_index_find(&h->index.requests, request))) {
+		return;
+	}
+
+	zend_hash_index_del(&h->index.requests, (ulong) request);
+	if (handle) {
+		zend_hash_index_del(&h->index.handles, (ulong) handle);
+	}
+
+	/* unlink without walking the list, like zend_llist_del_element() would */
+	if (el->prev) {
+		el->prev->next = el->next;
+	} else {
+		h->requests.head = el->next;
+	}
+	if (el->next) {
+		el->next->prev = el->prev;
+	} else {
+		h->requests.tail = el->prev;
+	}
+	if (h->requests.traverse_ptr == el) {
+		h->requests.traverse_ptr = NULL;
+	}
+	--h->requests.count;
+
+	if (h->requests.dtor) {
+		h->requests.dtor(el->data);
+	}
+	pefree(el, h->requests.persistent);
+}
+
 ZEND_RESULT_CODE php_http_client_wait(php_http_client_t *h, struct timeval *custom_timeout)
 {
 	if (h->ops->wait) {
@@ -302,6 +376,8 @@ void php_http_client_reset(php_http_client_t *h)
 
 	zend_llist_clean(&h->requests);
 	zend_llist_clean(&h->responses);
+	zend_hash_clean(&h->index.requests);
+	zend_hash_clean(&h->index.handles);
 }
 
 ZEND_RESULT_CODE php_http_client_setopt(php_http_client_t *h, php_http_client_setopt_opt_t opt, void *arg)
@@ -324,11 +400,27 @@ ZEND_RESULT_CODE php_http_client_getopt(php_http_client_t *h, php_http_client_ge
 zend_class_entry *php_http_client_class_entry;
 static zend_object_handlers php_http_client_object_handlers;
 
+static zend_bool feed_running(struct php_http_client_feed *feed, php_http_message_t *request);
+static void feed_finished(struct php_http_client_feed *feed, php_http_message_t *request);
+static void feed_fill(zval *zclient, php_http_client_object_t *obj TSRMLS_DC);
+static void feed_free(struct php_http_client_feed **feed TSRMLS_DC);
+
 void php_http_client_object_free(void *object TSRMLS_DC)
 {
 	php_http_client_object_t *o = (php_http_client_object_t *) object;
 
 	php_http_client_free(&o->client);
+	feed_free(&o->feed TSRMLS_CC);
+	if (o->progress) {
+		zval_ptr_dtor(&o->progress);
+	}
+	if (o->debug.fci.size) {
+		zend_fcall_info_args_clear(&o->debug.fci, 1);
+		zval_ptr_dtor(&o->debug.fci.function_name);
+		if (o->debug.fci.object_ptr) {
+			zval_ptr_dtor(&o->debug.fci.object_ptr);
+		}
+	}
 	php_http_object_method_dtor(&o->notify);
 	php_http_object_method_free(&o->update);
 	zend_object_std_dtor((zend_object *) o TSRMLS_CC);
@@ -379,19 +471,23 @@ static void handle_history(zval *zclient, php_http_message_t *request, php_http_
 
 static ZEND_RESULT_CODE handle_response(void *arg, php_http_client_t *client, php_http_client_enqueue_t *e, php_http_message_t **response)
 {
-	zend_bool dequeue = 0;
+	zend_bool dequeue = 0, fed;
 	zval zclient;
-	php_http_message_t *msg;
+	php_http_message_t *msg, *request = e->request;
 	php_http_client_progress_state_t *progress;
+	php_http_client_object_t *client_obj = arg;
 	TSRMLS_FETCH_FROM_CTX(client->ts);
 
 	INIT_PZVAL(&zclient);
-	ZVAL_OBJVAL(&zclient, ((php_http_client_object_t*) arg)->zv, 0);
+	ZVAL_OBJVAL(&zclient, client_obj->zv, 0);
+
+	/* requests of a feed are only passed to its callback, and dequeued right away */
+	fed = client_obj->feed && feed_running(client_obj->feed, e->request);
 
 	if ((msg = *response)) {
 		php_http_message_object_t *msg_obj;
-		zval *info, *zresponse, *zrequest;
-		HashTable *info_ht;
+		php_http_client_response_object_t *response_obj;
+		zval *zresponse, *zrequest;
 
 		/* ensure the message is of type response (could be uninitialized in case of early error, like DNS) */
 		php_http_message_set_type(msg, PHP_HTTP_RESPONSE);
@@ -405,22 +501,33 @@ static ZEND_RESULT_CODE handle_response(void *arg, php_http_client_t *client, ph
 		*response = NULL;
 
 		MAKE_STD_ZVAL(zresponse);
-		ZVAL_OBJVAL(zresponse, php_http_message_object_new_ex(php_http_client_response_class_entry, msg, &msg_obj TSRMLS_CC), 0);
+		ZVAL_OBJVAL(zresponse, php_http_client_response_object_new_ex(php_http_client_response_class_entry, msg, &response_obj TSRMLS_CC), 0);
+		msg_obj = &response_obj->message;
 
 		MAKE_STD_ZVAL(zrequest);
 		ZVAL_OBJVAL(zrequest, ((php_http_message_object_t *) e->opaque)->zv, 1);
 
 		php_http_message_object_prepend(zresponse, zrequest, 1 TSRMLS_CC);
 
-		MAKE_STD_ZVAL(info);
-		object_init(info);
-		info_ht = HASH_OF(info);
-		php_http_client_getopt(client, PHP_HTTP_CLIENT_OPT_TRANSFER_INFO, e->request, &info_ht);
-		zend_update_property(php_http_client_response_class_entry, zresponse, ZEND_STRL("transferInfo"), info TSRMLS_CC);
-		zval_ptr_dtor(&info);
+		/* the transferInfo object is only built when accessed */
+		if (SUCCESS != php_http_client_getopt(client, PHP_HTTP_CLIENT_OPT_TRANSFER_INFO_SNAPSHOT, e->request, &response_obj->info)) {
+			zval *info;
+			HashTable *info_ht;
 
-		zend_objects_store_add_ref_by_handle(msg_obj->zv.handle TSRMLS_CC);
-		zend_llist_add_element(&client->responses, &msg_obj);
+			response_obj->info = NULL;
+
+			MAKE_STD_ZVAL(info);
+			object_init(info);
+			info_ht = HASH_OF(info);
+			php_http_client_getopt(client, PHP_HTTP_CLIENT_OPT_TRANSFER_INFO, e->request, &info_ht);
+			zend_update_property(php_http_client_response_class_entry, zresponse, ZEND_STRL("transferInfo"), info TSRMLS_CC);
+			zval_ptr_dtor(&info);
+		}
+
+		if (!fed) {
+			zend_objects_store_add_ref_by_handle(msg_obj->zv.handle TSRMLS_CC);
+			zend_llist_add_element(&client->responses, &msg_obj);
+		}
 
 		if (e->closure.fci.size) {
 			zval *retval = NULL;
@@ -442,18 +549,37 @@ static ZEND_RESULT_CODE handle_response(void *arg, php_http_client_t *client, ph
 
 		zval_ptr_dtor(&zresponse);
 		zval_ptr_dtor(&zrequest);
+
+		/* the callback might have reset the client or dequeued the request */
+		if (e != php_http_client_enqueued(client, request, NULL)) {
+			if (fed && client_obj->feed) {
+				feed_finished(client_obj->feed, request);
+				feed_fill(&zclient, client_obj TSRMLS_CC);
+			}
+			return SUCCESS;
+		}
 	}
 
-	if (SUCCESS == php_http_client_getopt(client, PHP_HTTP_CLIENT_OPT_PROGRESS_INFO, e->request, &progress)) {
+	if (client->callback.progress.func && SUCCESS == php_http_client_getopt(client, PHP_HTTP_CLIENT_OPT_PROGRESS_INFO, e->request, &progress)) {
 		progress->info = "finished";
 		progress->finished = 1;
 		client->callback.progress.func(client->callback.progress.arg, client, e, progress);
 	}
 
+	/* the feed is gone, if the callback reset the client */
+	if (fed && client_obj->feed) {
+		feed_finished(client_obj->feed, e->request);
+		dequeue = 1;
+	}
+
 	if (dequeue) {
 		php_http_client_dequeue(client, e->request);
 	}
 
+	if (fed && client_obj->feed) {
+		feed_fill(&zclient, client_obj TSRMLS_CC);
+	}
+
 	return SUCCESS;
 }
 
@@ -471,8 +597,18 @@ static void handle_progress(void *arg, php_http_client_t *client, php_http_clien
 	ZVAL_OBJVAL(zrequest, ((php_http_message_object_t *) e->opaque)->zv, 1);
 	args[0] = &zrequest;
 
-	MAKE_STD_ZVAL(zprogress);
-	object_init(zprogress);
+	/* reuse the progress object, unless someone kept a reference to the zval or, through a copy, to the object */
+	if (client_obj->progress && Z_REFCOUNT_P(client_obj->progress) == 1 && zend_objects_store_get_refcount(client_obj->progress TSRMLS_CC) == 1) {
+		zprogress = client_obj->progress;
+	} else {
+		if (client_obj->progress) {
+			zval_ptr_dtor(&client_obj->progress);
+		}
+		MAKE_STD_ZVAL(zprogress);
+		object_init(zprogress);
+		client_obj->progress = zprogress;
+	}
+	Z_ADDREF_P(zprogress);
 	add_property_bool(zprogress, "started", progress->started);
 	add_property_bool(zprogress, "finished", progress->finished);
 	add_property_string(zprogress, "info", STR_PTR(progress->info), 1);
@@ -491,6 +627,66 @@ static void handle_progress(void *arg, php_http_client_t *client, php_http_clien
 	zval_ptr_dtor(&zprogress);
 }
 
+/* progress info is only gathered while someone listens: an observer, or an overridden notify() */
+static void handle_progress_observed(zval *zclient, php_http_client_object_t *obj TSRMLS_DC)
+{
+	zval *observers, *retval = NULL;
+	zend_bool observed = 0;
+
+	if (obj->notify.fcc.function_handler && obj->notify.fcc.function_handler->common.scope != php_http_client_class_entry) {
+		observed = 1;
+	} else {
+		observers = zend_read_property(php_http_client_class_entry, zclient, ZEND_STRL("observers"), 0 TSRMLS_CC);
+		if (Z_TYPE_P(observers) == IS_OBJECT) {
+			zend_call_method_with_0_params(&observers, NULL, NULL, "count", &retval);
+			if (retval) {
+				observed = zend_is_true(retval);
+				zval_ptr_dtor(&retval);
+			}
+		}
+	}
+
+	if (observed) {
+		obj->client->callback.progress.func = handle_progress;
+		obj->client->callback.progress.arg = obj;
+	} else {
+		obj->client->callback.progress.func = NULL;
+		obj->client->callback.progress.arg = NULL;
+	}
+}
+
+static void handle_debug(void *arg, php_http_client_t *client, php_http_client_enqueue_t *e, unsigned type, const char *data, size_t size)
+{
+	zval *zclient, *zrequest, *ztype, *zdata, *retval = NULL;
+	php_http_client_object_t *client_obj = arg;
+	zend_error_handling zeh;
+	TSRMLS_FETCH_FROM_CTX(client->ts);
+
+	MAKE_STD_ZVAL(zclient);
+	ZVAL_OBJVAL(zclient, client_obj->zv, 1);
+	MAKE_STD_ZVAL(zrequest);
+	ZVAL_OBJVAL(zrequest, ((php_http_message_object_t *) e->opaque)->zv, 1);
+	MAKE_STD_ZVAL(ztype);
+	ZVAL_LONG(ztype, type);
+	MAKE_STD_ZVAL(zdata);
+	ZVAL_STRINGL(zdata, data, size, 1);
+
+	zend_replace_error_handling(EH_NORMAL, NULL, &zeh TSRMLS_CC);
+	if (SUCCESS == zend_fcall_info_argn(&client_obj->debug.fci TSRMLS_CC, 4, &zclient, &zrequest, &ztype, &zdata)) {
+		zend_fcall_info_call(&client_obj->debug.fci, &client_obj->debug.fcc, &retval, NULL TSRMLS_CC);
+		zend_fcall_info_args_clear(&client_obj->debug.fci, 0);
+	}
+	zend_restore_error_handling(&zeh TSRMLS_CC);
+
+	zval_ptr_dtor(&zclient);
+	zval_ptr_dtor(&zrequest);
+	zval_ptr_dtor(&ztype);
+	zval_ptr_dtor(&zdata);
+	if (retval) {
+		zval_ptr_dtor(&retval);
+	}
+}
+
 static void response_dtor(void *data)
 {
 	php_http_message_object_t *msg_obj = *(php_http_message_object_t **) data;
@@ -547,8 +743,7 @@ static PHP_METHOD(HttpClient, __construct)
 
 		obj->client->callback.response.func = handle_response;
 		obj->client->callback.response.arg = obj;
-		obj->client->callback.progress.func = handle_progress;
-		obj->client->callback.progress.arg = obj;
+		handle_progress_observed(getThis(), obj TSRMLS_CC);
 
 		obj->client->responses.dtor = response_dtor;
 }
@@ -563,12 +758,37 @@ static PHP_METHOD(HttpClient, reset)
 	obj = zend_object_store_get_object(getThis() TSRMLS_CC);
 
 	obj->iterator = 0;
+	feed_free(&obj->feed TSRMLS_CC);
 	php_http_client_reset(obj->client);
 
 	RETVAL_ZVAL(getThis(), 1, 0);
 }
 
-static HashTable *combined_options(zval *client, zval *request TSRMLS_DC)
+/* client options shared by requests which do not have any options of their own */
+typedef struct shared_options {
+	HashTable options;
+	unsigned refcount;
+} shared_options_t;
+
+static zval *request_options(zval *request TSRMLS_DC)
+{
+	zend_function *getter;
+	zval *z_roptions = NULL;
+
+	/* avoid the method call if getOptions() has not been overridden */
+	if (SUCCESS == zend_hash_find(&Z_OBJCE_P(request)->function_table, ZEND_STRS("getoptions"), (void *) &getter)
+	&&	getter->type == ZEND_INTERNAL_FUNCTION
+	&&	getter->common.scope == php_http_client_request_class_entry
+	) {
+		z_roptions = zend_read_property(php_http_client_request_class_entry, request, ZEND_STRL("options"), 0 TSRMLS_CC);
+		Z_ADDREF_P(z_roptions);
+	} else {
+		zend_call_method_with_0_params(&request, NULL, NULL, "getOptions", &z_roptions);
+	}
+	return z_roptions;
+}
+
+static HashTable *combined_options(zval *client, zval *request, shared_options_t **shared TSRMLS_DC)
 {
 	HashTable *options;
 	int num_options = 0;
@@ -577,12 +797,27 @@ static HashTable *combined_options(zval *client, zval *request TSRMLS_DC)
 	if (Z_TYPE_P(z_coptions) == IS_ARRAY) {
 		num_options = zend_hash_num_elements(Z_ARRVAL_P(z_coptions));
 	}
-	zend_call_method_with_0_params(&request, NULL, NULL, "getOptions", &z_roptions);
-	if (z_roptions && Z_TYPE_P(z_roptions) == IS_ARRAY) {
+	z_roptions = request_options(request TSRMLS_CC);
+	if (z_roptions && Z_TYPE_P(z_roptions) == IS_ARRAY && zend_hash_num_elements(Z_ARRVAL_P(z_roptions))) {
 		int num = zend_hash_num_elements(Z_ARRVAL_P(z_roptions));
 		if (num > num_options) {
 			num_options = num;
 		}
+	} else if (shared) {
+		if (z_roptions) {
+			zval_ptr_dtor(&z_roptions);
+		}
+		if (!*shared) {
+			/* one reference is held by the caller */
+			*shared = emalloc(sizeof(**shared));
+			(*shared)->refcount = 1;
+			ZEND_INIT_SYMTABLE_EX(&(*shared)->options, num_options, 0);
+			if (Z_TYPE_P(z_coptions) == IS_ARRAY) {
+				array_copy(Z_ARRVAL_P(z_coptions), &(*shared)->options);
+			}
+		}
+		++(*shared)->refcount;
+		return &(*shared)->options;
 	}
 	ALLOC_HASHTABLE(options);
 	ZEND_INIT_SYMTABLE_EX(options, num_options, 0);
@@ -598,14 +833,12 @@ static HashTable *combined_options(zval *client, zval *request TSRMLS_DC)
 	return options;
 }
 
-static void msg_queue_dtor(php_http_client_enqueue_t *e)
+static void msg_queue_dtor_ex(php_http_client_enqueue_t *e)
 {
 	php_http_message_object_t *msg_obj = e->opaque;
 	TSRMLS_FETCH_FROM_CTX(msg_obj->message->ts);
 
 	zend_objects_store_del_ref_by_handle_ex(msg_obj->zv.handle, msg_obj->zv.handlers TSRMLS_CC);
-	zend_hash_destroy(e->options);
-	FREE_HASHTABLE(e->options);
 
 	if (e->closure.fci.size) {
 		zval_ptr_dtor(&e->closure.fci.function_name);
@@ -615,6 +848,61 @@ static void msg_queue_dtor(php_http_client_enqueue_t *e)
 	}
 }
 
+static void msg_queue_dtor(php_http_client_enqueue_t *e)
+{
+	zend_hash_destroy(e->options);
+	FREE_HASHTABLE(e->options);
+
+	msg_queue_dtor_ex(e);
+}
+
+static void msg_queue_dtor_shared(php_http_client_enqueue_t *e)
+{
+	shared_options_t *shared = (shared_options_t *) e->options;
+
+	if (!--shared->refcount) {
+		zend_hash_destroy(&shared->options);
+		efree(shared);
+	}
+
+	msg_queue_dtor_ex(e);
+}
+
+static ZEND_RESULT_CODE client_enqueue(zval *zclient, zval *request, zend_fcall_info *fci, zend_fcall_info_cache *fcc, shared_options_t **shared TSRMLS_DC)
+{
+	php_http_client_object_t *obj = zend_object_store_get_object(zclient TSRMLS_CC);
+	php_http_message_object_t *msg_obj = zend_object_store_get_object(request TSRMLS_CC);
+	php_http_client_enqueue_t q;
+
+	if (php_http_client_enqueued(obj->client, msg_obj->message, NULL)) {
+		php_http_throw(bad_method_call, "Failed to enqueue request; request already in queue", NULL);
+		return FAILURE;
+	}
+
+	q.request = msg_obj->message;
+	q.options = combined_options(zclient, request, shared TSRMLS_CC);
+	q.dtor = (shared && *shared && q.options == &(*shared)->options) ? msg_queue_dtor_shared : msg_queue_dtor;
+	q.opaque = msg_obj;
+	q.closure.fci = *fci;
+	q.closure.fcc = *fcc;
+
+	if (fci->size) {
+		Z_ADDREF_P(fci->function_name);
+		if (fci->object_ptr) {
+			Z_ADDREF_P(fci->object_ptr);
+		}
+	}
+
+	zend_objects_store_add_ref_by_handle(msg_obj->zv.handle TSRMLS_CC);
+
+	php_http_expect(SUCCESS == php_http_client_enqueue(obj->client, &q), runtime,
+			q.dtor(&q);
+			return FAILURE;
+	);
+
+	return SUCCESS;
+}
+
 ZEND_BEGIN_ARG_INFO_EX(ai_HttpClient_enqueue, 0, 0, 1)
 	ZEND_ARG_OBJ_INFO(0, request, http\\Client\\Request, 0)
 	ZEND_ARG_INFO(0, callable)
@@ -624,40 +912,370 @@ static PHP_METHOD(HttpClient, enqueue)
 	zval *request;
 	zend_fcall_info fci = empty_fcall_info;
 	zend_fcall_info_cache fcc = empty_fcall_info_cache;
-	php_http_client_object_t *obj;
-	php_http_message_object_t *msg_obj;
-	php_http_client_enqueue_t q;
 
 	php_http_expect(SUCCESS == zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "O|f", &request, php_http_client_request_class_entry, &fci, &fcc), invalid_arg, return);
 
-	obj = zend_object_store_get_object(getThis() TSRMLS_CC);
-	msg_obj = zend_object_store_get_object(request TSRMLS_CC);
+	if (SUCCESS == client_enqueue(getThis(), request, &fci, &fcc, NULL TSRMLS_CC)) {
+		RETVAL_ZVAL(getThis(), 1, 0);
+	}
+}
 
-	if (php_http_client_enqueued(obj->client, msg_obj->message, NULL)) {
-		php_http_throw(bad_method_call, "Failed to enqueue request; request already in queue", NULL);
-		return;
+struct enqueue_many_arg {
+	zval *zclient;
+	zend_fcall_info *fci;
+	zend_fcall_info_cache *fcc;
+	shared_options_t *shared;
+};
+
+static int enqueue_many(zval **request, struct enqueue_many_arg *arg TSRMLS_DC)
+{
+	if (Z_TYPE_PP(request) != IS_OBJECT || !instanceof_function(Z_OBJCE_PP(request), php_http_client_request_class_entry TSRMLS_CC)) {
+		php_http_throw(invalid_arg, "Expected instances of http\\Client\\Request, got %s", zend_zval_type_name(*request));
+		return ZEND_HASH_APPLY_STOP;
+	}
+	if (SUCCESS != client_enqueue(arg->zclient, *request, arg->fci, arg->fcc, &arg->shared TSRMLS_CC)) {
+		return ZEND_HASH_APPLY_STOP;
+	}
+	return ZEND_HASH_APPLY_KEEP;
+}
+
+static int enqueue_many_iter(zend_object_iterator *iter, void *puser TSRMLS_DC)
+{
+	zval **request = NULL;
+
+	iter->funcs->get_current_data(iter, &request TSRMLS_CC);
+	if (!request) {
+		return ZEND_HASH_APPLY_STOP;
 	}
+	return enqueue_many(request, puser TSRMLS_CC);
+}
 
-	q.request = msg_obj->message;
-	q.options = combined_options(getThis(), request TSRMLS_CC);
-	q.dtor = msg_queue_dtor;
-	q.opaque = msg_obj;
-	q.closure.fci = fci;
-	q.closure.fcc = fcc;
+ZEND_BEGIN_ARG_INFO_EX(ai_HttpClient_enqueueMany, 0, 0, 1)
+	ZEND_ARG_INFO(0, requests)
+	ZEND_ARG_INFO(0, callable)
+ZEND_END_ARG_INFO();
+static PHP_METHOD(HttpClient, enqueueMany)
+{
+	zval *requests;
+	zend_fcall_info fci = empty_fcall_info;
+	zend_fcall_info_cache fcc = empty_fcall_info_cache;
+	struct enqueue_many_arg arg;
+
+	php_http_expect(SUCCESS == zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "z|f", &requests, &fci, &fcc), invalid_arg, return);
+
+	arg.zclient = getThis();
+	arg.fci = &fci;
+	arg.fcc = &fcc;
+	arg.shared = NULL;
+
+	switch (Z_TYPE_P(requests)) {
+		case IS_ARRAY:
+			zend_hash_apply_with_argument(Z_ARRVAL_P(requests), (apply_func_arg_t) enqueue_many, &arg TSRMLS_CC);
+			break;
+		case IS_OBJECT:
+			if (instanceof_function(Z_OBJCE_P(requests), zend_ce_traversable TSRMLS_CC)) {
+				spl_iterator_apply(requests, enqueue_many_iter, &arg TSRMLS_CC);
+				break;
+			}
+			/* no break */
+		default:
+			php_http_throw(invalid_arg, "Expected array or Traversable of http\\Client\\Request, got %s", zend_zval_type_name(requests));
+			return;
+	}
 
-	if (fci.size) {
-		Z_ADDREF_P(fci.function_name);
-		if (fci.object_ptr) {
-			Z_ADDREF_P(fci.object_ptr);
+	/* the shared options are freed with their last request */
+	if (arg.shared && !--arg.shared->refcount) {
+		zend_hash_destroy(&arg.shared->options);
+		efree(arg.shared);
+	}
+
+	if (!EG(exception)) {
+		RETVAL_ZVAL(getThis(), 1, 0);
+	}
+}
+
+/* lazily enqueue requests from an array or Traversable, limiting the number of requests in flight */
+typedef struct php_http_client_feed {
+	zval *source;
+	zend_object_iterator *iter;
+	HashPosition pos;
+
+	struct {
+		zend_fcall_info fci;
+		zend_fcall_info_cache fcc;
+	} closure;
+
+	long concurrency;
+	long per_host;
+	long running;
+
+	/* host => number of running requests */
+	HashTable hosts;
+	/* php_http_message_t* => host of running requests */
+	HashTable requests;
+	/* requests waiting for their host to drop below per_host */
+	zend_llist parked;
+
+	unsigned rewound:1;
+	unsigned exhausted:1;
+} php_http_client_feed_t;
+
+static void feed_host_dtor(void *ptr)
+{
+	efree(*(char **) ptr);
+}
+
+static void feed_parked_dtor(void *ptr)
+{
+	zval_ptr_dtor((zval **) ptr);
+}
+
+static int feed_parked_cmp(void *ptr, void *request)
+{
+	return *(zval **) ptr == request;
+}
+
+static void feed_free(php_http_client_feed_t **feed_ptr TSRMLS_DC)
+{
+	php_http_client_feed_t *feed = *feed_ptr;
+
+	if (feed) {
+		if (feed->iter) {
+			feed->iter->funcs->dtor(feed->iter TSRMLS_CC);
+		}
+		zval_ptr_dtor(&feed->source);
+		if (feed->closure.fci.size) {
+			zval_ptr_dtor(&feed->closure.fci.function_name);
+			if (feed->closure.fci.object_ptr) {
+				zval_ptr_dtor(&feed->closure.fci.object_ptr);
+			}
 		}
+		zend_hash_destroy(&feed->hosts);
+		zend_hash_destroy(&feed->requests);
+		zend_llist_destroy(&feed->parked);
+		efree(feed);
+		*feed_ptr = NULL;
 	}
+}
 
-	zend_objects_store_add_ref_by_handle(msg_obj->zv.handle TSRMLS_CC);
+static const char *feed_host(zval *request TSRMLS_DC)
+{
+	php_http_message_object_t *msg_obj = zend_object_store_get_object(request TSRMLS_CC);
+	php_http_url_t *url = PHP_HTTP_INFO(msg_obj->message).request.url;
 
-	php_http_expect(SUCCESS == php_http_client_enqueue(obj->client, &q), runtime,
-			msg_queue_dtor(&q);
+	return url && url->host ? url->host : "";
+}
+
+static zend_bool feed_host_available(php_http_client_feed_t *feed, zval *request TSRMLS_DC)
+{
+	const char *host;
+	long *count;
+
+	if (feed->per_host <= 0) {
+		return 1;
+	}
+
+	host = feed_host(request TSRMLS_CC);
+	if (SUCCESS == zend_hash_find(&feed->hosts, host, strlen(host) + 1, (void *) &count)) {
+		return *count < feed->per_host;
+	}
+	return 1;
+}
+
+static zend_bool feed_running(php_http_client_feed_t *feed, php_http_message_t *request)
+{
+	return zend_hash_index_exists(&feed->requests, (ulong) request);
+}
+
+static void feed_finished(php_http_client_feed_t *feed, php_http_message_t *request)
+{
+	char **host;
+	long *count;
+
+	if (SUCCESS == zend_hash_index_find(&feed->requests, (ulong) request, (void *) &host)) {
+		if (SUCCESS == zend_hash_find(&feed->hosts, *host, strlen(*host) + 1, (void *) &count) && !--*count) {
+			zend_hash_del(&feed->hosts, *host, strlen(*host) + 1);
+		}
+		zend_hash_index_del(&feed->requests, (ulong) request);
+		--feed->running;
+	}
+}
+
+static ZEND_RESULT_CODE feed_start(zval *zclient, php_http_client_feed_t *feed, zval *request TSRMLS_DC)
+{
+	php_http_message_object_t *msg_obj = zend_object_store_get_object(request TSRMLS_CC);
+	const char *host = feed_host(request TSRMLS_CC);
+	char *host_copy;
+	long one = 1, *count;
+
+	if (SUCCESS != client_enqueue(zclient, request, &feed->closure.fci, &feed->closure.fcc, NULL TSRMLS_CC)) {
+		return FAILURE;
+	}
+
+	host_copy = estrdup(host);
+	zend_hash_index_update(&feed->requests, (ulong) msg_obj->message, &host_copy, sizeof(char *), NULL);
+	if (SUCCESS == zend_hash_find(&feed->hosts, host, strlen(host) + 1, (void *) &count)) {
+		++*count;
+	} else {
+		zend_hash_add(&feed->hosts, host, strlen(host) + 1, &one, sizeof(one), NULL);
+	}
+	++feed->running;
+
+	return SUCCESS;
+}
+
+static zval *feed_next(php_http_client_feed_t *feed TSRMLS_DC)
+{
+	zval **data = NULL;
+
+	if (feed->exhausted) {
+		return NULL;
+	}
+
+	if (feed->iter) {
+		if (!feed->rewound) {
+			if (feed->iter->funcs->rewind) {
+				feed->iter->funcs->rewind(feed->iter TSRMLS_CC);
+			}
+		} else {
+			feed->iter->funcs->move_forward(feed->iter TSRMLS_CC);
+		}
+		if (!EG(exception) && SUCCESS == feed->iter->funcs->valid(feed->iter TSRMLS_CC)) {
+			feed->iter->funcs->get_current_data(feed->iter, &data TSRMLS_CC);
+		}
+	} else {
+		if (!feed->rewound) {
+			zend_hash_internal_pointer_reset_ex(Z_ARRVAL_P(feed->source), &feed->pos);
+		} else {
+			zend_hash_move_forward_ex(Z_ARRVAL_P(feed->source), &feed->pos);
+		}
+		zend_hash_get_current_data_ex(Z_ARRVAL_P(feed->source), (void *) &data, &feed->pos);
+	}
+	feed->rewound = 1;
+
+	if (EG(exception) || !data) {
+		feed->exhausted = 1;
+		return NULL;
+	}
+
+	Z_ADDREF_PP(data);
+	return *data;
+}
+
+static void feed_fill(zval *zclient, php_http_client_object_t *obj TSRMLS_DC)
+{
+	php_http_client_feed_t *feed = obj->feed;
+	zend_llist_element *el, *next;
+
+	/* parked requests first */
+	for (el = feed->parked.head; el && feed->running < feed->concurrency; el = next) {
+		zval *request = *(zval **) el->data;
+
+		next = el->next;
+		if (feed_host_available(feed, request TSRMLS_CC)) {
+			Z_ADDREF_P(request);
+			zend_llist_del_element(&feed->parked, request, feed_parked_cmp);
+			if (SUCCESS != feed_start(zclient, feed, request TSRMLS_CC)) {
+				feed->exhausted = 1;
+			}
+			zval_ptr_dtor(&request);
+			if (EG(exception)) {
+				break;
+			}
+		}
+	}
+
+	/* do not pull more than we could start, if all of them were parked */
+	while (feed->running < feed->concurrency && zend_llist_count(&feed->parked) < feed->concurrency && !EG(exception)) {
+		zval *request = feed_next(feed TSRMLS_CC);
+
+		if (!request) {
+			break;
+		}
+		if (Z_TYPE_P(request) != IS_OBJECT || !instanceof_function(Z_OBJCE_P(request), php_http_client_request_class_entry TSRMLS_CC)) {
+			php_http_throw(invalid_arg, "Expected instances of http\\Client\\Request, got %s", zend_zval_type_name(request));
+			zval_ptr_dtor(&request);
+			feed->exhausted = 1;
+			break;
+		}
+		if (feed_host_available(feed, request TSRMLS_CC)) {
+			if (SUCCESS != feed_start(zclient, feed, request TSRMLS_CC)) {
+				feed->exhausted = 1;
+			}
+			zval_ptr_dtor(&request);
+		} else {
+			zend_llist_add_element(&feed->parked, &request);
+		}
+	}
+
+	if (feed->exhausted && !feed->running && !zend_llist_count(&feed->parked)) {
+		feed_free(&obj->feed TSRMLS_CC);
+	}
+}
+
+ZEND_BEGIN_ARG_INFO_EX(ai_HttpClient_feed, 0, 0, 3)
+	ZEND_ARG_INFO(0, requests)
+	ZEND_ARG_INFO(0, concurrency)
+	ZEND_ARG_INFO(0, callable)
+	ZEND_ARG_INFO(0, per_host_concurrency)
+ZEND_END_ARG_INFO();
+static PHP_METHOD(HttpClient, feed)
+{
+	zval *requests;
+	long concurrency, per_host = 0;
+	zend_fcall_info fci = empty_fcall_info;
+	zend_fcall_info_cache fcc = empty_fcall_info_cache;
+	php_http_client_object_t *obj;
+	php_http_client_feed_t *feed;
+
+	php_http_expect(SUCCESS == zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "zlf|l", &requests, &concurrency, &fci, &fcc, &per_host), invalid_arg, return);
+
+	obj = zend_object_store_get_object(getThis() TSRMLS_CC);
+
+	if (obj->feed) {
+		php_http_throw(bad_method_call, "Cannot feed requests; the client is already being fed", NULL);
+		return;
+	}
+	if (concurrency < 1) {
+		php_http_throw(invalid_arg, "Concurrency must be greater than zero, got %ld", concurrency);
+		return;
+	}
+	if (Z_TYPE_P(requests) != IS_ARRAY && (Z_TYPE_P(requests) != IS_OBJECT || !instanceof_function(Z_OBJCE_P(requests), zend_ce_traversable TSRMLS_CC))) {
+		php_http_throw(invalid_arg, "Expected array or Traversable of http\\Client\\Request, got %s", zend_zval_type_name(requests));
+		return;
+	}
+
+	feed = ecalloc(1, sizeof(*feed));
+	feed->concurrency = concurrency;
+	feed->per_host = per_host;
+	zend_hash_init(&feed->hosts, 0, NULL, NULL, 0);
+	zend_hash_init(&feed->requests, concurrency, NULL, feed_host_dtor, 0);
+	zend_llist_init(&feed->parked, sizeof(zval *), feed_parked_dtor, 0);
+
+	Z_ADDREF_P(requests);
+	feed->source = requests;
+	if (Z_TYPE_P(requests) == IS_OBJECT) {
+		zend_class_entry *ce = Z_OBJCE_P(requests);
+
+		if (!(feed->iter = ce->get_iterator(ce, requests, 0 TSRMLS_CC)) || EG(exception)) {
+			feed->iter = NULL;
+			feed_free(&feed TSRMLS_CC);
+			if (!EG(exception)) {
+				php_http_throw(unexpected_val, "Failed to get an iterator for %s", ce->name);
+			}
 			return;
-	);
+		}
+	}
+
+	feed->closure.fci = fci;
+	feed->closure.fcc = fcc;
+	Z_ADDREF_P(fci.function_name);
+	if (fci.object_ptr) {
+		Z_ADDREF_P(fci.object_ptr);
+	}
+
+	obj->feed = feed;
+	feed_fill(getThis(), obj TSRMLS_CC);
 
 	RETVAL_ZVAL(getThis(), 1, 0);
 }
@@ -697,7 +1315,6 @@ static PHP_METHOD(HttpClient, requeue)
 	zend_fcall_info_cache fcc = empty_fcall_info_cache;
 	php_http_client_object_t *obj;
 	php_http_message_object_t *msg_obj;
-	php_http_client_enqueue_t q;
 
 	php_http_expect(SUCCESS == zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "O|f", &request, php_http_client_request_class_entry, &fci, &fcc), invalid_arg, return);
 
@@ -708,28 +1325,9 @@ static PHP_METHOD(HttpClient, requeue)
 		php_http_expect(SUCCESS == php_http_client_dequeue(obj->client, msg_obj->message), runtime, return);
 	}
 
-	q.request = msg_obj->message;
-	q.options = combined_options(getThis(), request TSRMLS_CC);
-	q.dtor = msg_queue_dtor;
-	q.opaque = msg_obj;
-	q.closure.fci = fci;
-	q.closure.fcc = fcc;
-
-	if (fci.size) {
-		Z_ADDREF_P(fci.function_name);
-		if (fci.object_ptr) {
-			Z_ADDREF_P(fci.object_ptr);
-		}
+	if (SUCCESS == client_enqueue(getThis(), request, &fci, &fcc, NULL TSRMLS_CC)) {
+		RETVAL_ZVAL(getThis(), 1, 0);
 	}
-
-	zend_objects_store_add_ref_by_handle(msg_obj->zv.handle TSRMLS_CC);
-
-	php_http_expect(SUCCESS == php_http_client_enqueue(obj->client, &q), runtime,
-			msg_queue_dtor(&q);
-			return;
-	);
-
-	RETVAL_ZVAL(getThis(), 1, 0);
 }
 
 ZEND_BEGIN_ARG_INFO_EX(ai_HttpClient_count, 0, 0, 0)
@@ -963,6 +1561,45 @@ static PHP_METHOD(HttpClient, notify)
 	RETVAL_ZVAL(getThis(), 1, 0);
 }
 
+ZEND_BEGIN_ARG_INFO_EX(ai_HttpClient_setDebug, 0, 0, 0)
+	ZEND_ARG_INFO(0, callback)
+ZEND_END_ARG_INFO();
+static PHP_METHOD(HttpClient, setDebug)
+{
+	zend_fcall_info fci = empty_fcall_info;
+	zend_fcall_info_cache fcc = empty_fcall_info_cache;
+	php_http_client_object_t *client_obj;
+
+	php_http_expect(SUCCESS == zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "|f!", &fci, &fcc), invalid_arg, return);
+
+	client_obj = zend_object_store_get_object(getThis() TSRMLS_CC);
+
+	if (client_obj->debug.fci.size) {
+		zend_fcall_info_args_clear(&client_obj->debug.fci, 1);
+		zval_ptr_dtor(&client_obj->debug.fci.function_name);
+		if (client_obj->debug.fci.object_ptr) {
+			zval_ptr_dtor(&client_obj->debug.fci.object_ptr);
+		}
+		client_obj->debug.fci = empty_fcall_info;
+		client_obj->debug.fcc = empty_fcall_info_cache;
+	}
+	client_obj->client->callback.debug.func = NULL;
+	client_obj->client->callback.debug.arg = NULL;
+
+	if (fci.size) {
+		Z_ADDREF_P(fci.function_name);
+		if (fci.object_ptr) {
+			Z_ADDREF_P(fci.object_ptr);
+		}
+		client_obj->debug.fci = fci;
+		client_obj->debug.fcc = fcc;
+		client_obj->client->callback.debug.func = handle_debug;
+		client_obj->client->callback.debug.arg = client_obj;
+	}
+
+	RETVAL_ZVAL(getThis(), 1, 0);
+}
+
 ZEND_BEGIN_ARG_INFO_EX(ai_HttpClient_attach, 0, 0, 1)
 	ZEND_ARG_OBJ_INFO(0, observer, SplObserver, 0)
 ZEND_END_ARG_INFO();
@@ -989,6 +1626,7 @@ static PHP_METHOD(HttpClient, attach)
 	if (retval) {
 		zval_ptr_dtor(&retval);
 	}
+	handle_progress_observed(getThis(), client_obj TSRMLS_CC);
 
 	RETVAL_ZVAL(getThis(), 1, 0);
 }
@@ -999,9 +1637,11 @@ ZEND_END_ARG_INFO();
 static PHP_METHOD(HttpClient, detach)
 {
 	zval *observers, *observer, *retval = NULL;
+	php_http_client_object_t *client_obj;
 
 	php_http_expect(SUCCESS == zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "O", &observer, spl_ce_SplObserver), invalid_arg, return);
 
+	client_obj = zend_object_store_get_object(getThis() TSRMLS_CC);
 	observers = zend_read_property(php_http_client_class_entry, getThis(), ZEND_STRL("observers"), 0 TSRMLS_CC);
 
 	if (Z_TYPE_P(observers) != IS_OBJECT) {
@@ -1013,6 +1653,7 @@ static PHP_METHOD(HttpClient, detach)
 	if (retval) {
 		zval_ptr_dtor(&retval);
 	}
+	handle_progress_observed(getThis(), client_obj TSRMLS_CC);
 
 	RETVAL_ZVAL(getThis(), 1, 0);
 }
@@ -1213,10 +1854,67 @@ static PHP_METHOD(HttpClient, getAvailableConfiguration)
 	}
 }
 
+ZEND_BEGIN_ARG_INFO_EX(ai_HttpClient_getPoolStats, 0, 0, 0)
+ZEND_END_ARG_INFO();
+static PHP_METHOD(HttpClient, getPoolStats)
+{
+	if (SUCCESS == zend_parse_parameters_none()) {
+		php_http_client_object_t *obj = zend_object_store_get_object(getThis() TSRMLS_CC);
+
+		array_init(return_value);
+		php_http_client_getopt(obj->client, PHP_HTTP_CLIENT_OPT_POOL_STATS, NULL, &Z_ARRVAL_P(return_value));
+	}
+}
+
+ZEND_BEGIN_ARG_INFO_EX(ai_HttpClient_getLatencyStats, 0, 0, 0)
+	ZEND_ARG_ARRAY_INFO(0, percentiles, 1)
+	ZEND_ARG_INFO(0, host)
+ZEND_END_ARG_INFO();
+static PHP_METHOD(HttpClient, getLatencyStats)
+{
+	HashTable *percentiles = NULL;
+	char *host_str = NULL;
+	int host_len = 0;
+	double defaults[] = {50, 90, 99, 99.9};
+	php_http_client_latency_query_t query = {NULL, 0, defaults, sizeof(defaults)/sizeof(defaults[0])};
+	php_http_client_object_t *obj;
+
+	php_http_expect(SUCCESS == zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "|H!s!", &percentiles, &host_str, &host_len), invalid_arg, return);
+
+	obj = zend_object_store_get_object(getThis() TSRMLS_CC);
+
+	if (host_str) {
+		query.host_str = host_str;
+		query.host_len = host_len;
+	}
+	if (percentiles) {
+		HashPosition pos;
+		zval **val;
+
+		query.count = 0;
+		query.percentiles = ecalloc(zend_hash_num_elements(percentiles) + 1, sizeof(double));
+		FOREACH_HASH_VAL(pos, percentiles, val) {
+			zval *zcpy = php_http_ztyp(IS_DOUBLE, *val);
+
+			query.percentiles[query.count++] = Z_DVAL_P(zcpy);
+			zval_ptr_dtor(&zcpy);
+		}
+	}
+
+	array_init(return_value);
+	php_http_client_getopt(obj->client, PHP_HTTP_CLIENT_OPT_LATENCY_STATS, &query, &Z_ARRVAL_P(return_value));
+
+	if (percentiles) {
+		efree(query.percentiles);
+	}
+}
+
 static zend_function_entry php_http_client_methods[] = {
 	PHP_ME(HttpClient, __construct,          ai_HttpClient_construct,            ZEND_ACC_PUBLIC|ZEND_ACC_CTOR)
 	PHP_ME(HttpClient, reset,                ai_HttpClient_reset,                ZEND_ACC_PUBLIC)
 	PHP_ME(HttpClient, enqueue,              ai_HttpClient_enqueue,              ZEND_ACC_PUBLIC)
+	PHP_ME(HttpClient, enqueueMany,          ai_HttpClient_enqueueMany,          ZEND_ACC_PUBLIC)
+	PHP_ME(HttpClient, feed,                 ai_HttpClient_feed,                 ZEND_ACC_PUBLIC)
 	PHP_ME(HttpClient, dequeue,              ai_HttpClient_dequeue,              ZEND_ACC_PUBLIC)
 	PHP_ME(HttpClient, requeue,              ai_HttpClient_requeue,              ZEND_ACC_PUBLIC)
 	PHP_ME(HttpClient, count,                ai_HttpClient_count,                ZEND_ACC_PUBLIC)
@@ -1232,6 +1930,7 @@ static zend_function_entry php_http_client_methods[] = {
 	PHP_ME(HttpClient, attach,               ai_HttpClient_attach,               ZEND_ACC_PUBLIC)
 	PHP_ME(HttpClient, detach,               ai_HttpClient_detach,               ZEND_ACC_PUBLIC)
 	PHP_ME(HttpClient, getObservers,         ai_HttpClient_getObservers,         ZEND_ACC_PUBLIC)
+	PHP_ME(HttpClient, setDebug,             ai_HttpClient_setDebug,             ZEND_ACC_PUBLIC)
 	PHP_ME(HttpClient, getProgressInfo,      ai_HttpClient_getProgressInfo,      ZEND_ACC_PUBLIC)
 	PHP_ME(HttpClient, getTransferInfo,      ai_HttpClient_getTransferInfo,      ZEND_ACC_PUBLIC)
 	PHP_ME(HttpClient, setOptions,           ai_HttpClient_setOptions,           ZEND_ACC_PUBLIC)
@@ -1245,6 +1944,8 @@ static zend_function_entry php_http_client_methods[] = {
 	PHP_ME(HttpClient, getAvailableDrivers,  ai_HttpClient_getAvailableDrivers,  ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
 	PHP_ME(HttpClient, getAvailableOptions,  ai_HttpClient_getAvailableOptions,  ZEND_ACC_PUBLIC)
 	PHP_ME(HttpClient, getAvailableConfiguration, ai_HttpClient_getAvailableConfiguration, ZEND_ACC_PUBLIC)
+	PHP_ME(HttpClient, getPoolStats,         ai_HttpClient_getPoolStats,         ZEND_ACC_PUBLIC)
+	PHP_ME(HttpClient, getLatencyStats,      ai_HttpClient_getLatencyStats,      ZEND_ACC_PUBLIC)
 	EMPTY_FUNCTION_ENTRY
 };
 
@@ -1263,6 +1964,13 @@ PHP_MINIT_FUNCTION(http_client)
 	zend_declare_property_null(php_http_client_class_entry, ZEND_STRL("history"), ZEND_ACC_PROTECTED TSRMLS_CC);
 	zend_declare_property_bool(php_http_client_class_entry, ZEND_STRL("recordHistory"), 0, ZEND_ACC_PUBLIC TSRMLS_CC);
 
+	zend_declare_class_constant_long(php_http_client_class_entry, ZEND_STRL("DEBUG_INFO"), PHP_HTTP_CLIENT_DEBUG_INFO TSRMLS_CC);
+	zend_declare_class_constant_long(php_http_client_class_entry, ZEND_STRL("DEBUG_IN"), PHP_HTTP_CLIENT_DEBUG_IN TSRMLS_CC);
+	zend_declare_class_constant_long(php_http_client_class_entry, ZEND_STRL("DEBUG_OUT"), PHP_HTTP_CLIENT_DEBUG_OUT TSRMLS_CC);
+	zend_declare_class_constant_long(php_http_client_class_entry, ZEND_STRL("DEBUG_HEADER"), PHP_HTTP_CLIENT_DEBUG_HEADER TSRMLS_CC);
+	zend_declare_class_constant_long(php_http_client_class_entry, ZEND_STRL("DEBUG_BODY"), PHP_HTTP_CLIENT_DEBUG_BODY TSRMLS_CC);
+	zend_declare_class_constant_long(php_http_client_class_entry, ZEND_STRL("DEBUG_SSL"), PHP_HTTP_CLIENT_DEBUG_SSL TSRMLS_CC);
+
 	zend_hash_init(&php_http_client_drivers, 2, NULL, NULL, 1);
 
 	return SUCCESS;
@@ -24,8 +24,24 @@ typedef enum php_http_client_getopt_opt {
 	PHP_HTTP_CLIENT_OPT_TRANSFER_INFO,		/* php_http_client_enqueue_t*, HashTable* */
 	PHP_HTTP_CLIENT_OPT_AVAILABLE_OPTIONS,		/* NULL, HashTable* */
 	PHP_HTTP_CLIENT_OPT_AVAILABLE_CONFIGURATION,/* NULL, HashTable */
+	PHP_HTTP_CLIENT_OPT_POOL_STATS,			/* NULL, HashTable* */
+	PHP_HTTP_CLIENT_OPT_LATENCY_STATS,		/* php_http_client_latency_query_t*, HashTable* */
+	PHP_HTTP_CLIENT_OPT_TRANSFER_INFO_SNAPSHOT,	/* php_http_client_enqueue_t*, php_http_client_transfer_info_t** */
 } php_http_client_getopt_opt_t;
 
+/* raw transfer info of a finished transfer, turned into the transferInfo object on demand */
+typedef struct php_http_client_transfer_info {
+	void (*fill)(struct php_http_client_transfer_info *ti, HashTable *info);
+	void (*dtor)(struct php_http_client_transfer_info *ti);
+} php_http_client_transfer_info_t;
+
+typedef struct php_http_client_latency_query {
+	const char *host_str;	/* "host:port" or NULL for all transfers */
+	size_t host_len;
+	double *percentiles;	/* 0..100 */
+	unsigned count;
+} php_http_client_latency_query_t;
+
 typedef struct php_http_client_enqueue {
 	php_http_message_t *request; /* unique */
 	HashTable *options;
@@ -90,6 +106,14 @@ typedef struct php_http_client_progress_state {
 typedef ZEND_RESULT_CODE (*php_http_client_response_callback_t)(void *arg, struct php_http_client *client, php_http_client_enqueue_t *e, php_http_message_t **response);
 typedef void (*php_http_client_progress_callback_t)(void *arg, struct php_http_client *client, php_http_client_enqueue_t *e, php_http_client_progress_state_t *state);
 
+#define PHP_HTTP_CLIENT_DEBUG_INFO		0x00
+#define PHP_HTTP_CLIENT_DEBUG_IN		0x01
+#define PHP_HTTP_CLIENT_DEBUG_OUT		0x02
+#define PHP_HTTP_CLIENT_DEBUG_HEADER	0x10
+#define PHP_HTTP_CLIENT_DEBUG_BODY		0x20
+#define PHP_HTTP_CLIENT_DEBUG_SSL		0x40
+typedef void (*php_http_client_debug_callback_t)(void *arg, struct php_http_client *client, php_http_client_enqueue_t *e, unsigned type, const char *data, size_t size);
+
 typedef struct php_http_client {
 	void *ctx;
 	php_resource_factory_t *rf;
@@ -104,11 +128,22 @@ typedef struct php_http_client {
 			php_http_client_progress_callback_t func;
 			void *arg;
 		} progress;
+		/* drivers should only enable tracing if set */
+		struct {
+			php_http_client_debug_callback_t func;
+			void *arg;
+		} debug;
 	} callback;
 
 	zend_llist requests;
 	zend_llist responses;
 
+	/* lookup of zend_llist_element* in requests by request message and by driver handle */
+	struct {
+		HashTable requests;
+		HashTable handles;
+	} index;
+
 #ifdef ZTS
 	void ***ts;
 #endif
@@ -123,6 +158,12 @@ typedef struct php_http_client_object {
 	long iterator;
 	php_http_object_method_t *update;
 	php_http_object_method_t notify;
+	struct {
+		zend_fcall_info fci;
+		zend_fcall_info_cache fcc;
+	} debug;
+	struct php_http_client_feed *feed;
+	zval *progress;
 } php_http_client_object_t;
 
 PHP_HTTP_API php_http_client_t *php_http_client_init(php_http_client_t *h, php_http_client_ops_t *ops, php_resource_factory_t *rf, void *init_arg TSRMLS_DC);
@@ -145,6 +186,10 @@ PHP_HTTP_API ZEND_RESULT_CODE php_http_client_getopt(php_http_client_t *h, php_h
 typedef int (*php_http_client_enqueue_cmp_func_t)(php_http_client_enqueue_t *cmp, void *arg);
 /* compare with request message pointer if compare_func is NULL */
 PHP_HTTP_API php_http_client_enqueue_t *php_http_client_enqueued(php_http_client_t *h, void *compare_arg, php_http_client_enqueue_cmp_func_t compare_func);
+/* for drivers: add/remove an enqueued request to/from the queue and its lookup index, find it by driver handle */
+PHP_HTTP_API php_http_client_enqueue_t *php_http_client_enqueued_add(php_http_client_t *h, php_http_client_enqueue_t *enqueue, void *handle);
+PHP_HTTP_API void php_http_client_enqueued_del(php_http_client_t *h, php_http_client_enqueue_t *enqueue, void *handle);
+PHP_HTTP_API php_http_client_enqueue_t *php_http_client_enqueued_handle(php_http_client_t *h, void *handle);
 
 PHP_MINIT_FUNCTION(http_client);
 PHP_MSHUTDOWN_FUNCTION(http_client);
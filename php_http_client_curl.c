@@ -36,6 +36,22 @@
 #	endif
 #endif
 
+#if PHP_HTTP_HAVE_EPOLL
+#	include <sys/epoll.h>
+#	ifndef PHP_HTTP_CURLM_EPOLL_EVENTS
+#		define PHP_HTTP_CURLM_EPOLL_EVENTS 256
+#	endif
+#endif
+
+#ifndef PHP_HTTP_CURLE_BODY_MEMORY_LIMIT
+#	define PHP_HTTP_CURLE_BODY_MEMORY_LIMIT 0x200000
+#endif
+
+/* latency histograms: 2^5 linear sub-buckets per power of two microseconds */
+#define PHP_HTTP_CURLE_LATENCY_SUB_BITS 5
+#define PHP_HTTP_CURLE_LATENCY_SUB_COUNT (1 << PHP_HTTP_CURLE_LATENCY_SUB_BITS)
+#define PHP_HTTP_CURLE_LATENCY_BUCKETS ((32 - PHP_HTTP_CURLE_LATENCY_SUB_BITS + 1) << PHP_HTTP_CURLE_LATENCY_SUB_BITS)
+
 #ifdef PHP_HTTP_HAVE_OPENSSL
 #	include <openssl/ssl.h>
 #endif
@@ -43,6 +59,28 @@
 #	include <gnutls.h>
 #endif
 
+typedef enum php_http_curle_phase {
+	PHP_HTTP_CURLE_PHASE_NAMELOOKUP,
+	PHP_HTTP_CURLE_PHASE_CONNECT,
+	PHP_HTTP_CURLE_PHASE_APPCONNECT,
+	PHP_HTTP_CURLE_PHASE_PRETRANSFER,
+	PHP_HTTP_CURLE_PHASE_STARTTRANSFER,
+	PHP_HTTP_CURLE_PHASE_TOTAL,
+	PHP_HTTP_CURLE_PHASES
+} php_http_curle_phase_t;
+
+typedef struct php_http_curle_histogram {
+	unsigned long count;
+	unsigned long min;
+	unsigned long max;
+	double sum;
+	unsigned buckets[PHP_HTTP_CURLE_LATENCY_BUCKETS];
+} php_http_curle_histogram_t;
+
+typedef struct php_http_client_curl_latency {
+	php_http_curle_histogram_t phase[PHP_HTTP_CURLE_PHASES];
+} php_http_client_curl_latency_t;
+
 typedef struct php_http_client_curl {
 	CURLM *handle;
 
@@ -53,8 +91,46 @@ typedef struct php_http_client_curl {
 	struct event *timeout;
 	unsigned useevents:1;
 #endif
+#if PHP_HTTP_HAVE_EPOLL
+	struct {
+		int fd;
+		struct timeval deadline;
+	} epoll;
+	unsigned useepoll:1;
+#endif
+	/* progress throttling */
+	struct {
+		double interval;
+		long delta;
+	} progress;
+	/* "host:port" => php_http_client_curl_stats_t, only kept with pool_stats */
+	HashTable stats;
+	unsigned poolstats:1;
+	/* per phase latency histograms */
+	struct {
+		php_http_client_curl_latency_t *all;
+		unsigned enabled:1;
+		unsigned by_host:1;
+	} latency;
 } php_http_client_curl_t;
 
+typedef struct php_http_client_curl_stats {
+	long requests;
+	struct {
+		long hits;
+		long misses;
+	} handles;
+	struct {
+		long created;
+		long reused;
+	} connections;
+	struct {
+		long handshakes;
+		long resumed;
+	} tls;
+	php_http_client_curl_latency_t *latency;
+} php_http_client_curl_stats_t;
+
 typedef struct php_http_client_curl_handler {
 	CURL *handle;
 	php_resource_factory_t *rf;
@@ -62,9 +138,24 @@ typedef struct php_http_client_curl_handler {
 	php_http_client_progress_state_t progress;
 	php_http_client_enqueue_t queue;
 
+	php_http_client_curl_stats_t *stats;
+
+	/* redirects followed so far, see php_http_curle_progress_info() */
+	long redirects;
+
+	/* last progress notification */
+	struct {
+		struct timeval time;
+		double dl;
+		double ul;
+	} notified;
+
 	struct {
 		php_http_buffer_t headers;
+		php_http_header_parser_t parser;
+		php_http_message_t *message; /* parsed as the header lines arrive */
 		php_http_message_body_t *body;
+		php_stream *sink;
 	} response;
 
 	struct {
@@ -94,6 +185,8 @@ typedef struct php_http_curle_storage {
 	char *cookiestore;
 	CURLcode errorcode;
 	char errorbuffer[0x100];
+	/* number of transfers the handle has been acquired for */
+	unsigned long uses;
 } php_http_curle_storage_t;
 
 static inline php_http_curle_storage_t *php_http_curle_get_storage(CURL *ch) {
@@ -189,6 +282,93 @@ static size_t php_http_curle_read_callback(void *data, size_t len, size_t n, voi
 	return 0;
 }
 
+/* derive the transfer phase from libcurl's timing info, which is only set once a phase has completed */
+static const char *php_http_curle_progress_info(php_http_client_curl_handler_t *h)
+{
+	double t = 0;
+	long redirects = 0;
+
+	/* a followed redirect is a phase of its own, once */
+	if (CURLE_OK == curl_easy_getinfo(h->handle, CURLINFO_REDIRECT_COUNT, &redirects) && redirects > h->redirects) {
+		h->redirects = redirects;
+		return "redirect";
+	}
+	if (CURLE_OK == curl_easy_getinfo(h->handle, CURLINFO_STARTTRANSFER_TIME, &t) && t > 0) {
+		return "receive";
+	}
+	if (CURLE_OK == curl_easy_getinfo(h->handle, CURLINFO_PRETRANSFER_TIME, &t) && t > 0) {
+		if (h->progress.ul.total > 0 && h->progress.ul.now >= h->progress.ul.total) {
+			return "uploaded";
+		}
+		return "send";
+	}
+	if (CURLE_OK == curl_easy_getinfo(h->handle, CURLINFO_CONNECT_TIME, &t) && t > 0) {
+#if PHP_HTTP_CURL_VERSION(7,19,0)
+		php_http_curle_storage_t *st = php_http_curle_get_storage(h->handle);
+
+		if (st->url && !strncasecmp(st->url, "https:", lenof("https:"))
+		&&	CURLE_OK == curl_easy_getinfo(h->handle, CURLINFO_APPCONNECT_TIME, &t) && t <= 0
+		) {
+			return "ssl negotiation";
+		}
+#endif
+		return "connected";
+	}
+	if (CURLE_OK == curl_easy_getinfo(h->handle, CURLINFO_NAMELOOKUP_TIME, &t) && t > 0) {
+		return "connect";
+	}
+	if (h->progress.started) {
+		return "resolve";
+	}
+	return h->progress.info;
+}
+
+/* whether the connection survived the transfer, which libcurl only knows while it is still cached */
+static const char *php_http_curle_progress_done(php_http_client_curl_handler_t *h, CURLcode result)
+{
+#if PHP_HTTP_CURL_VERSION(7,45,0)
+	curl_socket_t sock = CURL_SOCKET_BAD;
+
+	if (CURLE_OPERATION_TIMEDOUT != result && CURLE_OK == curl_easy_getinfo(h->handle, CURLINFO_ACTIVESOCKET, &sock) && sock != CURL_SOCKET_BAD) {
+		return "not disconnected";
+	}
+#else
+	long sock = -1;
+
+	if (CURLE_OPERATION_TIMEDOUT != result && CURLE_OK == curl_easy_getinfo(h->handle, CURLINFO_LASTSOCKET, &sock) && sock != -1) {
+		return "not disconnected";
+	}
+#endif
+	return CURLE_OPERATION_TIMEDOUT == result ? "timeout" : "disconnected";
+}
+
+static zend_bool php_http_curle_progress_due(php_http_client_curl_handler_t *h)
+{
+	php_http_client_curl_t *curl = h->client->ctx;
+
+	/* always report completion */
+	if (h->progress.dl.total > 0 && h->progress.dl.now >= h->progress.dl.total) {
+		return 1;
+	}
+	if (curl->progress.delta > 0) {
+		double delta = (h->progress.dl.now - h->notified.dl) + (h->progress.ul.now - h->notified.ul);
+
+		if (delta < curl->progress.delta) {
+			return 0;
+		}
+	}
+	if (curl->progress.interval > 0) {
+		struct timeval now, diff;
+
+		gettimeofday(&now, NULL);
+		timersub(&now, &h->notified.time, &diff);
+		if (diff.tv_sec + (double) diff.tv_usec / PHP_HTTP_MCROSEC < curl->progress.interval) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
 #if PHP_HTTP_CURL_VERSION(7,32,0)
 static int php_http_curle_xferinfo_callback(void *ctx, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow)
 #else
@@ -211,8 +391,24 @@ static int php_http_curle_progress_callback(void *ctx, double dltotal, double dl
 		h->progress.ul.now = ulnow;
 	}
 
-	if (update && h->client->callback.progress.func) {
-		h->client->callback.progress.func(h->client->callback.progress.arg, h->client, &h->queue, &h->progress);
+	if (h->client->callback.progress.func) {
+		const char *info = php_http_curle_progress_info(h);
+		zend_bool notify = 0;
+
+		/* phase changes are always reported, byte counts may be throttled */
+		if (info != h->progress.info) {
+			h->progress.info = info;
+			notify = 1;
+		} else if (update) {
+			notify = php_http_curle_progress_due(h);
+		}
+		if (notify) {
+			gettimeofday(&h->notified.time, NULL);
+			h->notified.dl = h->progress.dl.now;
+			h->notified.ul = h->progress.ul.now;
+
+			h->client->callback.progress.func(h->client->callback.progress.arg, h->client, &h->queue, &h->progress);
+		}
 	}
 
 	return 0;
@@ -235,317 +431,437 @@ static int php_http_curle_seek_callback(void *userdata, curl_off_t offset, int o
 static int php_http_curle_raw_callback(CURL *ch, curl_infotype type, char *data, size_t length, void *ctx)
 {
 	php_http_client_curl_handler_t *h = ctx;
+	unsigned flags = 0;
 
-	/* catch progress */
 	switch (type) {
 		case CURLINFO_TEXT:
-			if (data[0] == '-') {
-			} else if (php_memnstr(data, ZEND_STRL("Adding handle:"), data + length)) {
-				h->progress.info = "setup";
-			} else if (php_memnstr(data, ZEND_STRL("addHandle"), data + length)) {
-				h->progress.info = "setup";
-			} else if (php_memnstr(data, ZEND_STRL("About to connect"), data + length)) {
-				h->progress.info = "resolve";
-			} else if (php_memnstr(data, ZEND_STRL("Trying"), data + length)) {
-				h->progress.info = "connect";
-			} else if (php_memnstr(data, ZEND_STRL("Found bundle for host"), data + length)) {
-				h->progress.info = "connect";
-			} else if (php_memnstr(data, ZEND_STRL("Connected"), data + length)) {
-				h->progress.info = "connected";
-			} else if (php_memnstr(data, ZEND_STRL("Re-using existing connection!"), data + length)) {
-				h->progress.info = "connected";
-			} else if (php_memnstr(data, ZEND_STRL("blacklisted"), data + length)) {
-				h->progress.info = "blacklist check";
-			} else if (php_memnstr(data, ZEND_STRL("SSL"), data + length)) {
-				h->progress.info = "ssl negotiation";
-			} else if (php_memnstr(data, ZEND_STRL("upload"), data + length)) {
-				h->progress.info = "uploaded";
-			} else if (php_memnstr(data, ZEND_STRL("left intact"), data + length)) {
-				h->progress.info = "not disconnected";
-			} else if (php_memnstr(data, ZEND_STRL("closed"), data + length)) {
-				h->progress.info = "disconnected";
-			} else if (php_memnstr(data, ZEND_STRL("Issue another request"), data + length)) {
-				h->progress.info = "redirect";
-			} else if (php_memnstr(data, ZEND_STRL("Operation timed out"), data + length)) {
-				h->progress.info = "timeout";
-			} else {
-#if 0
-				h->progress.info = data;
-				data[length - 1] = '\0';
-#endif
-			}
-			if (h->client->callback.progress.func) {
-				h->client->callback.progress.func(h->client->callback.progress.arg, h->client, &h->queue, &h->progress);
-			}
+			flags = PHP_HTTP_CLIENT_DEBUG_INFO;
 			break;
 		case CURLINFO_HEADER_OUT:
+			flags = PHP_HTTP_CLIENT_DEBUG_OUT|PHP_HTTP_CLIENT_DEBUG_HEADER;
+			break;
 		case CURLINFO_DATA_OUT:
+			flags = PHP_HTTP_CLIENT_DEBUG_OUT|PHP_HTTP_CLIENT_DEBUG_BODY;
+			break;
 		case CURLINFO_SSL_DATA_OUT:
-			h->progress.info = "send";
+			flags = PHP_HTTP_CLIENT_DEBUG_OUT|PHP_HTTP_CLIENT_DEBUG_SSL;
 			break;
 		case CURLINFO_HEADER_IN:
+			flags = PHP_HTTP_CLIENT_DEBUG_IN|PHP_HTTP_CLIENT_DEBUG_HEADER;
+			break;
 		case CURLINFO_DATA_IN:
+			flags = PHP_HTTP_CLIENT_DEBUG_IN|PHP_HTTP_CLIENT_DEBUG_BODY;
+			break;
 		case CURLINFO_SSL_DATA_IN:
-			h->progress.info = "receive";
+			flags = PHP_HTTP_CLIENT_DEBUG_IN|PHP_HTTP_CLIENT_DEBUG_SSL;
 			break;
 		default:
-			break;
+			return 0;
 	}
 
-#if 0
-	/* debug */
-	_dpf(type, data, length);
-#endif
+	if (h->client->callback.debug.func) {
+		h->client->callback.debug.func(h->client->callback.debug.arg, h->client, &h->queue, flags, data, length);
+	}
 
 	return 0;
 }
 
+/* rename the headers describing the transfer, once a header block is complete */
+static void php_http_curle_response_headers(php_http_message_t *response)
+{
+	zval *zh;
+
+	if ((zh = php_http_message_header(response, ZEND_STRL("Content-Length"), 1))) {
+		zend_hash_update(&response->hdrs, "X-Original-Content-Length", sizeof("X-Original-Content-Length"), &zh, sizeof(zval *), NULL);
+	}
+	if ((zh = php_http_message_header(response, ZEND_STRL("Transfer-Encoding"), 0))) {
+		zend_hash_update(&response->hdrs, "X-Original-Transfer-Encoding", sizeof("X-Original-Transfer-Encoding"), (void *) &zh, sizeof(zval *), NULL);
+		zend_hash_del(&response->hdrs, "Transfer-Encoding", sizeof("Transfer-Encoding"));
+	}
+	if ((zh = php_http_message_header(response, ZEND_STRL("Content-Range"), 0))) {
+		zend_hash_update(&response->hdrs, "X-Original-Content-Range", sizeof("X-Original-Content-Range"), &zh, sizeof(zval *), NULL);
+		zend_hash_del(&response->hdrs, "Content-Range", sizeof("Content-Range"));
+	}
+	if ((zh = php_http_message_header(response, ZEND_STRL("Content-Encoding"), 0))) {
+		zend_hash_update(&response->hdrs, "X-Original-Content-Encoding", sizeof("X-Original-Content-Encoding"), &zh, sizeof(zval *), NULL);
+		zend_hash_del(&response->hdrs, "Content-Encoding", sizeof("Content-Encoding"));
+	}
+}
+
 static int php_http_curle_header_callback(char *data, size_t n, size_t l, void *arg)
 {
 	php_http_client_curl_handler_t *h = arg;
+	size_t len = n * l;
+	TSRMLS_FETCH_FROM_CTX(h->client->ts);
 
-	return php_http_buffer_append(&h->response.headers, data, n * l);
+	if (PHP_HTTP_HEADER_PARSER_STATE_FAILURE == php_http_header_parser_state_is(&h->response.parser)) {
+		/* already complained */
+		return len;
+	}
+	if (!h->response.message) {
+		h->response.message = php_http_message_init(NULL, 0, h->response.body TSRMLS_CC);
+	}
+
+	/* curl passes complete header lines, so parse them right away */
+	php_http_buffer_append(&h->response.headers, data, len);
+	if (PHP_HTTP_HEADER_PARSER_STATE_DONE == php_http_header_parser_parse(&h->response.parser,
+			&h->response.headers, 0, &h->response.message->hdrs,
+			(php_http_info_callback_t) php_http_message_info_callback, (void *) &h->response.message)) {
+		php_http_curle_response_headers(h->response.message);
+	}
+
+	return len;
 }
 
 static int php_http_curle_body_callback(char *data, size_t n, size_t l, void *arg)
 {
 	php_http_client_curl_handler_t *h = arg;
 
+	if (h->response.sink) {
+		TSRMLS_FETCH_FROM_CTX(h->client->ts);
+
+		return php_http_message_body_sink_append(h->response.sink, data, n*l TSRMLS_CC);
+	}
 	return php_http_message_body_append(h->response.body, data, n*l);
 }
 
-static ZEND_RESULT_CODE php_http_curle_get_info(CURL *ch, HashTable *info)
-{
-	char *c;
-	long l;
-	double d;
-	struct curl_slist *s, *p;
-	zval *subarray, array;
-	INIT_PZVAL_ARRAY(&array, info);
-
+static const struct php_http_curle_info_entry {
+	const char *name;
+	size_t size;
+	CURLINFO info;
+} php_http_curle_info_entries[] = {
 	/* BEGIN::CURLINFO */
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_EFFECTIVE_URL, &c)) {
-		add_assoc_string_ex(&array, "effective_url", sizeof("effective_url"), c ? c : "", 1);
-	}
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_RESPONSE_CODE, &l)) {
-		add_assoc_long_ex(&array, "response_code", sizeof("response_code"), l);
-	}
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_TOTAL_TIME, &d)) {
-		add_assoc_double_ex(&array, "total_time", sizeof("total_time"), d);
-	}
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_NAMELOOKUP_TIME, &d)) {
-		add_assoc_double_ex(&array, "namelookup_time", sizeof("namelookup_time"), d);
-	}
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_CONNECT_TIME, &d)) {
-		add_assoc_double_ex(&array, "connect_time", sizeof("connect_time"), d);
-	}
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_PRETRANSFER_TIME, &d)) {
-		add_assoc_double_ex(&array, "pretransfer_time", sizeof("pretransfer_time"), d);
-	}
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_SIZE_UPLOAD, &d)) {
-		add_assoc_double_ex(&array, "size_upload", sizeof("size_upload"), d);
-	}
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_SIZE_DOWNLOAD, &d)) {
-		add_assoc_double_ex(&array, "size_download", sizeof("size_download"), d);
-	}
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_SPEED_DOWNLOAD, &d)) {
-		add_assoc_double_ex(&array, "speed_download", sizeof("speed_download"), d);
-	}
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_SPEED_UPLOAD, &d)) {
-		add_assoc_double_ex(&array, "speed_upload", sizeof("speed_upload"), d);
-	}
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_HEADER_SIZE, &l)) {
-		add_assoc_long_ex(&array, "header_size", sizeof("header_size"), l);
-	}
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_REQUEST_SIZE, &l)) {
-		add_assoc_long_ex(&array, "request_size", sizeof("request_size"), l);
-	}
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_SSL_VERIFYRESULT, &l)) {
-		add_assoc_long_ex(&array, "ssl_verifyresult", sizeof("ssl_verifyresult"), l);
-	}
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_FILETIME, &l)) {
-		add_assoc_long_ex(&array, "filetime", sizeof("filetime"), l);
-	}
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_CONTENT_LENGTH_DOWNLOAD, &d)) {
-		add_assoc_double_ex(&array, "content_length_download", sizeof("content_length_download"), d);
-	}
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_CONTENT_LENGTH_UPLOAD, &d)) {
-		add_assoc_double_ex(&array, "content_length_upload", sizeof("content_length_upload"), d);
-	}
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_STARTTRANSFER_TIME, &d)) {
-		add_assoc_double_ex(&array, "starttransfer_time", sizeof("starttransfer_time"), d);
-	}
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_CONTENT_TYPE, &c)) {
-		add_assoc_string_ex(&array, "content_type", sizeof("content_type"), c ? c : "", 1);
-	}
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_REDIRECT_TIME, &d)) {
-		add_assoc_double_ex(&array, "redirect_time", sizeof("redirect_time"), d);
-	}
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_REDIRECT_COUNT, &l)) {
-		add_assoc_long_ex(&array, "redirect_count", sizeof("redirect_count"), l);
-	}
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_HTTP_CONNECTCODE, &l)) {
-		add_assoc_long_ex(&array, "connect_code", sizeof("connect_code"), l);
-	}
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_HTTPAUTH_AVAIL, &l)) {
-		add_assoc_long_ex(&array, "httpauth_avail", sizeof("httpauth_avail"), l);
-	}
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_PROXYAUTH_AVAIL, &l)) {
-		add_assoc_long_ex(&array, "proxyauth_avail", sizeof("proxyauth_avail"), l);
-	}
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_OS_ERRNO, &l)) {
-		add_assoc_long_ex(&array, "os_errno", sizeof("os_errno"), l);
-	}
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_NUM_CONNECTS, &l)) {
-		add_assoc_long_ex(&array, "num_connects", sizeof("num_connects"), l);
-	}
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_SSL_ENGINES, &s)) {
-		MAKE_STD_ZVAL(subarray);
-		array_init(subarray);
-		for (p = s; p; p = p->next) {
-			if (p->data) {
-				add_next_index_string(subarray, p->data, 1);
-			}
-		}
-		add_assoc_zval_ex(&array, "ssl_engines", sizeof("ssl_engines"), subarray);
-		curl_slist_free_all(s);
-	}
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_REDIRECT_URL, &c)) {
-		add_assoc_string_ex(&array, "redirect_url", sizeof("redirect_url"), c ? c : "", 1);
-	}
+	{ZEND_STRS("effective_url"), CURLINFO_EFFECTIVE_URL},
+	{ZEND_STRS("response_code"), CURLINFO_RESPONSE_CODE},
+	{ZEND_STRS("total_time"), CURLINFO_TOTAL_TIME},
+	{ZEND_STRS("namelookup_time"), CURLINFO_NAMELOOKUP_TIME},
+	{ZEND_STRS("connect_time"), CURLINFO_CONNECT_TIME},
+	{ZEND_STRS("pretransfer_time"), CURLINFO_PRETRANSFER_TIME},
+	{ZEND_STRS("size_upload"), CURLINFO_SIZE_UPLOAD},
+	{ZEND_STRS("size_download"), CURLINFO_SIZE_DOWNLOAD},
+	{ZEND_STRS("speed_download"), CURLINFO_SPEED_DOWNLOAD},
+	{ZEND_STRS("speed_upload"), CURLINFO_SPEED_UPLOAD},
+	{ZEND_STRS("header_size"), CURLINFO_HEADER_SIZE},
+	{ZEND_STRS("request_size"), CURLINFO_REQUEST_SIZE},
+	{ZEND_STRS("ssl_verifyresult"), CURLINFO_SSL_VERIFYRESULT},
+	{ZEND_STRS("filetime"), CURLINFO_FILETIME},
+	{ZEND_STRS("content_length_download"), CURLINFO_CONTENT_LENGTH_DOWNLOAD},
+	{ZEND_STRS("content_length_upload"), CURLINFO_CONTENT_LENGTH_UPLOAD},
+	{ZEND_STRS("starttransfer_time"), CURLINFO_STARTTRANSFER_TIME},
+	{ZEND_STRS("content_type"), CURLINFO_CONTENT_TYPE},
+	{ZEND_STRS("redirect_time"), CURLINFO_REDIRECT_TIME},
+	{ZEND_STRS("redirect_count"), CURLINFO_REDIRECT_COUNT},
+	{ZEND_STRS("connect_code"), CURLINFO_HTTP_CONNECTCODE},
+	{ZEND_STRS("httpauth_avail"), CURLINFO_HTTPAUTH_AVAIL},
+	{ZEND_STRS("proxyauth_avail"), CURLINFO_PROXYAUTH_AVAIL},
+	{ZEND_STRS("os_errno"), CURLINFO_OS_ERRNO},
+	{ZEND_STRS("num_connects"), CURLINFO_NUM_CONNECTS},
+	{ZEND_STRS("ssl_engines"), CURLINFO_SSL_ENGINES},
+	{ZEND_STRS("redirect_url"), CURLINFO_REDIRECT_URL},
 #if PHP_HTTP_CURL_VERSION(7,19,0)
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_PRIMARY_IP, &c)) {
-		add_assoc_string_ex(&array, "primary_ip", sizeof("primary_ip"), c ? c : "", 1);
-	}
+	{ZEND_STRS("primary_ip"), CURLINFO_PRIMARY_IP},
 #endif
 #if PHP_HTTP_CURL_VERSION(7,19,0)
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_APPCONNECT_TIME, &d)) {
-		add_assoc_double_ex(&array, "appconnect_time", sizeof("appconnect_time"), d);
-	}
+	{ZEND_STRS("appconnect_time"), CURLINFO_APPCONNECT_TIME},
 #endif
 #if PHP_HTTP_CURL_VERSION(7,19,4)
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_CONDITION_UNMET, &l)) {
-		add_assoc_long_ex(&array, "condition_unmet", sizeof("condition_unmet"), l);
-	}
+	{ZEND_STRS("condition_unmet"), CURLINFO_CONDITION_UNMET},
 #endif
 #if PHP_HTTP_CURL_VERSION(7,21,0)
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_PRIMARY_PORT, &l)) {
-		add_assoc_long_ex(&array, "primary_port", sizeof("primary_port"), l);
-	}
+	{ZEND_STRS("primary_port"), CURLINFO_PRIMARY_PORT},
 #endif
 #if PHP_HTTP_CURL_VERSION(7,21,0)
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_LOCAL_IP, &c)) {
-		add_assoc_string_ex(&array, "local_ip", sizeof("local_ip"), c ? c : "", 1);
-	}
+	{ZEND_STRS("local_ip"), CURLINFO_LOCAL_IP},
 #endif
 #if PHP_HTTP_CURL_VERSION(7,21,0)
-	if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_LOCAL_PORT, &l)) {
-		add_assoc_long_ex(&array, "local_port", sizeof("local_port"), l);
+	{ZEND_STRS("local_port"), CURLINFO_LOCAL_PORT},
+#endif
+	/* END::CURLINFO */
+};
+
+#define PHP_HTTP_CURLE_INFO_ENTRIES (sizeof(php_http_curle_info_entries)/sizeof(php_http_curle_info_entries[0]))
+
+/* snapshot of the transfer info of a finished transfer, strings are stored right after the struct */
+typedef struct php_http_curle_info {
+	php_http_client_transfer_info_t ti;
+
+	struct {
+		unsigned avail:1;
+		union {
+			long l;
+			double d;
+			char *s;
+			struct curl_slist *sl;
+		} val;
+	} entries[PHP_HTTP_CURLE_INFO_ENTRIES];
+
+	struct {
+		unsigned avail:1;
+		unsigned internals:1;
+		const char *backend;
+#ifdef PHP_HTTP_HAVE_OPENSSL
+		long number, connect, connect_good, connect_renegotiate, hits, cache_full;
+#endif
+#ifdef PHP_HTTP_HAVE_GNUTLS
+		char *desc;
+		zend_bool resumed;
+#endif
+	} tls;
+
+	zval *certinfo;
+	CURLcode errorcode;
+	char *error;
+} php_http_curle_info_t;
+
+#if PHP_HTTP_CURL_VERSION(7,34,0)
+static inline const char *php_http_curle_tls_backend(curl_sslbackend backend)
+{
+	switch (backend) {
+	case CURLSSLBACKEND_NONE:
+		return "none";
+	case CURLSSLBACKEND_OPENSSL:
+		return "openssl";
+	case CURLSSLBACKEND_GNUTLS:
+		return "gnutls";
+	case CURLSSLBACKEND_NSS:
+		return "nss";
+#if !PHP_HTTP_CURL_VERSION(7,39,0)
+	case CURLSSLBACKEND_QSOSSL:
+		return "qsossl";
+#else
+	case CURLSSLBACKEND_GSKIT:
+		return "gskit";
+#endif
+	case CURLSSLBACKEND_POLARSSL:
+		return "polarssl";
+	case CURLSSLBACKEND_CYASSL:
+		return "cyassl";
+	case CURLSSLBACKEND_SCHANNEL:
+		return "schannel";
+	case CURLSSLBACKEND_DARWINSSL:
+		return "darwinssl";
+	default:
+		return "unknown";
 	}
+}
 #endif
 
-	/* END::CURLINFO */
+static void php_http_curle_info_fill(php_http_client_transfer_info_t *ti, HashTable *info)
+{
+	php_http_curle_info_t *ci = (php_http_curle_info_t *) ti;
+	struct curl_slist *p;
+	zval *subarray, array;
+	unsigned i;
+
+	INIT_PZVAL_ARRAY(&array, info);
+
+	for (i = 0; i < PHP_HTTP_CURLE_INFO_ENTRIES; ++i) {
+		const struct php_http_curle_info_entry *e = &php_http_curle_info_entries[i];
+
+		if (!ci->entries[i].avail) {
+			continue;
+		}
+		switch (e->info & CURLINFO_TYPEMASK) {
+		case CURLINFO_STRING:
+			add_assoc_string_ex(&array, e->name, e->size, ci->entries[i].val.s, 1);
+			break;
+		case CURLINFO_LONG:
+			add_assoc_long_ex(&array, e->name, e->size, ci->entries[i].val.l);
+			break;
+		case CURLINFO_DOUBLE:
+			add_assoc_double_ex(&array, e->name, e->size, ci->entries[i].val.d);
+			break;
+		case CURLINFO_SLIST:
+			MAKE_STD_ZVAL(subarray);
+			array_init(subarray);
+			for (p = ci->entries[i].val.sl; p; p = p->next) {
+				if (p->data) {
+					add_next_index_string(subarray, p->data, 1);
+				}
+			}
+			add_assoc_zval_ex(&array, e->name, e->size, subarray);
+			break;
+		}
+	}
+
+	if (ci->tls.avail) {
+		zval *ti_array;
+
+		MAKE_STD_ZVAL(subarray);
+		ZVAL_NULL(subarray);
+		MAKE_STD_ZVAL(ti_array);
+		array_init(ti_array);
+
+		if (ci->tls.internals) {
+			array_init(subarray);
+#ifdef PHP_HTTP_HAVE_OPENSSL
+			if (!strcmp(ci->tls.backend, "openssl")) {
+				add_assoc_long_ex(subarray, ZEND_STRS("number"), ci->tls.number);
+				add_assoc_long_ex(subarray, ZEND_STRS("connect"), ci->tls.connect);
+				add_assoc_long_ex(subarray, ZEND_STRS("connect_good"), ci->tls.connect_good);
+				add_assoc_long_ex(subarray, ZEND_STRS("connect_renegotiate"), ci->tls.connect_renegotiate);
+				add_assoc_long_ex(subarray, ZEND_STRS("hits"), ci->tls.hits);
+				add_assoc_long_ex(subarray, ZEND_STRS("cache_full"), ci->tls.cache_full);
+			}
+#endif
+#ifdef PHP_HTTP_HAVE_GNUTLS
+			if (!strcmp(ci->tls.backend, "gnutls")) {
+				if (ci->tls.desc) {
+					add_assoc_string_ex(subarray, ZEND_STRS("desc"), ci->tls.desc, 1);
+				}
+				add_assoc_bool_ex(subarray, ZEND_STRS("resumed"), ci->tls.resumed);
+			}
+#endif
+		}
+		add_assoc_string_ex(ti_array, ZEND_STRS("backend"), (char *) ci->tls.backend, 1);
+		add_assoc_zval_ex(ti_array, ZEND_STRS("internals"), subarray);
+		add_assoc_zval_ex(&array, "tls_session", sizeof("tls_session"), ti_array);
+	}
+
+#if (PHP_HTTP_CURL_VERSION(7,19,1) && defined(PHP_HTTP_HAVE_OPENSSL)) || (PHP_HTTP_CURL_VERSION(7,34,0) && defined(PHP_HTTP_HAVE_NSS)) || (PHP_HTTP_CURL_VERSION(7,42,0) && defined(PHP_HTTP_HAVE_GNUTLS)) || (PHP_HTTP_CURL_VERSION(7,39,0) && defined(PHP_HTTP_HAVE_GSKIT))
+	if (ci->certinfo) {
+		Z_ADDREF_P(ci->certinfo);
+		add_assoc_zval_ex(&array, "certinfo", sizeof("certinfo"), ci->certinfo);
+	} else {
+		MAKE_STD_ZVAL(subarray);
+		array_init(subarray);
+		add_assoc_zval_ex(&array, "certinfo", sizeof("certinfo"), subarray);
+	}
+#endif
+
+	add_assoc_long_ex(&array, "curlcode", sizeof("curlcode"), ci->errorcode);
+	add_assoc_string_ex(&array, "error", sizeof("error"), ci->error, 1);
+}
+
+static void php_http_curle_info_dtor(php_http_client_transfer_info_t *ti)
+{
+	php_http_curle_info_t *ci = (php_http_curle_info_t *) ti;
+	unsigned i;
+
+	for (i = 0; i < PHP_HTTP_CURLE_INFO_ENTRIES; ++i) {
+		if (ci->entries[i].avail && (php_http_curle_info_entries[i].info & CURLINFO_TYPEMASK) == CURLINFO_SLIST) {
+			curl_slist_free_all(ci->entries[i].val.sl);
+		}
+	}
+	if (ci->certinfo) {
+		zval_ptr_dtor(&ci->certinfo);
+	}
+	efree(ci);
+}
+
+static inline char *php_http_curle_info_strcpy(char **tail, const char *str)
+{
+	char *copy = *tail;
+	size_t len = strlen(str) + 1;
+
+	memcpy(copy, str, len);
+	*tail += len;
+	return copy;
+}
+
+/* capture the transfer info with one allocation, without building any zvals */
+static php_http_curle_info_t *php_http_curle_info_snapshot(CURL *ch)
+{
+	php_http_curle_info_t tmp, *ci;
+	php_http_curle_storage_t *st = php_http_curle_get_storage(ch);
+	size_t strlens = strlen(st->errorbuffer) + 1;
+	char *tail;
+	unsigned i;
+
+	memset(&tmp, 0, sizeof(tmp));
+
+	for (i = 0; i < PHP_HTTP_CURLE_INFO_ENTRIES; ++i) {
+		CURLINFO info = php_http_curle_info_entries[i].info;
+		void *ptr;
+
+		switch (info & CURLINFO_TYPEMASK) {
+		case CURLINFO_STRING:
+			ptr = &tmp.entries[i].val.s;
+			break;
+		case CURLINFO_LONG:
+			ptr = &tmp.entries[i].val.l;
+			break;
+		case CURLINFO_DOUBLE:
+			ptr = &tmp.entries[i].val.d;
+			break;
+		case CURLINFO_SLIST:
+			ptr = &tmp.entries[i].val.sl;
+			break;
+		default:
+			continue;
+		}
+		if (CURLE_OK == curl_easy_getinfo(ch, info, ptr)) {
+			tmp.entries[i].avail = 1;
+			if ((info & CURLINFO_TYPEMASK) == CURLINFO_STRING) {
+				if (!tmp.entries[i].val.s) {
+					tmp.entries[i].val.s = "";
+				}
+				strlens += strlen(tmp.entries[i].val.s) + 1;
+			}
+		}
+	}
 
 #if PHP_HTTP_CURL_VERSION(7,34,0)
 	{
-		zval *ti_array;
 		struct curl_tlssessioninfo *ti;
 
 		if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_TLS_SESSION, &ti)) {
-			const char *backend;
-
-			MAKE_STD_ZVAL(subarray);
-			ZVAL_NULL(subarray);
-			MAKE_STD_ZVAL(ti_array);
-			array_init(ti_array);
+			tmp.tls.avail = 1;
+			tmp.tls.backend = php_http_curle_tls_backend(ti->backend);
 
 			switch (ti->backend) {
-			case CURLSSLBACKEND_NONE:
-				backend = "none";
-				break;
-			case CURLSSLBACKEND_OPENSSL:
-				backend = "openssl";
 #ifdef PHP_HTTP_HAVE_OPENSSL
+			case CURLSSLBACKEND_OPENSSL:
 				{
 					SSL_CTX *ctx = ti->internals;
 
-					array_init(subarray);
-					add_assoc_long_ex(subarray, ZEND_STRS("number"), SSL_CTX_sess_number(ctx));
-					add_assoc_long_ex(subarray, ZEND_STRS("connect"), SSL_CTX_sess_connect(ctx));
-					add_assoc_long_ex(subarray, ZEND_STRS("connect_good"), SSL_CTX_sess_connect_good(ctx));
-					add_assoc_long_ex(subarray, ZEND_STRS("connect_renegotiate"), SSL_CTX_sess_connect_renegotiate(ctx));
-					add_assoc_long_ex(subarray, ZEND_STRS("hits"), SSL_CTX_sess_hits(ctx));
-					add_assoc_long_ex(subarray, ZEND_STRS("cache_full"), SSL_CTX_sess_cache_full(ctx));
+					tmp.tls.internals = 1;
+					tmp.tls.number = SSL_CTX_sess_number(ctx);
+					tmp.tls.connect = SSL_CTX_sess_connect(ctx);
+					tmp.tls.connect_good = SSL_CTX_sess_connect_good(ctx);
+					tmp.tls.connect_renegotiate = SSL_CTX_sess_connect_renegotiate(ctx);
+					tmp.tls.hits = SSL_CTX_sess_hits(ctx);
+					tmp.tls.cache_full = SSL_CTX_sess_cache_full(ctx);
 				}
-#endif
 				break;
-			case CURLSSLBACKEND_GNUTLS:
-				backend = "gnutls";
+#endif
 #ifdef PHP_HTTP_HAVE_GNUTLS
+			case CURLSSLBACKEND_GNUTLS:
 				{
 					gnutls_session_t sess = ti->internals;
-					char *desc;
 
-					array_init(subarray);
-					if ((desc = gnutls_session_get_desc(sess))) {
-						add_assoc_string_ex(subarray, ZEND_STRS("desc"), desc, 1);
-						gnutls_free(desc);
+					tmp.tls.internals = 1;
+					tmp.tls.resumed = gnutls_session_is_resumed(sess);
+					if ((tmp.tls.desc = gnutls_session_get_desc(sess))) {
+						strlens += strlen(tmp.tls.desc) + 1;
 					}
-					add_assoc_bool_ex(subarray, ZEND_STRS("resumed"), gnutls_session_is_resumed(sess));
 				}
-#endif
-				break;
-			case CURLSSLBACKEND_NSS:
-				backend = "nss";
-				break;
-#if !PHP_HTTP_CURL_VERSION(7,39,0)
-			case CURLSSLBACKEND_QSOSSL:
-				backend = "qsossl";
-				break;
-#else
-			case CURLSSLBACKEND_GSKIT:
-				backend = "gskit";
 				break;
 #endif
-			case CURLSSLBACKEND_POLARSSL:
-				backend = "polarssl";
-				break;
-			case CURLSSLBACKEND_CYASSL:
-				backend = "cyassl";
-				break;
-			case CURLSSLBACKEND_SCHANNEL:
-				backend = "schannel";
-				break;
-			case CURLSSLBACKEND_DARWINSSL:
-				backend = "darwinssl";
-				break;
 			default:
-				backend = "unknown";
+				break;
 			}
-			add_assoc_string_ex(ti_array, ZEND_STRS("backend"), estrdup(backend), 0);
-			add_assoc_zval_ex(ti_array, ZEND_STRS("internals"), subarray);
-			add_assoc_zval_ex(&array, "tls_session", sizeof("tls_session"), ti_array);
 		}
 	}
 #endif
 
 #if (PHP_HTTP_CURL_VERSION(7,19,1) && defined(PHP_HTTP_HAVE_OPENSSL)) || (PHP_HTTP_CURL_VERSION(7,34,0) && defined(PHP_HTTP_HAVE_NSS)) || (PHP_HTTP_CURL_VERSION(7,42,0) && defined(PHP_HTTP_HAVE_GNUTLS)) || (PHP_HTTP_CURL_VERSION(7,39,0) && defined(PHP_HTTP_HAVE_GSKIT))
 	{
-		int i;
-		zval *ci_array;
-		struct curl_certinfo *ci;
+		int c;
+		zval *subarray;
+		struct curl_certinfo *certs;
+		struct curl_slist *p;
 		char *colon, *keyname;
 
-		if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_CERTINFO, &ci)) {
-			MAKE_STD_ZVAL(ci_array);
-			array_init(ci_array);
-
-			for (i = 0; i < ci->num_of_certs; ++i) {
-				s = ci->certinfo[i];
+		/* only there if the certinfo option was set, so rather build it right away */
+		if (CURLE_OK == curl_easy_getinfo(ch, CURLINFO_CERTINFO, &certs) && certs && certs->num_of_certs > 0) {
+			MAKE_STD_ZVAL(tmp.certinfo);
+			array_init(tmp.certinfo);
 
+			for (c = 0; c < certs->num_of_certs; ++c) {
 				MAKE_STD_ZVAL(subarray);
 				array_init(subarray);
-				for (p = s; p; p = p->next) {
+				for (p = certs->certinfo[c]; p; p = p->next) {
 					if (p->data) {
 						if ((colon = strchr(p->data, ':'))) {
 							keyname = estrndup(p->data, colon - p->data);
@@ -556,44 +872,69 @@ static ZEND_RESULT_CODE php_http_curle_get_info(CURL *ch, HashTable *info)
 						}
 					}
 				}
-				add_next_index_zval(ci_array, subarray);
+				add_next_index_zval(tmp.certinfo, subarray);
 			}
-			add_assoc_zval_ex(&array, "certinfo", sizeof("certinfo"), ci_array);
 		}
 	}
 #endif
-	{
-		php_http_curle_storage_t *st = php_http_curle_get_storage(ch);
 
-		add_assoc_long_ex(&array, "curlcode", sizeof("curlcode"), st->errorcode);
-		add_assoc_string_ex(&array, "error", sizeof("error"), st->errorbuffer, 1);
+	ci = emalloc(sizeof(*ci) + strlens);
+	memcpy(ci, &tmp, sizeof(*ci));
+	tail = (char *) (ci + 1);
+
+	for (i = 0; i < PHP_HTTP_CURLE_INFO_ENTRIES; ++i) {
+		if (ci->entries[i].avail && (php_http_curle_info_entries[i].info & CURLINFO_TYPEMASK) == CURLINFO_STRING) {
+			ci->entries[i].val.s = php_http_curle_info_strcpy(&tail, ci->entries[i].val.s);
+		}
 	}
+#ifdef PHP_HTTP_HAVE_GNUTLS
+	if (tmp.tls.desc) {
+		ci->tls.desc = php_http_curle_info_strcpy(&tail, tmp.tls.desc);
+		gnutls_free(tmp.tls.desc);
+	}
+#endif
+	ci->errorcode = st->errorcode;
+	ci->error = php_http_curle_info_strcpy(&tail, st->errorbuffer);
 
-	return SUCCESS;
+	ci->ti.fill = php_http_curle_info_fill;
+	ci->ti.dtor = php_http_curle_info_dtor;
+
+	return ci;
 }
 
-static int compare_queue(php_http_client_enqueue_t *e, void *handle)
+static ZEND_RESULT_CODE php_http_curle_get_info(CURL *ch, HashTable *info)
 {
-	return handle == ((php_http_client_curl_handler_t *) e->opaque)->handle;
+	php_http_curle_info_t *ci = php_http_curle_info_snapshot(ch);
+
+	php_http_curle_info_fill(&ci->ti, info);
+	php_http_curle_info_dtor(&ci->ti);
+
+	return SUCCESS;
 }
 
 static php_http_message_t *php_http_curlm_responseparser(php_http_client_curl_handler_t *h TSRMLS_DC)
 {
 	php_http_message_t *response;
-	php_http_header_parser_t parser;
-	zval *zh;
 
-	response = php_http_message_init(NULL, 0, h->response.body TSRMLS_CC);
-	php_http_header_parser_init(&parser TSRMLS_CC);
-	while (h->response.headers.used) {
-		php_http_header_parser_state_t st = php_http_header_parser_parse(&parser,
-				&h->response.headers, PHP_HTTP_HEADER_PARSER_CLEANUP, &response->hdrs,
-				(php_http_info_callback_t) php_http_message_info_callback, (void *) &response);
-		if (PHP_HTTP_HEADER_PARSER_STATE_FAILURE == st) {
-			break;
+	if (!(response = h->response.message)) {
+		response = php_http_message_init(NULL, 0, h->response.body TSRMLS_CC);
+	} else {
+		php_http_header_parser_state_t st = php_http_header_parser_state_is(&h->response.parser);
+
+		/* the last header block has not been terminated */
+		if (PHP_HTTP_HEADER_PARSER_STATE_START != st) {
+			if (PHP_HTTP_HEADER_PARSER_STATE_FAILURE != st) {
+				php_http_header_parser_parse(&h->response.parser,
+						&h->response.headers, PHP_HTTP_HEADER_PARSER_CLEANUP, &response->hdrs,
+						(php_http_info_callback_t) php_http_message_info_callback, (void *) &response);
+			}
+			php_http_curle_response_headers(response);
 		}
+		php_http_header_parser_dtor(&h->response.parser);
+		php_http_header_parser_init(&h->response.parser TSRMLS_CC);
+		php_http_buffer_reset(&h->response.headers);
+		h->response.message = NULL;
 	}
-	php_http_header_parser_dtor(&parser);
 
 	/* move body to right message */
 	if (response->body != h->response.body) {
@@ -608,25 +949,174 @@ static php_http_message_t *php_http_curlm_responseparser(php_http_client_curl_ha
 	}
 	php_http_message_body_addref(h->response.body);
 
-	/* let's update the response headers */
-	if ((zh = php_http_message_header(response, ZEND_STRL("Content-Length"), 1))) {
-		zend_hash_update(&response->hdrs, "X-Original-Content-Length", sizeof("X-Original-Content-Length"), &zh, sizeof(zval *), NULL);
+	php_http_message_update_headers(response);
+
+	return response;
+}
+
+static void php_http_curle_connection_stats(php_http_client_curl_handler_t *h)
+{
+	long connects = 0;
+
+	if (CURLE_OK != curl_easy_getinfo(h->handle, CURLINFO_NUM_CONNECTS, &connects)) {
+		return;
 	}
-	if ((zh = php_http_message_header(response, ZEND_STRL("Transfer-Encoding"), 0))) {
-		zend_hash_update(&response->hdrs, "X-Original-Transfer-Encoding", sizeof("X-Original-Transfer-Encoding"), (void *) &zh, sizeof(zval *), NULL);
-		zend_hash_del(&response->hdrs, "Transfer-Encoding", sizeof("Transfer-Encoding"));
+	if (!connects) {
+		++h->stats->connections.reused;
+		return;
 	}
-	if ((zh = php_http_message_header(response, ZEND_STRL("Content-Range"), 0))) {
-		zend_hash_update(&response->hdrs, "X-Original-Content-Range", sizeof("X-Original-Content-Range"), &zh, sizeof(zval *), NULL);
-		zend_hash_del(&response->hdrs, "Content-Range", sizeof("Content-Range"));
+	h->stats->connections.created += connects;
+
+	/* a new connection; was there a TLS handshake, and could it resume a session? */
+#if PHP_HTTP_CURL_VERSION(7,48,0) && (defined(PHP_HTTP_HAVE_OPENSSL) || defined(PHP_HTTP_HAVE_GNUTLS))
+	{
+		struct curl_tlssessioninfo *ti = NULL;
+
+		if (CURLE_OK == curl_easy_getinfo(h->handle, CURLINFO_TLS_SSL_PTR, &ti) && ti && ti->internals) {
+			switch (ti->backend) {
+#	ifdef PHP_HTTP_HAVE_OPENSSL
+			case CURLSSLBACKEND_OPENSSL:
+				++h->stats->tls.handshakes;
+				if (SSL_session_reused(ti->internals)) {
+					++h->stats->tls.resumed;
+				}
+				break;
+#	endif
+#	ifdef PHP_HTTP_HAVE_GNUTLS
+			case CURLSSLBACKEND_GNUTLS:
+				++h->stats->tls.handshakes;
+				if (gnutls_session_is_resumed(ti->internals)) {
+					++h->stats->tls.resumed;
+				}
+				break;
+#	endif
+			default:
+				break;
+			}
+		}
 	}
-	if ((zh = php_http_message_header(response, ZEND_STRL("Content-Encoding"), 0))) {
-		zend_hash_update(&response->hdrs, "X-Original-Content-Encoding", sizeof("X-Original-Content-Encoding"), &zh, sizeof(zval *), NULL);
-		zend_hash_del(&response->hdrs, "Content-Encoding", sizeof("Content-Encoding"));
+#elif PHP_HTTP_CURL_VERSION(7,34,0) && defined(PHP_HTTP_HAVE_GNUTLS)
+	{
+		struct curl_tlssessioninfo *ti = NULL;
+
+		if (CURLE_OK == curl_easy_getinfo(h->handle, CURLINFO_TLS_SESSION, &ti) && ti && ti->internals && ti->backend == CURLSSLBACKEND_GNUTLS) {
+			++h->stats->tls.handshakes;
+			if (gnutls_session_is_resumed(ti->internals)) {
+				++h->stats->tls.resumed;
+			}
+		}
 	}
-	php_http_message_update_headers(response);
+#endif
+}
 
-	return response;
+static const struct {
+	const char *name;
+	CURLINFO info;
+} php_http_curle_phases[PHP_HTTP_CURLE_PHASES] = {
+	{"namelookup",		CURLINFO_NAMELOOKUP_TIME},
+	{"connect",			CURLINFO_CONNECT_TIME},
+	{"appconnect",		CURLINFO_APPCONNECT_TIME},
+	{"pretransfer",		CURLINFO_PRETRANSFER_TIME},
+	{"starttransfer",	CURLINFO_STARTTRANSFER_TIME},
+	{"total",			CURLINFO_TOTAL_TIME},
+};
+
+static inline unsigned php_http_curle_histogram_index(unsigned long usec)
+{
+	unsigned exp = PHP_HTTP_CURLE_LATENCY_SUB_BITS;
+
+	if (usec < PHP_HTTP_CURLE_LATENCY_SUB_COUNT) {
+		return usec;
+	}
+	while (exp < 31 && (usec >> (exp + 1))) {
+		++exp;
+	}
+	return ((exp - PHP_HTTP_CURLE_LATENCY_SUB_BITS + 1) << PHP_HTTP_CURLE_LATENCY_SUB_BITS) + (usec >> (exp - PHP_HTTP_CURLE_LATENCY_SUB_BITS)) - PHP_HTTP_CURLE_LATENCY_SUB_COUNT;
+}
+
+/* highest value falling into the bucket */
+static inline unsigned long php_http_curle_histogram_value(unsigned index)
+{
+	unsigned shift;
+
+	if (index < PHP_HTTP_CURLE_LATENCY_SUB_COUNT) {
+		return index;
+	}
+	shift = (index >> PHP_HTTP_CURLE_LATENCY_SUB_BITS) - 1;
+	return ((((unsigned long) (index & (PHP_HTTP_CURLE_LATENCY_SUB_COUNT - 1)) + PHP_HTTP_CURLE_LATENCY_SUB_COUNT + 1) << shift) - 1;
+}
+
+static void php_http_curle_histogram_record(php_http_curle_histogram_t *hist, double seconds)
+{
+	unsigned long usec = seconds > 0 ? (seconds * 1e6 >= 0xffffffffUL ? 0xffffffffUL : (unsigned long) (seconds * 1e6 + .5)) : 0;
+
+	if (!hist->count++ || usec < hist->min) {
+		hist->min = usec;
+	}
+	if (usec > hist->max) {
+		hist->max = usec;
+	}
+	hist->sum += usec;
+	++hist->buckets[php_http_curle_histogram_index(usec)];
+}
+
+/* percentile in seconds, p in the range 0..100 */
+static double php_http_curle_histogram_percentile(php_http_curle_histogram_t *hist, double p)
+{
+	unsigned i;
+	unsigned long seen = 0, rank;
+	double target;
+
+	if (!hist->count) {
+		return 0;
+	}
+
+	target = MIN(MAX(p, 0), 100) / 100 * hist->count;
+	rank = (unsigned long) target;
+	if (rank < target || !rank) {
+		++rank;
+	}
+	for (i = 0; i < PHP_HTTP_CURLE_LATENCY_BUCKETS; ++i) {
+		if ((seen += hist->buckets[i]) >= rank) {
+			unsigned long usec = php_http_curle_histogram_value(i);
+
+			return MAX(MIN(usec, hist->max), hist->min) / 1e6;
+		}
+	}
+	return hist->max / 1e6;
+}
+
+static void php_http_curle_latency_record(php_http_client_curl_latency_t *latency, php_http_client_curl_handler_t *h)
+{
+	int i;
+
+	for (i = 0; i < PHP_HTTP_CURLE_PHASES; ++i) {
+		double seconds = 0;
+
+		if (CURLE_OK != curl_easy_getinfo(h->handle, php_http_curle_phases[i].info, &seconds)) {
+			continue;
+		}
+		/* no TLS, no handshake */
+		if (i == PHP_HTTP_CURLE_PHASE_APPCONNECT && seconds <= 0) {
+			continue;
+		}
+		php_http_curle_histogram_record(&latency->phase[i], seconds);
+	}
+}
+
+static void php_http_curle_latency(php_http_client_curl_t *curl, php_http_client_curl_handler_t *h)
+{
+	if (!curl->latency.all) {
+		curl->latency.all = ecalloc(1, sizeof(*curl->latency.all));
+	}
+	php_http_curle_latency_record(curl->latency.all, h);
+
+	if (curl->latency.by_host && h->stats) {
+		if (!h->stats->latency) {
+			h->stats->latency = ecalloc(1, sizeof(*h->stats->latency));
+		}
+		php_http_curle_latency_record(h->stats->latency, h);
+	}
 }
 
 static void php_http_curlm_responsehandler(php_http_client_t *context)
@@ -656,9 +1146,30 @@ static void php_http_curlm_responsehandler(php_http_client_t *context)
 				err_count++;
 			}
 
-			if ((enqueue = php_http_client_enqueued(context, msg->easy_handle, compare_queue))) {
+			if ((enqueue = php_http_client_enqueued_handle(context, msg->easy_handle))) {
 				php_http_client_curl_handler_t *handler = enqueue->opaque;
-				php_http_message_t *response = php_http_curlm_responseparser(handler TSRMLS_CC);
+				php_http_message_t *response;
+
+				if (handler->stats) {
+					php_http_curle_connection_stats(handler);
+				}
+				if (curl->latency.enabled && CURLE_OK == msg->data.result) {
+					php_http_curle_latency(curl, handler);
+				}
+
+				if (context->callback.progress.func) {
+					CURL *ch = msg->easy_handle;
+
+					handler->progress.info = php_http_curle_progress_done(handler, msg->data.result);
+					context->callback.progress.func(context->callback.progress.arg, context, &handler->queue, &handler->progress);
+
+					/* the observer might have dequeued the request or reset the client */
+					if (enqueue != php_http_client_enqueued_handle(context, ch)) {
+						continue;
+					}
+				}
+
+				response = php_http_curlm_responseparser(handler TSRMLS_CC);
 
 				if (response) {
 					context->callback.response.func(context->callback.response.arg, context, &handler->queue, &response);
@@ -796,46 +1307,190 @@ static int php_http_curlm_socket_callback(CURL *easy, curl_socket_t sock, int ac
 			case CURL_POLL_NONE:
 				return 0;
 
-			default:
-				php_error_docref(NULL TSRMLS_CC, E_WARNING, "Unknown socket action %d", action);
-				return -1;
-		}
+			default:
+				php_error_docref(NULL TSRMLS_CC, E_WARNING, "Unknown socket action %d", action);
+				return -1;
+		}
+
+		event_assign(&ev->evnt, curl->evbase, sock, events, php_http_curlm_event_callback, context);
+		event_add(&ev->evnt, NULL);
+	}
+
+	return 0;
+}
+
+static void php_http_curlm_timer_callback(CURLM *multi, long timeout_ms, void *timer_data)
+{
+	php_http_client_t *context = timer_data;
+	php_http_client_curl_t *curl = context->ctx;
+
+#if DBG_EVENTS
+	fprintf(stderr, "\ntimer <- timeout_ms: %ld\n", timeout_ms);
+#endif
+	if (curl->useevents) {
+
+		if (timeout_ms < 0) {
+			php_http_curlm_timeout_callback(CURL_SOCKET_TIMEOUT, /*EV_READ|EV_WRITE*/0, context);
+		} else if (timeout_ms > 0 || !event_initialized(curl->timeout) || !event_pending(curl->timeout, EV_TIMEOUT, NULL)) {
+			struct timeval timeout;
+
+			if (!event_initialized(curl->timeout)) {
+				event_assign(curl->timeout, curl->evbase, CURL_SOCKET_TIMEOUT, 0, php_http_curlm_timeout_callback, context);
+			}
+
+			timeout.tv_sec = timeout_ms / 1000;
+			timeout.tv_usec = (timeout_ms % 1000) * 1000;
+
+			event_add(curl->timeout, &timeout);
+		}
+	}
+}
+
+#endif /* HAVE_EVENT */
+
+#if PHP_HTTP_HAVE_EPOLL
+
+static inline int eptoca(uint32_t events) {
+	int action = 0;
+
+	if (events & (EPOLLIN|EPOLLPRI|EPOLLHUP)) {
+		action |= CURL_CSELECT_IN;
+	}
+	if (events & EPOLLOUT) {
+		action |= CURL_CSELECT_OUT;
+	}
+	if (events & EPOLLERR) {
+		action |= CURL_CSELECT_ERR;
+	}
+	return action;
+}
+
+static int php_http_curlm_epoll_socket_callback(CURL *easy, curl_socket_t sock, int action, void *socket_data, void *assign_data)
+{
+	php_http_client_t *context = socket_data;
+	php_http_client_curl_t *curl = context->ctx;
+	struct epoll_event ev;
+	TSRMLS_FETCH_FROM_CTX(context->ts);
+
+	memset(&ev, 0, sizeof(ev));
+
+	switch (action) {
+		case CURL_POLL_IN:
+			ev.events = EPOLLIN;
+			break;
+		case CURL_POLL_OUT:
+			ev.events = EPOLLOUT;
+			break;
+		case CURL_POLL_INOUT:
+			ev.events = EPOLLIN|EPOLLOUT;
+			break;
+
+		case CURL_POLL_REMOVE:
+			/* the socket might have already been closed, which implicitly removed it */
+			epoll_ctl(curl->epoll.fd, EPOLL_CTL_DEL, sock, &ev);
+			/* no break */
+		case CURL_POLL_NONE:
+			return 0;
+
+		default:
+			php_error_docref(NULL TSRMLS_CC, E_WARNING, "Unknown socket action %d", action);
+			return -1;
+	}
+
+	ev.data.fd = sock;
 
-		event_assign(&ev->evnt, curl->evbase, sock, events, php_http_curlm_event_callback, context);
-		event_add(&ev->evnt, NULL);
+	/*
+	 * We do not track registrations with curl_multi_assign(), because connections
+	 * cached in a (persistent) multi handle outlive our epoll instance; modifying
+	 * first is the common case for an ongoing transfer, though.
+	 */
+	if (0 != epoll_ctl(curl->epoll.fd, EPOLL_CTL_MOD, sock, &ev)) {
+		if (errno != ENOENT || 0 != epoll_ctl(curl->epoll.fd, EPOLL_CTL_ADD, sock, &ev)) {
+			php_error_docref(NULL TSRMLS_CC, E_WARNING, "Could not watch socket %d: %s", (int) sock, strerror(errno));
+			return -1;
+		}
 	}
 
 	return 0;
 }
 
-static void php_http_curlm_timer_callback(CURLM *multi, long timeout_ms, void *timer_data)
+static int php_http_curlm_epoll_timer_callback(CURLM *multi, long timeout_ms, void *timer_data)
 {
 	php_http_client_t *context = timer_data;
 	php_http_client_curl_t *curl = context->ctx;
 
-#if DBG_EVENTS
-	fprintf(stderr, "\ntimer <- timeout_ms: %ld\n", timeout_ms);
-#endif
-	if (curl->useevents) {
+	if (timeout_ms < 0) {
+		timerclear(&curl->epoll.deadline);
+	} else {
+		struct timeval now, timeout;
 
-		if (timeout_ms < 0) {
-			php_http_curlm_timeout_callback(CURL_SOCKET_TIMEOUT, /*EV_READ|EV_WRITE*/0, context);
-		} else if (timeout_ms > 0 || !event_initialized(curl->timeout) || !event_pending(curl->timeout, EV_TIMEOUT, NULL)) {
-			struct timeval timeout;
+		timeout.tv_sec = timeout_ms / 1000;
+		timeout.tv_usec = (timeout_ms % 1000) * 1000;
 
-			if (!event_initialized(curl->timeout)) {
-				event_assign(curl->timeout, curl->evbase, CURL_SOCKET_TIMEOUT, 0, php_http_curlm_timeout_callback, context);
-			}
+		gettimeofday(&now, NULL);
+		timeradd(&now, &timeout, &curl->epoll.deadline);
+	}
 
-			timeout.tv_sec = timeout_ms / 1000;
-			timeout.tv_usec = (timeout_ms % 1000) * 1000;
+	return 0;
+}
 
-			event_add(curl->timeout, &timeout);
+static inline long php_http_curlm_epoll_get_timeout(php_http_client_curl_t *curl, long max_tout)
+{
+	struct timeval now, diff;
+	long tout;
+
+	if (!timerisset(&curl->epoll.deadline)) {
+		return max_tout;
+	}
+
+	gettimeofday(&now, NULL);
+	if (!timercmp(&now, &curl->epoll.deadline, <)) {
+		return 0;
+	}
+
+	timersub(&curl->epoll.deadline, &now, &diff);
+	/* round up, else we would spin until the timer is really due */
+	tout = diff.tv_sec * 1000 + (diff.tv_usec + 999) / 1000;
+
+	return MIN(tout, max_tout);
+}
+
+static ZEND_RESULT_CODE php_http_curlm_epoll_dispatch(php_http_client_t *context, long timeout_ms)
+{
+	php_http_client_curl_t *curl = context->ctx;
+	struct epoll_event events[PHP_HTTP_CURLM_EPOLL_EVENTS];
+	CURLMcode rc;
+	int i, nfds;
+	TSRMLS_FETCH_FROM_CTX(context->ts);
+
+	nfds = epoll_wait(curl->epoll.fd, events, PHP_HTTP_CURLM_EPOLL_EVENTS, timeout_ms);
+
+	if (nfds < 0) {
+		return errno == EINTR ? SUCCESS : FAILURE;
+	}
+
+	for (i = 0; i < nfds; ++i) {
+		while (CURLM_CALL_MULTI_PERFORM == (rc = curl_multi_socket_action(curl->handle, events[i].data.fd, eptoca(events[i].events), &curl->unfinished)));
+
+		if (CURLM_OK != rc) {
+			php_error_docref(NULL TSRMLS_CC, E_WARNING, "%s", curl_multi_strerror(rc));
 		}
 	}
+
+	if (timerisset(&curl->epoll.deadline) && !php_http_curlm_epoll_get_timeout(curl, 1)) {
+		timerclear(&curl->epoll.deadline);
+
+		while (CURLM_CALL_MULTI_PERFORM == (rc = curl_multi_socket_action(curl->handle, CURL_SOCKET_TIMEOUT, 0, &curl->unfinished)));
+
+		if (CURLM_OK != rc) {
+			php_error_docref(NULL TSRMLS_CC, E_WARNING, "%s", curl_multi_strerror(rc));
+		}
+	}
+
+	return SUCCESS;
 }
 
-#endif /* HAVE_EVENT */
+#endif /* HAVE_EPOLL */
 
 /* curl options */
 
@@ -1066,6 +1721,19 @@ static ZEND_RESULT_CODE php_http_curle_option_set_retrycount(php_http_option_t *
 	return SUCCESS;
 }
 
+static ZEND_RESULT_CODE php_http_curle_option_set_body_memory_limit(php_http_option_t *opt, zval *val, void *userdata)
+{
+	php_http_client_curl_handler_t *curl = userdata;
+
+	if (Z_LVAL_P(val) < 0) {
+		return FAILURE;
+	}
+	if (curl->response.sink) {
+		php_http_message_body_sink_set_limit(curl->response.sink, Z_LVAL_P(val));
+	}
+	return SUCCESS;
+}
+
 static ZEND_RESULT_CODE php_http_curle_option_set_redirect(php_http_option_t *opt, zval *val, void *userdata)
 {
 	php_http_client_curl_handler_t *curl = userdata;
@@ -1402,6 +2070,12 @@ static void php_http_curle_options_init(php_http_options_t *registry TSRMLS_DC)
 	/* maxfilesize */
 	php_http_option_register(registry, ZEND_STRL("maxfilesize"), CURLOPT_MAXFILESIZE, IS_LONG);
 
+	/* response body size to keep in memory before spilling to a temporary file, 0: unlimited */
+	if ((opt = php_http_option_register(registry, ZEND_STRL("body_memory_limit"), 0, IS_LONG))) {
+		opt->setter = php_http_curle_option_set_body_memory_limit;
+		ZVAL_LONG(&opt->defval, PHP_HTTP_CURLE_BODY_MEMORY_LIMIT);
+	}
+
 	/* http protocol version */
 	php_http_option_register(registry, ZEND_STRL("protocol"), CURLOPT_HTTP_VERSION, IS_LONG);
 
@@ -1670,6 +2344,59 @@ static ZEND_RESULT_CODE php_http_curlm_option_set_pipelining_bl(php_http_option_
 }
 #endif
 
+#if PHP_HTTP_HAVE_EPOLL
+static ZEND_RESULT_CODE php_http_curlm_use_epoll(php_http_client_t *h, zend_bool enable)
+{
+	php_http_client_curl_t *curl = h->ctx;
+
+	/* configure() passes every option again; keep the registered callbacks and the pending deadline */
+	if (!enable == !curl->useepoll && (!enable || curl->epoll.fd >= 0)) {
+		return SUCCESS;
+	}
+
+	if (enable && curl->epoll.fd < 0) {
+		TSRMLS_FETCH_FROM_CTX(h->ts);
+
+		if (0 > (curl->epoll.fd = epoll_create1(EPOLL_CLOEXEC))) {
+			php_error_docref(NULL TSRMLS_CC, E_WARNING, "Could not create epoll instance: %s", strerror(errno));
+			curl->useepoll = 0;
+			return FAILURE;
+		}
+	}
+
+	curl->useepoll = enable;
+
+#if PHP_HTTP_HAVE_EVENT
+	/* the event loop takes precedence */
+	if (curl->useevents) {
+		return SUCCESS;
+	}
+#endif
+
+	if (enable) {
+		timerclear(&curl->epoll.deadline);
+		curl_multi_setopt(curl->handle, CURLMOPT_SOCKETDATA, h);
+		curl_multi_setopt(curl->handle, CURLMOPT_SOCKETFUNCTION, php_http_curlm_epoll_socket_callback);
+		curl_multi_setopt(curl->handle, CURLMOPT_TIMERDATA, h);
+		curl_multi_setopt(curl->handle, CURLMOPT_TIMERFUNCTION, php_http_curlm_epoll_timer_callback);
+	} else {
+		curl_multi_setopt(curl->handle, CURLMOPT_SOCKETDATA, NULL);
+		curl_multi_setopt(curl->handle, CURLMOPT_SOCKETFUNCTION, NULL);
+		curl_multi_setopt(curl->handle, CURLMOPT_TIMERDATA, NULL);
+		curl_multi_setopt(curl->handle, CURLMOPT_TIMERFUNCTION, NULL);
+	}
+
+	return SUCCESS;
+}
+
+static ZEND_RESULT_CODE php_http_curlm_option_set_use_epoll(php_http_option_t *opt, zval *value, void *userdata)
+{
+	php_http_client_t *client = userdata;
+
+	return php_http_curlm_use_epoll(client, value && Z_BVAL_P(value));
+}
+#endif
+
 #if PHP_HTTP_HAVE_EVENT
 static inline ZEND_RESULT_CODE php_http_curlm_use_eventloop(php_http_client_t *h, zend_bool enable)
 {
@@ -1691,6 +2418,13 @@ static inline ZEND_RESULT_CODE php_http_curlm_use_eventloop(php_http_client_t *h
 		curl_multi_setopt(curl->handle, CURLMOPT_SOCKETFUNCTION, NULL);
 		curl_multi_setopt(curl->handle, CURLMOPT_TIMERDATA, NULL);
 		curl_multi_setopt(curl->handle, CURLMOPT_TIMERFUNCTION, NULL);
+#if PHP_HTTP_HAVE_EPOLL
+		/* fall back to epoll instead of select(), registering its callbacks again */
+		if (curl->useepoll) {
+			curl->useepoll = 0;
+			return php_http_curlm_use_epoll(h, 1);
+		}
+#endif
 	}
 
 	return SUCCESS;
@@ -1704,6 +2438,53 @@ static ZEND_RESULT_CODE php_http_curlm_option_set_use_eventloop(php_http_option_
 }
 #endif
 
+static ZEND_RESULT_CODE php_http_curlm_option_set_progress_interval(php_http_option_t *opt, zval *value, void *userdata)
+{
+	php_http_client_t *client = userdata;
+	php_http_client_curl_t *curl = client->ctx;
+
+	curl->progress.interval = Z_DVAL_P(value);
+	return SUCCESS;
+}
+
+static ZEND_RESULT_CODE php_http_curlm_option_set_progress_delta(php_http_option_t *opt, zval *value, void *userdata)
+{
+	php_http_client_t *client = userdata;
+	php_http_client_curl_t *curl = client->ctx;
+
+	curl->progress.delta = Z_LVAL_P(value);
+	return SUCCESS;
+}
+
+static ZEND_RESULT_CODE php_http_curlm_option_set_latency_histograms(php_http_option_t *opt, zval *value, void *userdata)
+{
+	php_http_client_t *client = userdata;
+	php_http_client_curl_t *curl = client->ctx;
+
+	/* disabling only stops recording, what has been collected is kept */
+	curl->latency.enabled = Z_BVAL_P(value);
+	return SUCCESS;
+}
+
+static ZEND_RESULT_CODE php_http_curlm_option_set_pool_stats(php_http_option_t *opt, zval *value, void *userdata)
+{
+	php_http_client_t *client = userdata;
+	php_http_client_curl_t *curl = client->ctx;
+
+	/* disabling only stops counting, what has been collected is kept */
+	curl->poolstats = Z_BVAL_P(value);
+	return SUCCESS;
+}
+
+static ZEND_RESULT_CODE php_http_curlm_option_set_latency_by_host(php_http_option_t *opt, zval *value, void *userdata)
+{
+	php_http_client_t *client = userdata;
+	php_http_client_curl_t *curl = client->ctx;
+
+	curl->latency.by_host = Z_BVAL_P(value);
+	return SUCCESS;
+}
+
 static void php_http_curlm_options_init(php_http_options_t *registry TSRMLS_DC)
 {
 	php_http_option_t *opt;
@@ -1749,12 +2530,36 @@ static void php_http_curlm_options_init(php_http_options_t *registry TSRMLS_DC)
 		opt->setter = php_http_curlm_option_set_pipelining_bl;
 	}
 #endif
+	/* minimum seconds between progress notifications */
+	if ((opt = php_http_option_register(registry, ZEND_STRL("progress_interval"), 0, IS_DOUBLE))) {
+		opt->setter = php_http_curlm_option_set_progress_interval;
+	}
+	/* minimum bytes transferred between progress notifications */
+	if ((opt = php_http_option_register(registry, ZEND_STRL("progress_delta"), 0, IS_LONG))) {
+		opt->setter = php_http_curlm_option_set_progress_delta;
+	}
+	if ((opt = php_http_option_register(registry, ZEND_STRL("pool_stats"), 0, IS_BOOL))) {
+		opt->setter = php_http_curlm_option_set_pool_stats;
+	}
+	if ((opt = php_http_option_register(registry, ZEND_STRL("latency_histograms"), 0, IS_BOOL))) {
+		opt->setter = php_http_curlm_option_set_latency_histograms;
+	}
+	/* per host histograms live in the pool stats, so they need pool_stats, too */
+	if ((opt = php_http_option_register(registry, ZEND_STRL("latency_by_host"), 0, IS_BOOL))) {
+		opt->setter = php_http_curlm_option_set_latency_by_host;
+	}
 	/* events */
 #if PHP_HTTP_HAVE_EVENT
 	if ((opt = php_http_option_register(registry, ZEND_STRL("use_eventloop"), 0, IS_BOOL))) {
 		opt->setter = php_http_curlm_option_set_use_eventloop;
 	}
 #endif
+#if PHP_HTTP_HAVE_EPOLL
+	if ((opt = php_http_option_register(registry, ZEND_STRL("use_epoll"), 0, IS_BOOL))) {
+		opt->setter = php_http_curlm_option_set_use_epoll;
+		ZVAL_BOOL(&opt->defval, 1);
+	}
+#endif
 }
 
 static ZEND_RESULT_CODE php_http_curlm_set_option(php_http_option_t *opt, zval *val, void *userdata)
@@ -1875,8 +2680,14 @@ static php_http_client_curl_handler_t *php_http_client_curl_handler_init(php_htt
 	handler->rf = rf;
 	handler->client = h;
 	handler->handle = handle;
-	handler->response.body = php_http_message_body_init(NULL, NULL TSRMLS_CC);
+	handler->response.body = php_http_message_body_init_sink(NULL, PHP_HTTP_CURLE_BODY_MEMORY_LIMIT TSRMLS_CC);
+	if ((handler->response.sink = php_http_message_body_stream(handler->response.body))) {
+		if (handler->response.sink->ops != &php_http_message_body_sink_ops) {
+			handler->response.sink = NULL;
+		}
+	}
 	php_http_buffer_init(&handler->response.headers);
+	php_http_header_parser_init(&handler->response.parser TSRMLS_CC);
 	php_http_buffer_init(&handler->options.cookies);
 	php_http_buffer_init(&handler->options.ranges);
 	zend_hash_init(&handler->options.cache, 0, NULL, ZVAL_PTR_DTOR, 0);
@@ -1887,11 +2698,9 @@ static php_http_client_curl_handler_t *php_http_client_curl_handler_init(php_htt
 	curl_easy_setopt(handle, CURLOPT_HEADER, 0L);
 	curl_easy_setopt(handle, CURLOPT_FILETIME, 1L);
 	curl_easy_setopt(handle, CURLOPT_AUTOREFERER, 1L);
-	curl_easy_setopt(handle, CURLOPT_VERBOSE, 1L);
 	curl_easy_setopt(handle, CURLOPT_NOPROGRESS, 0L);
 	curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, php_http_curle_header_callback);
 	curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, php_http_curle_body_callback);
-	curl_easy_setopt(handle, CURLOPT_DEBUGFUNCTION, php_http_curle_raw_callback);
 	curl_easy_setopt(handle, CURLOPT_READFUNCTION, php_http_curle_read_callback);
 	curl_easy_setopt(handle, CURLOPT_SEEKFUNCTION, php_http_curle_seek_callback);
 #if PHP_HTTP_CURL_VERSION(7,32,0)
@@ -1933,6 +2742,15 @@ static ZEND_RESULT_CODE php_http_client_curl_handler_prepare(php_http_client_cur
 	/* apply options */
 	php_http_options_apply(&php_http_curle_options, enqueue->options, curl);
 
+	/* only trace if anyone listens */
+	if (curl->client->callback.debug.func) {
+		curl_easy_setopt(curl->handle, CURLOPT_VERBOSE, 1L);
+		curl_easy_setopt(curl->handle, CURLOPT_DEBUGFUNCTION, php_http_curle_raw_callback);
+	} else {
+		curl_easy_setopt(curl->handle, CURLOPT_VERBOSE, 0L);
+		curl_easy_setopt(curl->handle, CURLOPT_DEBUGFUNCTION, NULL);
+	}
+
 	/* request headers */
 	php_http_message_update_headers(msg);
 	if (zend_hash_num_elements(&msg->hdrs)) {
@@ -2036,6 +2854,12 @@ static void php_http_client_curl_handler_dtor(php_http_client_curl_handler_t *ha
 	php_resource_factory_handle_dtor(handler->rf, handler->handle TSRMLS_CC);
 	php_resource_factory_free(&handler->rf);
 
+	if (handler->response.message) {
+		/* the message does not hold its own reference to the response body yet */
+		php_http_message_body_addref(handler->response.body);
+		php_http_message_free(&handler->response.message);
+	}
+	php_http_header_parser_dtor(&handler->response.parser);
 	php_http_message_body_free(&handler->response.body);
 	php_http_buffer_dtor(&handler->response.headers);
 	php_http_buffer_dtor(&handler->options.ranges);
@@ -2050,6 +2874,15 @@ static void php_http_client_curl_handler_dtor(php_http_client_curl_handler_t *ha
 	efree(handler);
 }
 
+static void php_http_client_curl_stats_dtor(void *ptr)
+{
+	php_http_client_curl_stats_t *stats = ptr;
+
+	if (stats->latency) {
+		efree(stats->latency);
+	}
+}
+
 static php_http_client_t *php_http_client_curl_init(php_http_client_t *h, void *handle)
 {
 	php_http_client_curl_t *curl;
@@ -2063,8 +2896,14 @@ static php_http_client_t *php_http_client_curl_init(php_http_client_t *h, void *
 	curl = ecalloc(1, sizeof(*curl));
 	curl->handle = handle;
 	curl->unfinished = 0;
+	zend_hash_init(&curl->stats, 0, NULL, php_http_client_curl_stats_dtor, 0);
 	h->ctx = curl;
 
+#if PHP_HTTP_HAVE_EPOLL
+	curl->epoll.fd = -1;
+	php_http_curlm_use_epoll(h, 1);
+#endif
+
 	return h;
 }
 
@@ -2085,8 +2924,24 @@ static void php_http_client_curl_dtor(php_http_client_t *h)
 		event_base_free(curl->evbase);
 		curl->evbase = NULL;
 	}
+#endif
+#if PHP_HTTP_HAVE_EPOLL
+	if (curl->epoll.fd >= 0) {
+		/* the multi handle might be persistent */
+		curl_multi_setopt(curl->handle, CURLMOPT_SOCKETDATA, NULL);
+		curl_multi_setopt(curl->handle, CURLMOPT_SOCKETFUNCTION, NULL);
+		curl_multi_setopt(curl->handle, CURLMOPT_TIMERDATA, NULL);
+		curl_multi_setopt(curl->handle, CURLMOPT_TIMERFUNCTION, NULL);
+		close(curl->epoll.fd);
+		curl->epoll.fd = -1;
+	}
 #endif
 	curl->unfinished = 0;
+	zend_hash_destroy(&curl->stats);
+	if (curl->latency.all) {
+		efree(curl->latency.all);
+		curl->latency.all = NULL;
+	}
 
 	php_resource_factory_handle_dtor(h->rf, curl->handle TSRMLS_CC);
 
@@ -2105,6 +2960,40 @@ static void queue_dtor(php_http_client_enqueue_t *e)
 	php_http_client_curl_handler_dtor(handler);
 }
 
+/* "host:port" of a request, identifying persistent handles and statistics */
+static size_t php_http_client_curl_ident(php_http_client_enqueue_t *enqueue, char **id_str)
+{
+	php_http_url_t *url = enqueue->request->http.info.request.url;
+	int port = url->port ? url->port : 80;
+	zval **zport;
+
+	if (SUCCESS == zend_hash_find(enqueue->options, ZEND_STRS("port"), (void *) &zport)) {
+		zval *zcpy = php_http_ztyp(IS_LONG, *zport);
+
+		if (Z_LVAL_P(zcpy)) {
+			port = Z_LVAL_P(zcpy);
+		}
+		zval_ptr_dtor(&zcpy);
+	}
+
+	return spprintf(id_str, 0, "%s:%d", STR_PTR(url->host), port);
+}
+
+static php_http_client_curl_stats_t *php_http_client_curl_stats(php_http_client_t *h, php_http_client_enqueue_t *enqueue)
+{
+	php_http_client_curl_t *curl = h->ctx;
+	php_http_client_curl_stats_t *stats = NULL, empty = {0};
+	char *id_str = NULL;
+	size_t id_len = php_http_client_curl_ident(enqueue, &id_str);
+
+	if (SUCCESS != zend_hash_find(&curl->stats, id_str, id_len + 1, (void *) &stats)) {
+		zend_hash_add(&curl->stats, id_str, id_len + 1, &empty, sizeof(empty), (void *) &stats);
+	}
+	efree(id_str);
+
+	return stats;
+}
+
 static php_resource_factory_t *create_rf(php_http_client_t *h, php_http_client_enqueue_t *enqueue TSRMLS_DC)
 {
 	php_persistent_handle_factory_t *pf = NULL;
@@ -2119,20 +3008,8 @@ static php_resource_factory_t *create_rf(php_http_client_t *h, php_http_client_e
 	/* only if the client itself is setup for persistence */
 	if (php_resource_factory_is_persistent(h->rf)) {
 		char *id_str = NULL;
-		size_t id_len;
-		int port = url->port ? url->port : 80;
-		zval **zport;
-
-		if (SUCCESS == zend_hash_find(enqueue->options, ZEND_STRS("port"), (void *) &zport)) {
-			zval *zcpy = php_http_ztyp(IS_LONG, *zport);
+		size_t id_len = php_http_client_curl_ident(enqueue, &id_str);
 
-			if (Z_LVAL_P(zcpy)) {
-				port = Z_LVAL_P(zcpy);
-			}
-			zval_ptr_dtor(&zcpy);
-		}
-
-		id_len = spprintf(&id_str, 0, "%s:%d", STR_PTR(url->host), port);
 		pf = php_persistent_handle_concede(NULL, ZEND_STRL("http\\Client\\Curl\\Request"), id_str, id_len, NULL, NULL TSRMLS_CC);
 		efree(id_str);
 	}
@@ -2170,15 +3047,29 @@ static ZEND_RESULT_CODE php_http_client_curl_enqueue(php_http_client_t *h, php_h
 		return FAILURE;
 	}
 
+	/* the "host:port" key and its lookup are not for free, so only when asked for */
+	if (curl->poolstats && (handler->stats = php_http_client_curl_stats(h, enqueue))) {
+		php_http_curle_storage_t *st = php_http_curle_get_storage(handler->handle);
+
+		++handler->stats->requests;
+		if (st->uses++) {
+			++handler->stats->handles.hits;
+		} else {
+			++handler->stats->handles.misses;
+		}
+	}
+
 	handler->queue = *enqueue;
 	enqueue->opaque = handler;
 	enqueue->dtor = queue_dtor;
 
 	if (CURLM_OK == (rs = curl_multi_add_handle(curl->handle, handler->handle))) {
-		zend_llist_add_element(&h->requests, enqueue);
+		php_http_client_enqueued_add(h, enqueue, handler->handle);
 		++curl->unfinished;
 
 		if (h->callback.progress.func && SUCCESS == php_http_client_getopt(h, PHP_HTTP_CLIENT_OPT_PROGRESS_INFO, enqueue->request, &progress)) {
+			progress->info = "setup";
+			h->callback.progress.func(h->callback.progress.arg, h, &handler->queue, progress);
 			progress->info = "start";
 			h->callback.progress.func(h->callback.progress.arg, h, &handler->queue, progress);
 			progress->started = 1;
@@ -2200,7 +3091,7 @@ static ZEND_RESULT_CODE php_http_client_curl_dequeue(php_http_client_t *h, php_h
 
 	php_http_client_curl_handler_clear(handler);
 	if (CURLM_OK == (rs = curl_multi_remove_handle(curl->handle, handler->handle))) {
-		zend_llist_del_element(&h->requests, handler->handle, (int (*)(void *, void *)) compare_queue);
+		php_http_client_enqueued_del(h, enqueue, handler->handle);
 		return SUCCESS;
 	} else {
 		php_error_docref(NULL TSRMLS_CC, E_WARNING, "Could not dequeue request: %s", curl_multi_strerror(rs));
@@ -2259,6 +3150,19 @@ static ZEND_RESULT_CODE php_http_client_curl_wait(php_http_client_t *h, struct t
 		return SUCCESS;
 	}
 #endif
+#if PHP_HTTP_HAVE_EPOLL
+	if (curl->useepoll) {
+		long tout;
+
+		if (custom_timeout && timerisset(custom_timeout)) {
+			tout = custom_timeout->tv_sec * 1000 + custom_timeout->tv_usec / 1000;
+		} else {
+			tout = php_http_curlm_epoll_get_timeout(curl, 1000);
+		}
+
+		return php_http_curlm_epoll_dispatch(h, tout);
+	}
+#endif
 
 	FD_ZERO(&R);
 	FD_ZERO(&W);
@@ -2289,6 +3193,11 @@ static int php_http_client_curl_once(php_http_client_t *h)
 	if (curl->useevents) {
 		event_base_loop(curl->evbase, EVLOOP_NONBLOCK);
 	} else
+#endif
+#if PHP_HTTP_HAVE_EPOLL
+	if (curl->useepoll) {
+		php_http_curlm_epoll_dispatch(h, 0);
+	} else
 #endif
 	while (CURLM_CALL_MULTI_PERFORM == curl_multi_perform(curl->handle, &curl->unfinished));
 
@@ -2399,6 +3308,106 @@ static int apply_available_options(void *pDest TSRMLS_DC, int num_args, va_list
 	return ZEND_HASH_APPLY_KEEP;
 }
 
+static void php_http_client_curl_get_latency(php_http_client_t *h, php_http_client_latency_query_t *query, HashTable *ht)
+{
+	php_http_client_curl_t *curl = h->ctx;
+	php_http_client_curl_latency_t *latency = curl->latency.all;
+	zval array;
+	int i;
+	TSRMLS_FETCH_FROM_CTX(h->ts);
+
+	if (query->host_str) {
+		php_http_client_curl_stats_t *stats;
+
+		if (SUCCESS == zend_hash_find(&curl->stats, query->host_str, query->host_len + 1, (void *) &stats)) {
+			latency = stats->latency;
+		} else {
+			latency = NULL;
+		}
+	}
+	if (!latency) {
+		return;
+	}
+
+	INIT_PZVAL_ARRAY(&array, ht);
+
+	for (i = 0; i < PHP_HTTP_CURLE_PHASES; ++i) {
+		php_http_curle_histogram_t *hist = &latency->phase[i];
+		zval *entry;
+		unsigned j;
+
+		MAKE_STD_ZVAL(entry);
+		array_init(entry);
+		add_assoc_long_ex(entry, ZEND_STRS("count"), hist->count);
+		add_assoc_double_ex(entry, ZEND_STRS("min"), hist->min / 1e6);
+		add_assoc_double_ex(entry, ZEND_STRS("max"), hist->max / 1e6);
+		add_assoc_double_ex(entry, ZEND_STRS("mean"), hist->count ? hist->sum / hist->count / 1e6 : 0.0);
+
+		for (j = 0; j < query->count; ++j) {
+			char *key_str;
+			size_t key_len = spprintf(&key_str, 0, "p%g", query->percentiles[j]);
+
+			add_assoc_double_ex(entry, key_str, key_len + 1, php_http_curle_histogram_percentile(hist, query->percentiles[j]));
+			efree(key_str);
+		}
+
+		add_assoc_zval(&array, php_http_curle_phases[i].name, entry);
+	}
+}
+
+static void php_http_client_curl_get_stats(php_http_client_t *h, HashTable *ht)
+{
+	php_http_client_curl_t *curl = h->ctx;
+	php_http_client_curl_stats_t *stats;
+	php_http_array_hashkey_t key = php_http_array_hashkey_init(0);
+	HashTable *pool = NULL, *handles = NULL;
+	HashPosition pos;
+	zval array, **tmp;
+	TSRMLS_FETCH_FROM_CTX(h->ts);
+
+	INIT_PZVAL_ARRAY(&array, ht);
+
+	/* idle and busy persistent handles per "host:port" */
+	if (php_resource_factory_is_persistent(h->rf) && (pool = php_persistent_handle_statall(NULL TSRMLS_CC))) {
+		if (SUCCESS == zend_hash_find(pool, ZEND_STRS("http\\Client\\Curl\\Request"), (void *) &tmp) && Z_TYPE_PP(tmp) == IS_ARRAY) {
+			handles = Z_ARRVAL_PP(tmp);
+		}
+	}
+
+	FOREACH_HASH_KEYVAL(pos, &curl->stats, key, stats) {
+		zval *entry, **pool_entry;
+
+		MAKE_STD_ZVAL(entry);
+		array_init(entry);
+		add_assoc_long_ex(entry, ZEND_STRS("requests"), stats->requests);
+		add_assoc_long_ex(entry, ZEND_STRS("handle_hits"), stats->handles.hits);
+		add_assoc_long_ex(entry, ZEND_STRS("handle_misses"), stats->handles.misses);
+		add_assoc_double_ex(entry, ZEND_STRS("handle_reuse"), stats->requests ? (double) stats->handles.hits / stats->requests : 0.0);
+		add_assoc_long_ex(entry, ZEND_STRS("connections_created"), stats->connections.created);
+		add_assoc_long_ex(entry, ZEND_STRS("connections_reused"), stats->connections.reused);
+		add_assoc_long_ex(entry, ZEND_STRS("tls_handshakes"), stats->tls.handshakes);
+		add_assoc_long_ex(entry, ZEND_STRS("tls_resumed"), stats->tls.resumed);
+
+		if (handles && SUCCESS == zend_hash_find(handles, key.str, key.len, (void *) &pool_entry) && Z_TYPE_PP(pool_entry) == IS_ARRAY) {
+			zval **used, **free;
+
+			if (SUCCESS == zend_hash_find(Z_ARRVAL_PP(pool_entry), ZEND_STRS("used"), (void *) &used)) {
+				add_assoc_long_ex(entry, ZEND_STRS("pool_used"), Z_LVAL_PP(used));
+			}
+			if (SUCCESS == zend_hash_find(Z_ARRVAL_PP(pool_entry), ZEND_STRS("free"), (void *) &free)) {
+				add_assoc_long_ex(entry, ZEND_STRS("pool_idle"), Z_LVAL_PP(free));
+			}
+		}
+
+		add_assoc_zval_ex(&array, key.str, key.len, entry);
+	}
+
+	if (pool) {
+		zend_hash_destroy(pool);
+		FREE_HASHTABLE(pool);
+	}
+}
+
 static ZEND_RESULT_CODE php_http_client_curl_getopt(php_http_client_t *h, php_http_client_getopt_opt_t opt, void *arg, void **res)
 {
 	php_http_client_enqueue_t *enqueue;
@@ -2423,6 +3432,15 @@ static ZEND_RESULT_CODE php_http_client_curl_getopt(php_http_client_t *h, php_ht
 		}
 		break;
 
+	case PHP_HTTP_CLIENT_OPT_TRANSFER_INFO_SNAPSHOT:
+		if ((enqueue = php_http_client_enqueued(h, arg, NULL))) {
+			php_http_client_curl_handler_t *handler = enqueue->opaque;
+
+			*((php_http_client_transfer_info_t **) res) = &php_http_curle_info_snapshot(handler->handle)->ti;
+			return SUCCESS;
+		}
+		break;
+
 	case PHP_HTTP_CLIENT_OPT_AVAILABLE_OPTIONS:
 		zend_hash_apply_with_arguments(&php_http_curle_options.options TSRMLS_CC, apply_available_options, 1, *(HashTable **) res);
 		break;
@@ -2431,6 +3449,14 @@ static ZEND_RESULT_CODE php_http_client_curl_getopt(php_http_client_t *h, php_ht
 		zend_hash_apply_with_arguments(&php_http_curlm_options.options TSRMLS_CC, apply_available_options, 1, *(HashTable **) res);
 		break;
 
+	case PHP_HTTP_CLIENT_OPT_POOL_STATS:
+		php_http_client_curl_get_stats(h, *(HashTable **) res);
+		return SUCCESS;
+
+	case PHP_HTTP_CLIENT_OPT_LATENCY_STATS:
+		php_http_client_curl_get_latency(h, arg, *(HashTable **) res);
+		return SUCCESS;
+
 	default:
 		break;
 	}
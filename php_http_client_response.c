@@ -12,6 +12,122 @@
 
 #include "php_http_api.h"
 
+static zend_object_handlers php_http_client_response_object_handlers;
+
+zend_object_value php_http_client_response_object_new(zend_class_entry *ce TSRMLS_DC)
+{
+	return php_http_client_response_object_new_ex(ce, NULL, NULL TSRMLS_CC);
+}
+
+zend_object_value php_http_client_response_object_new_ex(zend_class_entry *ce, php_http_message_t *msg, php_http_client_response_object_t **ptr TSRMLS_DC)
+{
+	php_http_client_response_object_t *o;
+
+	o = ecalloc(1, sizeof(php_http_client_response_object_t));
+	zend_object_std_init((zend_object *) o, ce TSRMLS_CC);
+	object_properties_init((zend_object *) o, ce);
+
+	if (ptr) {
+		*ptr = o;
+	}
+
+	if (msg) {
+		o->message.message = msg;
+		if (msg->parent) {
+			php_http_message_object_new_ex(ce, msg->parent, &o->message.parent TSRMLS_CC);
+		}
+		php_http_message_body_object_new_ex(php_http_message_body_class_entry, php_http_message_body_init(&msg->body, NULL TSRMLS_CC), &o->message.body TSRMLS_CC);
+	}
+
+	o->message.zv.handle = zend_objects_store_put((zend_object *) o, NULL, php_http_client_response_object_free, NULL TSRMLS_CC);
+	o->message.zv.handlers = &php_http_client_response_object_handlers;
+
+	return o->message.zv;
+}
+
+static void php_http_client_response_object_materialize(zval *object, php_http_client_response_object_t *obj TSRMLS_DC)
+{
+	php_http_client_transfer_info_t *ti = obj->info;
+
+	if (ti) {
+		zval *info;
+
+		obj->info = NULL;
+
+		MAKE_STD_ZVAL(info);
+		object_init(info);
+		ti->fill(ti, HASH_OF(info));
+		ti->dtor(ti);
+		zend_update_property(php_http_client_response_class_entry, object, ZEND_STRL("transferInfo"), info TSRMLS_CC);
+		zval_ptr_dtor(&info);
+	}
+}
+
+static inline zend_bool php_http_client_response_object_is_info(zval *member)
+{
+	return Z_TYPE_P(member) == IS_STRING && Z_STRLEN_P(member) == lenof("transferInfo") && !memcmp(Z_STRVAL_P(member), ZEND_STRL("transferInfo"));
+}
+
+zend_object_value php_http_client_response_object_clone(zval *this_ptr TSRMLS_DC)
+{
+	zend_object_value new_ov;
+	php_http_client_response_object_t *new_obj = NULL;
+	php_http_client_response_object_t *old_obj = zend_object_store_get_object(this_ptr TSRMLS_CC);
+
+	php_http_client_response_object_materialize(this_ptr, old_obj TSRMLS_CC);
+
+	new_ov = php_http_client_response_object_new_ex(old_obj->message.zo.ce, php_http_message_copy(old_obj->message.message, NULL), &new_obj TSRMLS_CC);
+	zend_objects_clone_members(&new_obj->message.zo, new_ov, &old_obj->message.zo, Z_OBJ_HANDLE_P(this_ptr) TSRMLS_CC);
+
+	return new_ov;
+}
+
+void php_http_client_response_object_free(void *object TSRMLS_DC)
+{
+	php_http_client_response_object_t *o = object;
+
+	if (o->info) {
+		o->info->dtor(o->info);
+		o->info = NULL;
+	}
+	php_http_message_object_free(object TSRMLS_CC);
+}
+
+static zval *php_http_client_response_object_read_prop(zval *object, zval *member, int type PHP_HTTP_ZEND_LITERAL_DC TSRMLS_DC)
+{
+	if (php_http_client_response_object_is_info(member)) {
+		php_http_client_response_object_materialize(object, zend_object_store_get_object(object TSRMLS_CC) TSRMLS_CC);
+	}
+	return php_http_message_object_get_handlers()->read_property(object, member, type PHP_HTTP_ZEND_LITERAL_CC TSRMLS_CC);
+}
+
+static void php_http_client_response_object_write_prop(zval *object, zval *member, zval *value PHP_HTTP_ZEND_LITERAL_DC TSRMLS_DC)
+{
+	if (php_http_client_response_object_is_info(member)) {
+		php_http_client_response_object_t *obj = zend_object_store_get_object(object TSRMLS_CC);
+
+		if (obj->info) {
+			obj->info->dtor(obj->info);
+			obj->info = NULL;
+		}
+	}
+	php_http_message_object_get_handlers()->write_property(object, member, value PHP_HTTP_ZEND_LITERAL_CC TSRMLS_CC);
+}
+
+static int php_http_client_response_object_has_prop(zval *object, zval *member, int has_set_exists PHP_HTTP_ZEND_LITERAL_DC TSRMLS_DC)
+{
+	if (php_http_client_response_object_is_info(member)) {
+		php_http_client_response_object_materialize(object, zend_object_store_get_object(object TSRMLS_CC) TSRMLS_CC);
+	}
+	return php_http_message_object_get_handlers()->has_property(object, member, has_set_exists PHP_HTTP_ZEND_LITERAL_CC TSRMLS_CC);
+}
+
+static HashTable *php_http_client_response_object_get_props(zval *object TSRMLS_DC)
+{
+	php_http_client_response_object_materialize(object, zend_object_store_get_object(object TSRMLS_CC) TSRMLS_CC);
+	return php_http_message_object_get_handlers()->get_properties(object TSRMLS_CC);
+}
+
 ZEND_BEGIN_ARG_INFO_EX(ai_HttpClientResponse_getCookies, 0, 0, 0)
 	ZEND_ARG_INFO(0, flags)
 	ZEND_ARG_INFO(0, allowed_extras)
@@ -127,6 +243,13 @@ PHP_MINIT_FUNCTION(http_client_response)
 
 	INIT_NS_CLASS_ENTRY(ce, "http\\Client", "Response", php_http_client_response_methods);
 	php_http_client_response_class_entry = zend_register_internal_class_ex(&ce, php_http_message_class_entry, NULL TSRMLS_CC);
+	php_http_client_response_class_entry->create_object = php_http_client_response_object_new;
+	memcpy(&php_http_client_response_object_handlers, php_http_message_object_get_handlers(), sizeof(zend_object_handlers));
+	php_http_client_response_object_handlers.clone_obj = php_http_client_response_object_clone;
+	php_http_client_response_object_handlers.read_property = php_http_client_response_object_read_prop;
+	php_http_client_response_object_handlers.write_property = php_http_client_response_object_write_prop;
+	php_http_client_response_object_handlers.has_property = php_http_client_response_object_has_prop;
+	php_http_client_response_object_handlers.get_properties = php_http_client_response_object_get_props;
 	zend_declare_property_null(php_http_client_response_class_entry, ZEND_STRL("transferInfo"), ZEND_ACC_PROTECTED TSRMLS_CC);
 
 	return SUCCESS;
@@ -13,9 +13,20 @@
 #ifndef PHP_HTTP_CLIENT_RESPONSE_H
 #define PHP_HTTP_CLIENT_RESPONSE_H
 
+typedef struct php_http_client_response_object {
+	php_http_message_object_t message;
+	/* not yet materialized transferInfo */
+	php_http_client_transfer_info_t *info;
+} php_http_client_response_object_t;
+
 PHP_HTTP_API zend_class_entry *php_http_client_response_class_entry;
 PHP_MINIT_FUNCTION(http_client_response);
 
+zend_object_value php_http_client_response_object_new(zend_class_entry *ce TSRMLS_DC);
+zend_object_value php_http_client_response_object_new_ex(zend_class_entry *ce, php_http_message_t *msg, php_http_client_response_object_t **ptr TSRMLS_DC);
+zend_object_value php_http_client_response_object_clone(zval *object TSRMLS_DC);
+void php_http_client_response_object_free(void *object TSRMLS_DC);
+
 #endif /* PHP_HTTP_CLIENT_RESPONSE_H */
 
 
@@ -108,78 +108,183 @@ const char *php_http_encoding_dechunk(const char *encoded, size_t encoded_len, c
 	return e_ptr;
 }
 
-static inline int php_http_inflate_rounds(z_stream *Z, int flush, char **buf, size_t *len)
+/* zlib states are expensive to set up, so idle ones are kept in a pool and reset for reuse */
+struct php_http_zlib_state {
+	z_stream Z;
+	int key;
+};
+
+#define PHP_HTTP_ZLIB_KEY(level, wbits, strategy) \
+	((((level) + 1) << 16) | (((wbits) & 0xff) << 8) | (strategy))
+
+static void php_http_zlib_free(z_streamp Z, int inflating)
+{
+	if (inflating) {
+		inflateEnd(Z);
+	} else {
+		deflateEnd(Z);
+	}
+	if (Z->opaque) {
+		php_http_buffer_free((php_http_buffer_t **) &Z->opaque);
+	}
+	pefree(Z, 1);
+}
+
+static z_streamp php_http_zlib_get(int inflating, int level, int wbits, int strategy, int *status TSRMLS_DC)
+{
+	php_http_encoding_pool_t *pool = inflating ? &PHP_HTTP_G->encoding.inflate : &PHP_HTTP_G->encoding.deflate;
+	struct php_http_zlib_state *state;
+	int key = PHP_HTTP_ZLIB_KEY(level, wbits, strategy);
+	unsigned i;
+
+	for (i = pool->count; i-- > 0;) {
+		state = (struct php_http_zlib_state *) pool->idle[i];
+
+		if (state->key == key) {
+			pool->idle[i] = pool->idle[--pool->count];
+			*status = Z_OK;
+			return &state->Z;
+		}
+	}
+
+	/* zlib allocates with malloc() anyway, so this can outlive the request */
+	state = pecalloc(1, sizeof(*state), 1);
+	state->key = key;
+
+	if (inflating) {
+		*status = inflateInit2(&state->Z, wbits);
+	} else {
+		*status = deflateInit2(&state->Z, level, Z_DEFLATED, wbits, MAX_MEM_LEVEL, strategy);
+	}
+	if (Z_OK == *status) {
+		return &state->Z;
+	}
+	pefree(state, 1);
+	return NULL;
+}
+
+static void php_http_zlib_put(z_streamp Z, int inflating TSRMLS_DC)
+{
+	php_http_encoding_pool_t *pool = inflating ? &PHP_HTTP_G->encoding.inflate : &PHP_HTTP_G->encoding.deflate;
+	php_http_buffer_t *rest = Z->opaque;
+
+	if (pool->count >= PHP_HTTP_ENCODING_POOL_SIZE || Z_OK != (inflating ? inflateReset(Z) : deflateReset(Z))) {
+		php_http_zlib_free(Z, inflating);
+		return;
+	}
+
+	if (rest) {
+		/* do not hold on to exceptionally large input rests */
+		if (rest->used + rest->free > PHP_HTTP_DEFLATE_BUFFER_SIZE) {
+			php_http_buffer_free(&rest);
+			Z->opaque = NULL;
+		} else {
+			php_http_buffer_reset(rest);
+		}
+	}
+	pool->idle[pool->count++] = Z;
+}
+
+static int php_http_zlib_inflate_raw(z_streamp Z)
+{
+	((struct php_http_zlib_state *) Z)->key = PHP_HTTP_ZLIB_KEY(0, PHP_HTTP_WINDOW_BITS_RAW, 0);
+	/* keeps the pooled window allocation */
+	return inflateReset2(Z, PHP_HTTP_WINDOW_BITS_RAW);
+}
+
+static inline z_streamp php_http_zlib_copy(z_streamp from, int inflating, int *status)
+{
+	struct php_http_zlib_state *state = pecalloc(1, sizeof(*state), 1);
+
+	if (inflating) {
+		*status = inflateCopy(&state->Z, from);
+	} else {
+		*status = deflateCopy(&state->Z, from);
+	}
+	if (Z_OK == *status) {
+		state->key = ((struct php_http_zlib_state *) from)->key;
+		state->Z.opaque = NULL;
+		return &state->Z;
+	}
+	pefree(state, 1);
+	return NULL;
+}
+
+/* keep the input zlib did not consume for the next round */
+static inline void php_http_zlib_keep_rest(z_streamp Z, int buffered)
+{
+	php_http_buffer_t *rest = Z->opaque;
+
+	if (buffered) {
+		if (Z->avail_in) {
+			php_http_buffer_cut(rest, 0, rest->used - Z->avail_in);
+		} else {
+			php_http_buffer_reset(rest);
+		}
+	} else if (Z->avail_in) {
+		php_http_buffer_append(rest, (const char *) Z->next_in, Z->avail_in);
+	}
+}
+
+static inline int php_http_inflate_into(z_stream *Z, int flush, php_http_buffer_t *buffer)
 {
 	int status = 0, round = 0;
-	php_http_buffer_t buffer;
-	
-	*buf = NULL;
-	*len = 0;
-	
-	php_http_buffer_init_ex(&buffer, Z->avail_in, PHP_HTTP_BUFFER_INIT_PREALLOC);
+	size_t size = PHP_HTTP_INFLATE_BUFFER_SIZE_GUESS(Z->avail_in);
 	
 	do {
-		if (PHP_HTTP_BUFFER_NOMEM == php_http_buffer_resize_ex(&buffer, buffer.size, 0, 1)) {
-			status = Z_MEM_ERROR;
-		} else {
-			Z->avail_out = buffer.free;
-			Z->next_out = (Bytef *) buffer.data + buffer.used;
-#if 0
-			fprintf(stderr, "\n%3d: %3d PRIOR: size=%7lu,\tfree=%7lu,\tused=%7lu,\tavail_in=%7lu,\tavail_out=%7lu\n", round, status, buffer.size, buffer.free, buffer.used, Z->avail_in, Z->avail_out);
-#endif
-			status = inflate(Z, flush);
-			php_http_buffer_account(&buffer, buffer.free - Z->avail_out);
-#if 0
-			fprintf(stderr, "%3d: %3d AFTER: size=%7lu,\tfree=%7lu,\tused=%7lu,\tavail_in=%7lu,\tavail_out=%7lu\n", round, status, buffer.size, buffer.free, buffer.used, Z->avail_in, Z->avail_out);
-#endif
-			PHP_HTTP_INFLATE_BUFFER_SIZE_ALIGN(buffer.size);
+		if (PHP_HTTP_BUFFER_NOMEM == php_http_buffer_resize_ex(buffer, size, 0, 1)) {
+			return Z_MEM_ERROR;
 		}
-	} while ((Z_BUF_ERROR == status || (Z_OK == status && Z->avail_in)) && ++round < PHP_HTTP_INFLATE_ROUNDS);
+		Z->avail_out = buffer->free;
+		Z->next_out = (Bytef *) buffer->data + buffer->used;
+		status = inflate(Z, flush);
+		php_http_buffer_account(buffer, buffer->free - Z->avail_out);
+		PHP_HTTP_INFLATE_BUFFER_SIZE_ALIGN(size);
+	} while ((Z_OK == status || Z_BUF_ERROR == status) && !Z->avail_out && ++round < PHP_HTTP_INFLATE_ROUNDS);
 	
-	if (status == Z_OK || status == Z_STREAM_END) {
-		php_http_buffer_shrink(&buffer);
-		php_http_buffer_fix(&buffer);
-		*buf = buffer.data;
-		*len = buffer.used;
-	} else {
-		php_http_buffer_dtor(&buffer);
+	/* all input consumed, zlib only complains that it could not make progress */
+	if (Z_BUF_ERROR == status && Z->avail_out) {
+		status = Z_OK;
 	}
-	
 	return status;
 }
 
 ZEND_RESULT_CODE php_http_encoding_deflate(int flags, const char *data, size_t data_len, char **encoded, size_t *encoded_len TSRMLS_DC)
 {
 	int status, level, wbits, strategy;
-	z_stream Z;
+	z_streamp Z;
 	
 	PHP_HTTP_DEFLATE_LEVEL_SET(flags, level);
 	PHP_HTTP_DEFLATE_WBITS_SET(flags, wbits);
 	PHP_HTTP_DEFLATE_STRATEGY_SET(flags, strategy);
 	
-	memset(&Z, 0, sizeof(z_stream));
+	/* a single worker only splits the input for nothing */
+	if ((flags & PHP_HTTP_DEFLATE_PARALLEL) && PHP_HTTP_G->encoding.deflate_threads > 1 && data_len > PHP_HTTP_DEFLATE_PARALLEL_BLOCK) {
+		return php_http_encoding_deflate_parallel(flags, data, data_len, encoded, encoded_len TSRMLS_CC);
+	}
+	
 	*encoded = NULL;
 	*encoded_len = 0;
 	
-	status = deflateInit2(&Z, level, Z_DEFLATED, wbits, MAX_MEM_LEVEL, strategy);
-	if (Z_OK == status) {
+	if ((Z = php_http_zlib_get(0, level, wbits, strategy, &status TSRMLS_CC))) {
 		*encoded_len = PHP_HTTP_DEFLATE_BUFFER_SIZE_GUESS(data_len);
 		*encoded = emalloc(*encoded_len);
 		
-		Z.next_in = (Bytef *) data;
-		Z.next_out = (Bytef *) *encoded;
-		Z.avail_in = data_len;
-		Z.avail_out = *encoded_len;
+		Z->next_in = (Bytef *) data;
+		Z->next_out = (Bytef *) *encoded;
+		Z->avail_in = data_len;
+		Z->avail_out = *encoded_len;
 		
-		status = deflate(&Z, Z_FINISH);
-		deflateEnd(&Z);
+		status = deflate(Z, Z_FINISH);
 		
 		if (Z_STREAM_END == status) {
 			/* size buffer down to actual length */
-			*encoded = erealloc(*encoded, Z.total_out + 1);
-			(*encoded)[*encoded_len = Z.total_out] = '\0';
+			*encoded = erealloc(*encoded, Z->total_out + 1);
+			(*encoded)[*encoded_len = Z->total_out] = '\0';
+			php_http_zlib_put(Z, 0 TSRMLS_CC);
 			return SUCCESS;
 		} else {
+			php_http_zlib_put(Z, 0 TSRMLS_CC);
 			PTR_SET(*encoded, NULL);
 			*encoded_len = 0;
 		}
@@ -191,20 +296,27 @@ ZEND_RESULT_CODE php_http_encoding_deflate(int flags, const char *data, size_t d
 
 ZEND_RESULT_CODE php_http_encoding_inflate(const char *data, size_t data_len, char **decoded, size_t *decoded_len TSRMLS_DC)
 {
-	z_stream Z;
-	int status, wbits = PHP_HTTP_WINDOW_BITS_ANY;
+	z_streamp Z;
+	int status, raw = 0;
+	php_http_buffer_t buffer;
 	
-	memset(&Z, 0, sizeof(z_stream));
+	*decoded = NULL;
+	*decoded_len = 0;
 	
+	if ((Z = php_http_zlib_get(1, 0, PHP_HTTP_WINDOW_BITS_ANY, 0, &status TSRMLS_CC))) {
+		php_http_buffer_init_ex(&buffer, data_len, PHP_HTTP_BUFFER_INIT_PREALLOC);
+		
 retry_raw_inflate:
-	status = inflateInit2(&Z, wbits);
-	if (Z_OK == status) {
-		Z.next_in = (Bytef *) data;
-		Z.avail_in = data_len + 1; /* include the terminating NULL, see #61287 */
+		Z->next_in = (Bytef *) data;
+		Z->avail_in = data_len + 1; /* include the terminating NULL, see #61287 */
 		
-		switch (status = php_http_inflate_rounds(&Z, Z_NO_FLUSH, decoded, decoded_len)) {
+		switch (status = php_http_inflate_into(Z, Z_NO_FLUSH, &buffer)) {
 			case Z_STREAM_END:
-				inflateEnd(&Z);
+				php_http_zlib_put(Z, 1 TSRMLS_CC);
+				php_http_buffer_shrink(&buffer);
+				php_http_buffer_fix(&buffer);
+				*decoded = buffer.data;
+				*decoded_len = buffer.used;
 				return SUCCESS;
 
 			case Z_OK:
@@ -213,18 +325,16 @@ retry_raw_inflate:
 			
 			case Z_DATA_ERROR:
 				/* raw deflated data? */
-				if (PHP_HTTP_WINDOW_BITS_ANY == wbits) {
-					inflateEnd(&Z);
-					wbits = PHP_HTTP_WINDOW_BITS_RAW;
+				if (!raw) {
+					raw = 1;
+					php_http_buffer_reset(&buffer);
+					php_http_zlib_inflate_raw(Z);
 					goto retry_raw_inflate;
 				}
 				break;
 		}
-		inflateEnd(&Z);
-
-		if (decoded_len && *decoded) {
-			efree(*decoded);
-		}
+		php_http_zlib_put(Z, 1 TSRMLS_CC);
+		php_http_buffer_dtor(&buffer);
 	}
 	
 	php_error_docref(NULL TSRMLS_CC, E_WARNING, "Could not inflate data: %s", zError(status));
@@ -305,10 +415,42 @@ ZEND_RESULT_CODE php_http_encoding_stream_reset(php_http_encoding_stream_t **s)
 
 ZEND_RESULT_CODE php_http_encoding_stream_update(php_http_encoding_stream_t *s, const char *in_str, size_t in_len, char **out_str, size_t *out_len)
 {
-	if (!s->ops->update) {
+	if (s->ops->update) {
+		return s->ops->update(s, in_str, in_len, out_str, out_len);
+	}
+	if (s->ops->update_buffer) {
+		php_http_buffer_t buf;
+
+		php_http_buffer_init(&buf);
+		if (SUCCESS == s->ops->update_buffer(s, in_str, in_len, &buf)) {
+			php_http_buffer_fix(&buf);
+			*out_str = buf.data;
+			*out_len = buf.used;
+			return SUCCESS;
+		}
+		php_http_buffer_dtor(&buf);
+		*out_str = NULL;
+		*out_len = 0;
+	}
+	return FAILURE;
+}
+
+ZEND_RESULT_CODE php_http_encoding_stream_update_buffer(php_http_encoding_stream_t *s, const char *in_str, size_t in_len, php_http_buffer_t *out)
+{
+	char *out_str = NULL;
+	size_t out_len = 0;
+
+	if (s->ops->update_buffer) {
+		return s->ops->update_buffer(s, in_str, in_len, out);
+	}
+	if (!s->ops->update || SUCCESS != s->ops->update(s, in_str, in_len, &out_str, &out_len)) {
 		return FAILURE;
 	}
-	return s->ops->update(s, in_str, in_len, out_str, out_len);
+	if (out_str) {
+		php_http_buffer_append(out, out_str, out_len);
+		efree(out_str);
+	}
+	return SUCCESS;
 }
 
 ZEND_RESULT_CODE php_http_encoding_stream_flush(php_http_encoding_stream_t *s, char **out_str, size_t *out_len)
@@ -357,66 +499,183 @@ void php_http_encoding_stream_free(php_http_encoding_stream_t **s)
 	}
 }
 
+php_http_encoding_dechunker_t *php_http_encoding_dechunker_init(php_http_encoding_dechunker_t *d, zend_bool persistent)
+{
+	if (!d) {
+		d = pemalloc(sizeof(*d), persistent);
+	}
+	memset(d, 0, sizeof(*d));
+	php_http_buffer_init_ex(&d->line, 0x40, persistent ? PHP_HTTP_BUFFER_INIT_PERSISTENT : 0);
+
+	return d;
+}
+
+/* parses the hex chunk size at the start of str, returns the length of the number, or 0 if bad */
+static size_t php_http_encoding_dechunker_hex(const char *str, size_t len, size_t *hex)
+{
+	size_t pos = 0, beg, num = 0;
+
+	/* leading white space, like strtoul() */
+	while (pos < len && (str[pos] == ' ' || str[pos] == '\t')) {
+		++pos;
+	}
+	for (beg = pos; pos < len && isxdigit((unsigned char) str[pos]); ++pos) {
+		if (num > ((size_t) -1) >> 4) {
+			return 0;
+		}
+		num = (num << 4) | (isdigit((unsigned char) str[pos]) ? str[pos] - '0' : (tolower((unsigned char) str[pos]) - 'a' + 10));
+	}
+	if (pos == beg) {
+		return 0;
+	}
+	*hex = num;
+	return pos;
+}
+
+size_t php_http_encoding_dechunker_update(php_http_encoding_dechunker_t *d, const char *str, size_t len, php_http_pass_callback_t cb, void *cb_arg TSRMLS_DC)
+{
+	size_t off = 0;
+
+	while (off < len && !d->zeroed) {
+		/* we already know the size of the chunk and pass on what we've got */
+		if (d->hexlen) {
+			size_t n = MIN(d->hexlen, len - off);
+
+			if (n != cb(cb_arg, str + off, n)) {
+				return -1;
+			}
+			off += n;
+			d->hexlen -= n;
+		}
+
+		/* we don't know the length of the chunk yet */
+		else {
+			const char *line = str + off, *eol;
+			size_t take, line_len, stop;
+
+			if (!d->line.used) {
+				/* ignore preceeding CRLFs (too loose?) */
+				while (off < len && (str[off] == '\n' || str[off] == '\r')) {
+					++off;
+				}
+				if (off == len) {
+					break;
+				}
+				line = str + off;
+			}
+
+			eol = php_http_scan_eol(line, len - off);
+
+			if (d->line.used && d->line.data[d->line.used - 1] == '\r' && *line != '\n') {
+				/* a single CR ended the line at the end of the previous input */
+				take = 0;
+			} else if (!eol || (*eol == '\r' && eol + 1 == str + len)) {
+				/* we need eol, so we can be sure we have all hex digits */
+				php_http_buffer_append(&d->line, line, len - off);
+				off = len;
+				break;
+			} else {
+				take = eol - line + ((eol[0] == '\r' && eol[1] == '\n') ? 2 : 1);
+			}
+
+			if (d->line.used) {
+				php_http_buffer_append(&d->line, line, take);
+				php_http_buffer_fix(&d->line);
+				line = d->line.data;
+				line_len = d->line.used;
+			} else {
+				line_len = take;
+			}
+
+			/* read in chunk size, strictly within the line, which is not NUL terminated */
+			stop = php_http_encoding_dechunker_hex(line, line_len, &d->hexlen);
+
+			/*	if we stop at the beginning of the line
+				there's something oddly wrong, i.e. bad input */
+			if (!stop) {
+				php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to parse chunk len from '%.*s'", (int) MIN(16, line_len), line);
+				return -1;
+			}
+
+			php_http_buffer_reset(&d->line);
+			off += take;
+
+			/* d->hexlen is 0 now or contains the size of the next chunk */
+			if (!d->hexlen) {
+				/* ignore following CRLFs (too loose?) */
+				while (off < len && (str[off] == '\n' || str[off] == '\r')) {
+					++off;
+				}
+				d->zeroed = 1;
+			}
+		}
+	}
+
+	return off;
+}
+
+void php_http_encoding_dechunker_dtor(php_http_encoding_dechunker_t *d)
+{
+	php_http_buffer_dtor(&d->line);
+}
+
 struct dechunk_ctx {
+	/* input following the last chunk */
 	php_http_buffer_t buffer;
-	ulong hexlen;
-	unsigned zeroed:1;
+	php_http_encoding_dechunker_t dechunker;
 };
 
 static php_http_encoding_stream_t *deflate_init(php_http_encoding_stream_t *s)
 {
-	int status, level, wbits, strategy, p = (s->flags & PHP_HTTP_ENCODING_STREAM_PERSISTENT);
-	z_streamp ctx = pecalloc(1, sizeof(z_stream), p);
+	int status, level, wbits, strategy;
+	z_streamp ctx;
 	TSRMLS_FETCH_FROM_CTX(s->ts);
 	
 	PHP_HTTP_DEFLATE_LEVEL_SET(s->flags, level);
 	PHP_HTTP_DEFLATE_WBITS_SET(s->flags, wbits);
 	PHP_HTTP_DEFLATE_STRATEGY_SET(s->flags, strategy);
 	
-	if (Z_OK == (status = deflateInit2(ctx, level, Z_DEFLATED, wbits, MAX_MEM_LEVEL, strategy))) {
-		if ((ctx->opaque = php_http_buffer_init_ex(NULL, PHP_HTTP_DEFLATE_BUFFER_SIZE, p ? PHP_HTTP_BUFFER_INIT_PERSISTENT : 0))) {
+	if ((ctx = php_http_zlib_get(0, level, wbits, strategy, &status TSRMLS_CC))) {
+		if (ctx->opaque || (ctx->opaque = php_http_buffer_init_ex(NULL, PHP_HTTP_DEFLATE_BUFFER_SIZE, PHP_HTTP_BUFFER_INIT_PERSISTENT))) {
 			s->ctx = ctx;
 			return s;
 		}
-		deflateEnd(ctx);
+		php_http_zlib_put(ctx, 0 TSRMLS_CC);
 		status = Z_MEM_ERROR;
 	}
-	pefree(ctx, p);
 	php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to initialize deflate encoding stream: %s", zError(status));
 	return NULL;
 }
 
 static php_http_encoding_stream_t *inflate_init(php_http_encoding_stream_t *s)
 {
-	int status, wbits, p = (s->flags & PHP_HTTP_ENCODING_STREAM_PERSISTENT);
-	z_streamp ctx = pecalloc(1, sizeof(z_stream), p);
+	int status, wbits;
+	z_streamp ctx;
 	TSRMLS_FETCH_FROM_CTX(s->ts);
 	
 	PHP_HTTP_INFLATE_WBITS_SET(s->flags, wbits);
 	
-	if (Z_OK == (status = inflateInit2(ctx, wbits))) {
-		if ((ctx->opaque = php_http_buffer_init_ex(NULL, PHP_HTTP_DEFLATE_BUFFER_SIZE, p ? PHP_HTTP_BUFFER_INIT_PERSISTENT : 0))) {
+	if ((ctx = php_http_zlib_get(1, 0, wbits, 0, &status TSRMLS_CC))) {
+		if (ctx->opaque || (ctx->opaque = php_http_buffer_init_ex(NULL, PHP_HTTP_DEFLATE_BUFFER_SIZE, PHP_HTTP_BUFFER_INIT_PERSISTENT))) {
 			s->ctx = ctx;
 			return s;
 		}
-		inflateEnd(ctx);
+		php_http_zlib_put(ctx, 1 TSRMLS_CC);
 		status = Z_MEM_ERROR;
 	}
-	pefree(ctx, p);
 	php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to initialize inflate stream: %s", zError(status));
 	return NULL;
 }
 
 static php_http_encoding_stream_t *dechunk_init(php_http_encoding_stream_t *s)
 {
-	struct dechunk_ctx *ctx = pecalloc(1, sizeof(*ctx), (s->flags & PHP_HTTP_ENCODING_STREAM_PERSISTENT));
+	int p = (s->flags & PHP_HTTP_ENCODING_STREAM_PERSISTENT);
+	struct dechunk_ctx *ctx = pecalloc(1, sizeof(*ctx), p);
 
-	if (!php_http_buffer_init_ex(&ctx->buffer, PHP_HTTP_BUFFER_DEFAULT_SIZE, (s->flags & PHP_HTTP_ENCODING_STREAM_PERSISTENT) ? PHP_HTTP_BUFFER_INIT_PERSISTENT : 0)) {
+	if (!php_http_buffer_init_ex(&ctx->buffer, PHP_HTTP_BUFFER_DEFAULT_SIZE, p ? PHP_HTTP_BUFFER_INIT_PERSISTENT : 0)) {
 		return NULL;
 	}
-
-	ctx->hexlen = 0;
-	ctx->zeroed = 0;
+	php_http_encoding_dechunker_init(&ctx->dechunker, p);
 	s->ctx = ctx;
 
 	return s;
@@ -424,17 +683,17 @@ static php_http_encoding_stream_t *dechunk_init(php_http_encoding_stream_t *s)
 
 static php_http_encoding_stream_t *deflate_copy(php_http_encoding_stream_t *from, php_http_encoding_stream_t *to)
 {
-	int status, p = to->flags & PHP_HTTP_ENCODING_STREAM_PERSISTENT;
-	z_streamp from_ctx = from->ctx, to_ctx = pecalloc(1, sizeof(*to_ctx), p);
+	int status;
+	z_streamp from_ctx = from->ctx, to_ctx;
 	TSRMLS_FETCH_FROM_CTX(from->ts);
 
-	if (Z_OK == (status = deflateCopy(to_ctx, from_ctx))) {
-		if ((to_ctx->opaque = php_http_buffer_init_ex(NULL, PHP_HTTP_DEFLATE_BUFFER_SIZE, p ? PHP_HTTP_BUFFER_INIT_PERSISTENT : 0))) {
+	if ((to_ctx = php_http_zlib_copy(from_ctx, 0, &status))) {
+		if ((to_ctx->opaque = php_http_buffer_init_ex(NULL, PHP_HTTP_DEFLATE_BUFFER_SIZE, PHP_HTTP_BUFFER_INIT_PERSISTENT))) {
 			php_http_buffer_append(to_ctx->opaque, PHP_HTTP_BUFFER(from_ctx->opaque)->data, PHP_HTTP_BUFFER(from_ctx->opaque)->used);
 			to->ctx = to_ctx;
 			return to;
 		}
-		deflateEnd(to_ctx);
+		php_http_zlib_free(to_ctx, 0);
 		status = Z_MEM_ERROR;
 	}
 	php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to copy deflate encoding stream: %s", zError(status));
@@ -443,17 +702,17 @@ static php_http_encoding_stream_t *deflate_copy(php_http_encoding_stream_t *from
 
 static php_http_encoding_stream_t *inflate_copy(php_http_encoding_stream_t *from, php_http_encoding_stream_t *to)
 {
-	int status, p = from->flags & PHP_HTTP_ENCODING_STREAM_PERSISTENT;
-	z_streamp from_ctx = from->ctx, to_ctx = pecalloc(1, sizeof(*to_ctx), p);
+	int status;
+	z_streamp from_ctx = from->ctx, to_ctx;
 	TSRMLS_FETCH_FROM_CTX(from->ts);
 
-	if (Z_OK == (status = inflateCopy(to_ctx, from_ctx))) {
-		if ((to_ctx->opaque = php_http_buffer_init_ex(NULL, PHP_HTTP_DEFLATE_BUFFER_SIZE, p ? PHP_HTTP_BUFFER_INIT_PERSISTENT : 0))) {
+	if ((to_ctx = php_http_zlib_copy(from_ctx, 1, &status))) {
+		if ((to_ctx->opaque = php_http_buffer_init_ex(NULL, PHP_HTTP_DEFLATE_BUFFER_SIZE, PHP_HTTP_BUFFER_INIT_PERSISTENT))) {
 			php_http_buffer_append(to_ctx->opaque, PHP_HTTP_BUFFER(from_ctx->opaque)->data, PHP_HTTP_BUFFER(from_ctx->opaque)->used);
 			to->ctx = to_ctx;
 			return to;
 		}
-		inflateEnd(to_ctx);
+		php_http_zlib_free(to_ctx, 1);
 		status = Z_MEM_ERROR;
 	}
 	php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to copy inflate encoding stream: %s", zError(status));
@@ -467,8 +726,10 @@ static php_http_encoding_stream_t *dechunk_copy(php_http_encoding_stream_t *from
 	TSRMLS_FETCH_FROM_CTX(from->ts);
 
 	if (php_http_buffer_init_ex(&to_ctx->buffer, PHP_HTTP_BUFFER_DEFAULT_SIZE, p ? PHP_HTTP_BUFFER_INIT_PERSISTENT : 0)) {
-		to_ctx->hexlen = from_ctx->hexlen;
-		to_ctx->zeroed = from_ctx->zeroed;
+		php_http_encoding_dechunker_init(&to_ctx->dechunker, p);
+		to_ctx->dechunker.hexlen = from_ctx->dechunker.hexlen;
+		to_ctx->dechunker.zeroed = from_ctx->dechunker.zeroed;
+		php_http_buffer_append(&to_ctx->dechunker.line, from_ctx->dechunker.line.data, from_ctx->dechunker.line.used);
 		php_http_buffer_append(&to_ctx->buffer, from_ctx->buffer.data, from_ctx->buffer.used);
 		to->ctx = to_ctx;
 		return to;
@@ -478,77 +739,85 @@ static php_http_encoding_stream_t *dechunk_copy(php_http_encoding_stream_t *from
 	return NULL;
 }
 
-static ZEND_RESULT_CODE deflate_update(php_http_encoding_stream_t *s, const char *data, size_t data_len, char **encoded, size_t *encoded_len)
+static ZEND_RESULT_CODE deflate_update_buffer(php_http_encoding_stream_t *s, const char *data, size_t data_len, php_http_buffer_t *encoded)
 {
-	int status;
+	int status, round = 0, buffered;
 	z_streamp ctx = s->ctx;
 	TSRMLS_FETCH_FROM_CTX(s->ts);
 	
-	/* append input to our buffer */
-	php_http_buffer_append(PHP_HTTP_BUFFER(ctx->opaque), data, data_len);
+	/* deflate straight from the input, unless there is a rest from before */
+	if ((buffered = (PHP_HTTP_BUFFER(ctx->opaque)->used > 0))) {
+		php_http_buffer_append(PHP_HTTP_BUFFER(ctx->opaque), data, data_len);
+		ctx->next_in = (Bytef *) PHP_HTTP_BUFFER(ctx->opaque)->data;
+		ctx->avail_in = PHP_HTTP_BUFFER(ctx->opaque)->used;
+	} else {
+		ctx->next_in = (Bytef *) data;
+		ctx->avail_in = data_len;
+	}
 	
-	ctx->next_in = (Bytef *) PHP_HTTP_BUFFER(ctx->opaque)->data;
-	ctx->avail_in = PHP_HTTP_BUFFER(ctx->opaque)->used;
+	/* deflate, while zlib fills up the output space we offer */
+	do {
+		if (PHP_HTTP_BUFFER_NOMEM == php_http_buffer_resize(encoded, PHP_HTTP_DEFLATE_BUFFER_SIZE_GUESS(ctx->avail_in))) {
+			status = Z_MEM_ERROR;
+			break;
+		}
+		ctx->avail_out = encoded->free;
+		ctx->next_out = (Bytef *) encoded->data + encoded->used;
+		status = deflate(ctx, PHP_HTTP_ENCODING_STREAM_FLUSH_FLAG(s->flags));
+		php_http_buffer_account(encoded, encoded->free - ctx->avail_out);
+	} while (Z_OK == status && !ctx->avail_out && ++round);
 	
-	/* deflate */
-	*encoded_len = PHP_HTTP_DEFLATE_BUFFER_SIZE_GUESS(data_len);
-	*encoded = emalloc(*encoded_len);
-	ctx->avail_out = *encoded_len;
-	ctx->next_out = (Bytef *) *encoded;
+	/* no progress possible after the output space has been used up exactly */
+	if (Z_BUF_ERROR == status && round) {
+		status = Z_OK;
+	}
 	
-	switch (status = deflate(ctx, PHP_HTTP_ENCODING_STREAM_FLUSH_FLAG(s->flags))) {
+	switch (status) {
 		case Z_OK:
 		case Z_STREAM_END:
-			/* cut processed chunk off the buffer */
-			if (ctx->avail_in) {
-				php_http_buffer_cut(PHP_HTTP_BUFFER(ctx->opaque), 0, PHP_HTTP_BUFFER(ctx->opaque)->used - ctx->avail_in);
-			} else {
-				php_http_buffer_reset(PHP_HTTP_BUFFER(ctx->opaque));
-			}
-			
-			/* size buffer down to actual size */
-			*encoded_len -= ctx->avail_out;
-			*encoded = erealloc(*encoded, *encoded_len + 1);
-			(*encoded)[*encoded_len] = '\0';
+			php_http_zlib_keep_rest(ctx, buffered);
 			return SUCCESS;
 	}
 	
-	PTR_SET(*encoded, NULL);
-	*encoded_len = 0;
 	php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to update deflate stream: %s", zError(status));
 	return FAILURE;
 }
 
-static ZEND_RESULT_CODE inflate_update(php_http_encoding_stream_t *s, const char *data, size_t data_len, char **decoded, size_t *decoded_len)
+static ZEND_RESULT_CODE inflate_update_buffer(php_http_encoding_stream_t *s, const char *data, size_t data_len, php_http_buffer_t *decoded)
 {
-	int status;
+	int status, buffered;
+	size_t used = decoded->used;
 	z_streamp ctx = s->ctx;
 	TSRMLS_FETCH_FROM_CTX(s->ts);
 	
-	/* append input to buffer */
-	php_http_buffer_append(PHP_HTTP_BUFFER(ctx->opaque), data, data_len);
+	/* inflate straight from the input, unless there is a rest from before */
+	if ((buffered = (PHP_HTTP_BUFFER(ctx->opaque)->used > 0))) {
+		php_http_buffer_append(PHP_HTTP_BUFFER(ctx->opaque), data, data_len);
+	}
 
 retry_raw_inflate:
-	ctx->next_in = (Bytef *) PHP_HTTP_BUFFER(ctx->opaque)->data;
-	ctx->avail_in = PHP_HTTP_BUFFER(ctx->opaque)->used;
+	if (buffered) {
+		ctx->next_in = (Bytef *) PHP_HTTP_BUFFER(ctx->opaque)->data;
+		ctx->avail_in = PHP_HTTP_BUFFER(ctx->opaque)->used;
+	} else {
+		ctx->next_in = (Bytef *) data;
+		ctx->avail_in = data_len;
+	}
 	
-	switch (status = php_http_inflate_rounds(ctx, PHP_HTTP_ENCODING_STREAM_FLUSH_FLAG(s->flags), decoded, decoded_len)) {
+	switch (status = php_http_inflate_into(ctx, PHP_HTTP_ENCODING_STREAM_FLUSH_FLAG(s->flags), decoded)) {
 		case Z_OK:
 		case Z_STREAM_END:
-			/* cut off */
-			if (ctx->avail_in) {
-				php_http_buffer_cut(PHP_HTTP_BUFFER(ctx->opaque), 0, PHP_HTTP_BUFFER(ctx->opaque)->used - ctx->avail_in);
-			} else {
-				php_http_buffer_reset(PHP_HTTP_BUFFER(ctx->opaque));
-			}
+			php_http_zlib_keep_rest(ctx, buffered);
 			return SUCCESS;
 		
 		case Z_DATA_ERROR:
 			/* raw deflated data ? */
 			if (!(s->flags & PHP_HTTP_INFLATE_TYPE_RAW) && !ctx->total_out) {
-				inflateEnd(ctx);
 				s->flags |= PHP_HTTP_INFLATE_TYPE_RAW;
-				inflateInit2(ctx, PHP_HTTP_WINDOW_BITS_RAW);
+				/* drop whatever the failed attempt left in the output */
+				decoded->free += decoded->used - used;
+				decoded->used = used;
+				php_http_zlib_inflate_raw(ctx);
 				goto retry_raw_inflate;
 			}
 			break;
@@ -561,122 +830,29 @@ retry_raw_inflate:
 static ZEND_RESULT_CODE dechunk_update(php_http_encoding_stream_t *s, const char *data, size_t data_len, char **decoded, size_t *decoded_len)
 {
 	php_http_buffer_t tmp;
+	size_t consumed;
 	struct dechunk_ctx *ctx = s->ctx;
 	TSRMLS_FETCH_FROM_CTX(s->ts);
 
-	if (ctx->zeroed) {
+	if (ctx->dechunker.zeroed) {
 		php_error_docref(NULL TSRMLS_CC, E_WARNING, "Dechunk encoding stream has already reached the end of chunked input");
 		return FAILURE;
 	}
-	if ((PHP_HTTP_BUFFER_NOMEM == php_http_buffer_append(&ctx->buffer, data, data_len)) || !php_http_buffer_fix(&ctx->buffer)) {
-		/* OOM */
-		return FAILURE;
-	}
 
 	*decoded = NULL;
 	*decoded_len = 0;
 
 	php_http_buffer_init(&tmp);
 
-	/* we have data in our buffer */
-	while (ctx->buffer.used) {
-
-		/* we already know the size of the chunk and are waiting for data */
-		if (ctx->hexlen) {
-
-			/* not enough data buffered */
-			if (ctx->buffer.used < ctx->hexlen) {
-
-				/* flush anyway? */
-				if (s->flags & PHP_HTTP_ENCODING_STREAM_FLUSH_FULL) {
-					/* flush all data (should only be chunk data) */
-					php_http_buffer_append(&tmp, ctx->buffer.data, ctx->buffer.used);
-					/* waiting for less data now */
-					ctx->hexlen -= ctx->buffer.used;
-					/* no more buffered data */
-					php_http_buffer_reset(&ctx->buffer);
-					/* break */
-				}
-
-				/* we have too less data and don't need to flush */
-				else {
-					break;
-				}
-			}
-
-			/* we seem to have all data of the chunk */
-			else {
-				php_http_buffer_append(&tmp, ctx->buffer.data, ctx->hexlen);
-				/* remove outgoing data from the buffer */
-				php_http_buffer_cut(&ctx->buffer, 0, ctx->hexlen);
-				/* reset hexlen */
-				ctx->hexlen = 0;
-				/* continue */
-			}
-		}
-
-		/* we don't know the length of the chunk yet */
-		else {
-			size_t off = 0;
-
-			/* ignore preceeding CRLFs (too loose?) */
-			while (off < ctx->buffer.used && (
-					ctx->buffer.data[off] == '\n' ||
-					ctx->buffer.data[off] == '\r')) {
-				++off;
-			}
-			if (off) {
-				php_http_buffer_cut(&ctx->buffer, 0, off);
-			}
-
-			/* still data there? */
-			if (ctx->buffer.used) {
-				int eollen;
-				const char *eolstr;
-
-				/* we need eol, so we can be sure we have all hex digits */
-				php_http_buffer_fix(&ctx->buffer);
-				if ((eolstr = php_http_locate_bin_eol(ctx->buffer.data, ctx->buffer.used, &eollen))) {
-					char *stop = NULL;
-
-					/* read in chunk size */
-					ctx->hexlen = strtoul(ctx->buffer.data, &stop, 16);
-
-					/*	if strtoul() stops at the beginning of the buffered data
-						there's something oddly wrong, i.e. bad input */
-					if (stop == ctx->buffer.data) {
-						php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to parse chunk len from '%.*s'", (int) MIN(16, ctx->buffer.used), ctx->buffer.data);
-						php_http_buffer_dtor(&tmp);
-						return FAILURE;
-					}
+	consumed = php_http_encoding_dechunker_update(&ctx->dechunker, data, data_len, (php_http_pass_callback_t) php_http_buffer_append, &tmp TSRMLS_CC);
+	if (consumed == (size_t) -1) {
+		php_http_buffer_dtor(&tmp);
+		return FAILURE;
+	}
 
-					/* cut out <chunk size hex><chunk extension><eol> */
-					php_http_buffer_cut(&ctx->buffer, 0, eolstr + eollen - ctx->buffer.data);
-					/* buffer->hexlen is 0 now or contains the size of the next chunk */
-					if (!ctx->hexlen) {
-						size_t off = 0;
-
-						/* ignore following CRLFs (too loose?) */
-						while (off < ctx->buffer.used && (
-								ctx->buffer.data[off] == '\n' ||
-								ctx->buffer.data[off] == '\r')) {
-							++off;
-						}
-						if (off) {
-							php_http_buffer_cut(&ctx->buffer, 0, off);
-						}
-
-						ctx->zeroed = 1;
-						break;
-					}
-					/* continue */
-				} else {
-					/* we have not enough data buffered to read in chunk size */
-					break;
-				}
-			}
-			/* break */
-		}
+	/* keep what follows the last chunk; the message parser looks at it */
+	if (ctx->dechunker.zeroed && consumed < data_len) {
+		php_http_buffer_append(&ctx->buffer, data + consumed, data_len - consumed);
 	}
 
 	php_http_buffer_fix(&tmp);
@@ -717,20 +893,9 @@ static ZEND_RESULT_CODE deflate_flush(php_http_encoding_stream_t *s, char **enco
 
 static ZEND_RESULT_CODE dechunk_flush(php_http_encoding_stream_t *s, char **decoded, size_t *decoded_len)
 {
-	struct dechunk_ctx *ctx = s->ctx;
-
-	if (ctx->hexlen) {
-		/* flush all data (should only be chunk data) */
-		php_http_buffer_fix(&ctx->buffer);
-		php_http_buffer_data(&ctx->buffer, decoded, decoded_len);
-		/* waiting for less data now */
-		ctx->hexlen -= ctx->buffer.used;
-		/* no more buffered data */
-		php_http_buffer_reset(&ctx->buffer);
-	} else {
-		*decoded = NULL;
-		*decoded_len = 0;
-	}
+	/* chunk data is never held back */
+	*decoded = NULL;
+	*decoded_len = 0;
 
 	return SUCCESS;
 }
@@ -825,19 +990,15 @@ static zend_bool inflate_done(php_http_encoding_stream_t *s)
 
 static zend_bool dechunk_done(php_http_encoding_stream_t *s)
 {
-	return ((struct dechunk_ctx *) s->ctx)->zeroed;
+	return ((struct dechunk_ctx *) s->ctx)->dechunker.zeroed;
 }
 
 static void deflate_dtor(php_http_encoding_stream_t *s)
 {
 	if (s->ctx) {
-		z_streamp ctx = s->ctx;
+		TSRMLS_FETCH_FROM_CTX(s->ts);
 
-		if (ctx->opaque) {
-			php_http_buffer_free((php_http_buffer_t **) &ctx->opaque);
-		}
-		deflateEnd(ctx);
-		pefree(ctx, (s->flags & PHP_HTTP_ENCODING_STREAM_PERSISTENT));
+		php_http_zlib_put(s->ctx, 0 TSRMLS_CC);
 		s->ctx = NULL;
 	}
 }
@@ -845,13 +1006,9 @@ static void deflate_dtor(php_http_encoding_stream_t *s)
 static void inflate_dtor(php_http_encoding_stream_t *s)
 {
 	if (s->ctx) {
-		z_streamp ctx = s->ctx;
+		TSRMLS_FETCH_FROM_CTX(s->ts);
 
-		if (ctx->opaque) {
-			php_http_buffer_free((php_http_buffer_t **) &ctx->opaque);
-		}
-		inflateEnd(ctx);
-		pefree(ctx, (s->flags & PHP_HTTP_ENCODING_STREAM_PERSISTENT));
+		php_http_zlib_put(s->ctx, 1 TSRMLS_CC);
 		s->ctx = NULL;
 	}
 }
@@ -862,6 +1019,7 @@ static void dechunk_dtor(php_http_encoding_stream_t *s)
 		struct dechunk_ctx *ctx = s->ctx;
 
 		php_http_buffer_dtor(&ctx->buffer);
+		php_http_encoding_dechunker_dtor(&ctx->dechunker);
 		pefree(ctx, (s->flags & PHP_HTTP_ENCODING_STREAM_PERSISTENT));
 		s->ctx = NULL;
 	}
@@ -870,11 +1028,12 @@ static void dechunk_dtor(php_http_encoding_stream_t *s)
 static php_http_encoding_stream_ops_t php_http_encoding_deflate_ops = {
 	deflate_init,
 	deflate_copy,
-	deflate_update,
+	NULL,
 	deflate_flush,
 	deflate_done,
 	deflate_finish,
-	deflate_dtor
+	deflate_dtor,
+	deflate_update_buffer
 };
 
 php_http_encoding_stream_ops_t *php_http_encoding_stream_get_deflate_ops(void)
@@ -885,11 +1044,12 @@ php_http_encoding_stream_ops_t *php_http_encoding_stream_get_deflate_ops(void)
 static php_http_encoding_stream_ops_t php_http_encoding_inflate_ops = {
 	inflate_init,
 	inflate_copy,
-	inflate_update,
+	NULL,
 	NULL,
 	inflate_done,
 	inflate_finish,
-	inflate_dtor
+	inflate_dtor,
+	inflate_update_buffer
 };
 
 php_http_encoding_stream_ops_t *php_http_encoding_stream_get_inflate_ops(void)
@@ -912,6 +1072,82 @@ php_http_encoding_stream_ops_t *php_http_encoding_stream_get_dechunk_ops(void)
 	return &php_http_encoding_dechunk_ops;
 }
 
+/*
+ * array of name => php_http_encoding_codec_t
+ */
+static HashTable php_http_encoding_codecs;
+
+ZEND_RESULT_CODE php_http_encoding_codec_add(php_http_encoding_codec_t *codec)
+{
+	return zend_hash_add(&php_http_encoding_codecs, codec->name_str, codec->name_len + 1, (void *) codec, sizeof(php_http_encoding_codec_t), NULL);
+}
+
+ZEND_RESULT_CODE php_http_encoding_codec_get(const char *name_str, size_t name_len, php_http_encoding_codec_t *codec)
+{
+	php_http_encoding_codec_t *tmp;
+	char *name = zend_str_tolower_dup(name_str, name_len);
+	ZEND_RESULT_CODE rv = zend_hash_find(&php_http_encoding_codecs, name, name_len + 1, (void *) &tmp);
+
+	efree(name);
+	if (SUCCESS == rv) {
+		*codec = *tmp;
+	}
+	return rv;
+}
+
+ZEND_RESULT_CODE php_http_encoding_codec_match(const char *coding_str, php_http_encoding_codec_t *codec)
+{
+	HashPosition pos;
+	php_http_encoding_codec_t *tmp;
+
+	FOREACH_HASH_VAL(pos, &php_http_encoding_codecs, tmp) {
+		if (tmp->decoder && php_http_match(coding_str, tmp->name_str, PHP_HTTP_MATCH_WORD)) {
+			*codec = *tmp;
+			return SUCCESS;
+		}
+	}
+	return FAILURE;
+}
+
+static int apply_codec_list(void *p, void *arg TSRMLS_DC)
+{
+	php_http_encoding_codec_t *c = p;
+	zval *zname;
+
+	MAKE_STD_ZVAL(zname);
+	ZVAL_STRINGL(zname, c->name_str, c->name_len, 1);
+
+	zend_hash_next_index_insert(arg, &zname, sizeof(zval *), NULL);
+	return ZEND_HASH_APPLY_KEEP;
+}
+
+static int apply_codec_list_encoders(void *p, void *arg TSRMLS_DC)
+{
+	if (!((php_http_encoding_codec_t *) p)->encoder) {
+		return ZEND_HASH_APPLY_KEEP;
+	}
+	return apply_codec_list(p, arg TSRMLS_CC);
+}
+
+void php_http_encoding_codec_list(HashTable *ht, zend_bool encoders TSRMLS_DC)
+{
+	zend_hash_apply_with_argument(&php_http_encoding_codecs, encoders ? apply_codec_list_encoders : apply_codec_list, ht TSRMLS_CC);
+}
+
+static void php_http_encoding_codec_register(const char *name_str, size_t name_len, php_http_encoding_stream_ops_t *encoder, unsigned encoder_flags, php_http_encoding_stream_ops_t *decoder, unsigned decoder_flags)
+{
+	php_http_encoding_codec_t codec;
+
+	codec.name_str = name_str;
+	codec.name_len = name_len;
+	codec.encoder = encoder;
+	codec.encoder_flags = encoder_flags;
+	codec.decoder = decoder;
+	codec.decoder_flags = decoder_flags;
+
+	php_http_encoding_codec_add(&codec);
+}
+
 static zend_object_handlers php_http_encoding_stream_object_handlers;
 
 zend_object_value php_http_encoding_stream_object_new(zend_class_entry *ce TSRMLS_DC)
@@ -982,7 +1218,7 @@ static PHP_METHOD(HttpEncodingStream, __construct)
 	}
 
 	if (instanceof_function(obj->zo.ce, php_http_deflate_stream_class_entry TSRMLS_CC)) {
-		ops = &php_http_encoding_deflate_ops;
+		ops = ((flags & PHP_HTTP_DEFLATE_PARALLEL) && PHP_HTTP_G->encoding.deflate_threads > 1) ? php_http_encoding_stream_get_parallel_deflate_ops() : &php_http_encoding_deflate_ops;
 	} else if (instanceof_function(obj->zo.ce, php_http_inflate_stream_class_entry TSRMLS_CC)) {
 		ops = &php_http_encoding_inflate_ops;
 	} else if (instanceof_function(obj->zo.ce, php_http_dechunk_stream_class_entry TSRMLS_CC)) {
@@ -1078,12 +1314,23 @@ static PHP_METHOD(HttpEncodingStream, finish)
 	}
 }
 
+ZEND_BEGIN_ARG_INFO_EX(ai_HttpEncodingStream_getAvailableCodecs, 0, 0, 0)
+ZEND_END_ARG_INFO();
+static PHP_METHOD(HttpEncodingStream, getAvailableCodecs)
+{
+	if (SUCCESS == zend_parse_parameters_none()) {
+		array_init(return_value);
+		php_http_encoding_codec_list(Z_ARRVAL_P(return_value), 0 TSRMLS_CC);
+	}
+}
+
 static zend_function_entry php_http_encoding_stream_methods[] = {
 	PHP_ME(HttpEncodingStream, __construct,  ai_HttpEncodingStream___construct,  ZEND_ACC_PUBLIC|ZEND_ACC_CTOR)
 	PHP_ME(HttpEncodingStream, update,       ai_HttpEncodingStream_update,       ZEND_ACC_PUBLIC)
 	PHP_ME(HttpEncodingStream, flush,        ai_HttpEncodingStream_flush,        ZEND_ACC_PUBLIC)
 	PHP_ME(HttpEncodingStream, done,         ai_HttpEncodingStream_done,         ZEND_ACC_PUBLIC)
 	PHP_ME(HttpEncodingStream, finish,       ai_HttpEncodingStream_finish,       ZEND_ACC_PUBLIC)
+	PHP_ME(HttpEncodingStream, getAvailableCodecs, ai_HttpEncodingStream_getAvailableCodecs, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
 	EMPTY_FUNCTION_ENTRY
 };
 
@@ -1203,6 +1450,7 @@ PHP_MINIT_FUNCTION(http_encoding)
 	zend_declare_class_constant_long(php_http_deflate_stream_class_entry, ZEND_STRL("STRATEGY_HUFF"), PHP_HTTP_DEFLATE_STRATEGY_HUFF TSRMLS_CC);
 	zend_declare_class_constant_long(php_http_deflate_stream_class_entry, ZEND_STRL("STRATEGY_RLE"), PHP_HTTP_DEFLATE_STRATEGY_RLE TSRMLS_CC);
 	zend_declare_class_constant_long(php_http_deflate_stream_class_entry, ZEND_STRL("STRATEGY_FIXED"), PHP_HTTP_DEFLATE_STRATEGY_FIXED TSRMLS_CC);
+	zend_declare_class_constant_long(php_http_deflate_stream_class_entry, ZEND_STRL("PARALLEL"), PHP_HTTP_DEFLATE_PARALLEL TSRMLS_CC);
 
 	memset(&ce, 0, sizeof(ce));
 	INIT_NS_CLASS_ENTRY(ce, "http\\Encoding\\Stream", "Inflate", php_http_inflate_stream_methods);
@@ -1212,6 +1460,35 @@ PHP_MINIT_FUNCTION(http_encoding)
 	INIT_NS_CLASS_ENTRY(ce, "http\\Encoding\\Stream", "Dechunk", php_http_dechunk_stream_methods);
 	php_http_dechunk_stream_class_entry = zend_register_internal_class_ex(&ce, php_http_encoding_stream_class_entry, NULL TSRMLS_CC);
 
+	zend_hash_init(&php_http_encoding_codecs, 8, NULL, NULL, 1);
+#if PHP_HTTP_HAVE_BROTLI
+	php_http_encoding_codec_register(ZEND_STRL("br"), php_http_encoding_stream_get_brotli_encode_ops(), 0, php_http_encoding_stream_get_brotli_decode_ops(), 0);
+#endif
+#if PHP_HTTP_HAVE_ZSTD
+	php_http_encoding_codec_register(ZEND_STRL("zstd"), php_http_encoding_stream_get_zstd_encode_ops(), 0, php_http_encoding_stream_get_zstd_decode_ops(), 0);
+#endif
+	php_http_encoding_codec_register(ZEND_STRL("gzip"), &php_http_encoding_deflate_ops, PHP_HTTP_DEFLATE_TYPE_GZIP, &php_http_encoding_inflate_ops, 0);
+	php_http_encoding_codec_register(ZEND_STRL("x-gzip"), NULL, 0, &php_http_encoding_inflate_ops, 0);
+	php_http_encoding_codec_register(ZEND_STRL("deflate"), &php_http_encoding_deflate_ops, PHP_HTTP_DEFLATE_TYPE_ZLIB, &php_http_encoding_inflate_ops, 0);
+
+	return SUCCESS;
+}
+
+void php_http_encoding_pool_dtor(struct php_http_encoding_globals *G)
+{
+	while (G->deflate.count) {
+		php_http_zlib_free(G->deflate.idle[--G->deflate.count], 0);
+	}
+	while (G->inflate.count) {
+		php_http_zlib_free(G->inflate.idle[--G->inflate.count], 1);
+	}
+}
+
+PHP_MSHUTDOWN_FUNCTION(http_encoding)
+{
+	zend_hash_destroy(&php_http_encoding_codecs);
+	php_http_encoding_pool_dtor(&PHP_HTTP_G->encoding);
+
 	return SUCCESS;
 }
 
@@ -16,6 +16,7 @@
 #include <zlib.h>
 
 extern PHP_MINIT_FUNCTION(http_encoding);
+extern PHP_MSHUTDOWN_FUNCTION(http_encoding);
 extern PHP_RINIT_FUNCTION(http_encoding);
 extern PHP_RSHUTDOWN_FUNCTION(http_encoding);
 
@@ -42,6 +43,12 @@ extern PHP_RSHUTDOWN_FUNCTION(http_encoding);
 #define PHP_HTTP_DEFLATE_STRATEGY_HUFF		0x00000200
 #define PHP_HTTP_DEFLATE_STRATEGY_RLE		0x00000300
 #define PHP_HTTP_DEFLATE_STRATEGY_FIXED		0x00000400
+#define PHP_HTTP_DEFLATE_PARALLEL			0x00001000
+
+/* input compressed by each worker of a parallel deflate stream */
+#define PHP_HTTP_DEFLATE_PARALLEL_BLOCK		0x20000
+/* bodies of env responses deflated in parallel, if there are workers */
+#define PHP_HTTP_DEFLATE_PARALLEL_MIN		0x100000
 
 #define PHP_HTTP_DEFLATE_LEVEL_SET(flags, level) \
 	switch (flags & 0xf) \
@@ -121,6 +128,23 @@ extern PHP_RSHUTDOWN_FUNCTION(http_encoding);
 
 #define PHP_HTTP_ENCODING_STREAM_PERSISTENT	0x01000000
 
+/* idle zlib states kept for reuse across encoding streams and requests */
+#define PHP_HTTP_ENCODING_POOL_SIZE 4
+
+typedef struct php_http_encoding_pool {
+	z_streamp idle[PHP_HTTP_ENCODING_POOL_SIZE];
+	unsigned count;
+} php_http_encoding_pool_t;
+
+struct php_http_encoding_globals {
+	php_http_encoding_pool_t deflate;
+	php_http_encoding_pool_t inflate;
+	long deflate_threads;
+};
+
+/* frees the idle zlib states of one thread's globals */
+PHP_HTTP_API void php_http_encoding_pool_dtor(struct php_http_encoding_globals *G);
+
 typedef struct php_http_encoding_stream php_http_encoding_stream_t;
 
 typedef php_http_encoding_stream_t *(*php_http_encoding_stream_init_func_t)(php_http_encoding_stream_t *s);
@@ -130,6 +154,7 @@ typedef ZEND_RESULT_CODE (*php_http_encoding_stream_flush_func_t)(php_http_encod
 typedef zend_bool (*php_http_encoding_stream_done_func_t)(php_http_encoding_stream_t *s);
 typedef ZEND_RESULT_CODE (*php_http_encoding_stream_finish_func_t)(php_http_encoding_stream_t *s, char **out_str, size_t *out_len);
 typedef void (*php_http_encoding_stream_dtor_func_t)(php_http_encoding_stream_t *s);
+typedef ZEND_RESULT_CODE (*php_http_encoding_stream_update_buffer_func_t)(php_http_encoding_stream_t *s, const char *in_str, size_t in_len, php_http_buffer_t *out);
 
 typedef struct php_http_encoding_stream_ops {
 	php_http_encoding_stream_init_func_t init;
@@ -139,6 +164,7 @@ typedef struct php_http_encoding_stream_ops {
 	php_http_encoding_stream_done_func_t done;
 	php_http_encoding_stream_finish_func_t finish;
 	php_http_encoding_stream_dtor_func_t dtor;
+	php_http_encoding_stream_update_buffer_func_t update_buffer;
 } php_http_encoding_stream_ops_t;
 
 struct php_http_encoding_stream {
@@ -153,11 +179,36 @@ struct php_http_encoding_stream {
 PHP_HTTP_API php_http_encoding_stream_ops_t *php_http_encoding_stream_get_deflate_ops(void);
 PHP_HTTP_API php_http_encoding_stream_ops_t *php_http_encoding_stream_get_inflate_ops(void);
 PHP_HTTP_API php_http_encoding_stream_ops_t *php_http_encoding_stream_get_dechunk_ops(void);
+PHP_HTTP_API php_http_encoding_stream_ops_t *php_http_encoding_stream_get_parallel_deflate_ops(void);
+#if PHP_HTTP_HAVE_BROTLI
+PHP_HTTP_API php_http_encoding_stream_ops_t *php_http_encoding_stream_get_brotli_encode_ops(void);
+PHP_HTTP_API php_http_encoding_stream_ops_t *php_http_encoding_stream_get_brotli_decode_ops(void);
+#endif
+#if PHP_HTTP_HAVE_ZSTD
+PHP_HTTP_API php_http_encoding_stream_ops_t *php_http_encoding_stream_get_zstd_encode_ops(void);
+PHP_HTTP_API php_http_encoding_stream_ops_t *php_http_encoding_stream_get_zstd_decode_ops(void);
+#endif
+
+/* a content coding, like gzip, and the streams implementing it */
+typedef struct php_http_encoding_codec {
+	const char *name_str; /* lower case */
+	size_t name_len;
+	php_http_encoding_stream_ops_t *encoder; /* NULL if decoding only */
+	unsigned encoder_flags;
+	php_http_encoding_stream_ops_t *decoder; /* NULL if encoding only */
+	unsigned decoder_flags;
+} php_http_encoding_codec_t;
+
+PHP_HTTP_API ZEND_RESULT_CODE php_http_encoding_codec_add(php_http_encoding_codec_t *codec);
+PHP_HTTP_API ZEND_RESULT_CODE php_http_encoding_codec_get(const char *name_str, size_t name_len, php_http_encoding_codec_t *codec);
+PHP_HTTP_API ZEND_RESULT_CODE php_http_encoding_codec_match(const char *coding_str, php_http_encoding_codec_t *codec);
+PHP_HTTP_API void php_http_encoding_codec_list(HashTable *ht, zend_bool encoders TSRMLS_DC);
 
 PHP_HTTP_API php_http_encoding_stream_t *php_http_encoding_stream_init(php_http_encoding_stream_t *s, php_http_encoding_stream_ops_t *ops, unsigned flags TSRMLS_DC);
 PHP_HTTP_API php_http_encoding_stream_t *php_http_encoding_stream_copy(php_http_encoding_stream_t *from, php_http_encoding_stream_t *to);
 PHP_HTTP_API ZEND_RESULT_CODE php_http_encoding_stream_reset(php_http_encoding_stream_t **s);
 PHP_HTTP_API ZEND_RESULT_CODE php_http_encoding_stream_update(php_http_encoding_stream_t *s, const char *in_str, size_t in_len, char **out_str, size_t *out_len);
+PHP_HTTP_API ZEND_RESULT_CODE php_http_encoding_stream_update_buffer(php_http_encoding_stream_t *s, const char *in_str, size_t in_len, php_http_buffer_t *out);
 PHP_HTTP_API ZEND_RESULT_CODE php_http_encoding_stream_flush(php_http_encoding_stream_t *s, char **out_str, size_t *len);
 PHP_HTTP_API zend_bool php_http_encoding_stream_done(php_http_encoding_stream_t *s);
 PHP_HTTP_API ZEND_RESULT_CODE php_http_encoding_stream_finish(php_http_encoding_stream_t *s, char **out_str, size_t *len);
@@ -165,7 +216,19 @@ PHP_HTTP_API void php_http_encoding_stream_dtor(php_http_encoding_stream_t *s);
 PHP_HTTP_API void php_http_encoding_stream_free(php_http_encoding_stream_t **s);
 
 PHP_HTTP_API const char *php_http_encoding_dechunk(const char *encoded, size_t encoded_len, char **decoded, size_t *decoded_len TSRMLS_DC);
+
+/* incremental chunked decoding, which passes chunk data on straight from the input */
+typedef struct php_http_encoding_dechunker {
+	php_http_buffer_t line; /* a chunk size line split across inputs */
+	size_t hexlen; /* chunk data still to come */
+	unsigned zeroed:1;
+} php_http_encoding_dechunker_t;
+
+PHP_HTTP_API php_http_encoding_dechunker_t *php_http_encoding_dechunker_init(php_http_encoding_dechunker_t *d, zend_bool persistent);
+PHP_HTTP_API size_t php_http_encoding_dechunker_update(php_http_encoding_dechunker_t *d, const char *str, size_t len, php_http_pass_callback_t cb, void *cb_arg TSRMLS_DC);
+PHP_HTTP_API void php_http_encoding_dechunker_dtor(php_http_encoding_dechunker_t *d);
 PHP_HTTP_API ZEND_RESULT_CODE php_http_encoding_deflate(int flags, const char *data, size_t data_len, char **encoded, size_t *encoded_len TSRMLS_DC);
+PHP_HTTP_API ZEND_RESULT_CODE php_http_encoding_deflate_parallel(int flags, const char *data, size_t data_len, char **encoded, size_t *encoded_len TSRMLS_DC);
 PHP_HTTP_API ZEND_RESULT_CODE php_http_encoding_inflate(const char *data, size_t data_len, char **decoded, size_t *decoded_len TSRMLS_DC);
 
 typedef struct php_http_encoding_stream_object {
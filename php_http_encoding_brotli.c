@@ -0,0 +1,249 @@
+/*
+    +--------------------------------------------------------------------+
+    | PECL :: http                                                       |
+    +--------------------------------------------------------------------+
+    | Redistribution and use in source and binary forms, with or without |
+    | modification, are permitted provided that the conditions mentioned |
+    | in the accompanying LICENSE file are met.                          |
+    +--------------------------------------------------------------------+
+    | Copyright (c) 2004-2014, Michael Wallner <mike@php.net>            |
+    +--------------------------------------------------------------------+
+*/
+
+#include "php_http_api.h"
+
+#if PHP_HTTP_HAVE_BROTLI
+
+#include <brotli/encode.h>
+#include <brotli/decode.h>
+
+/* the library default of 11 is meant for static assets, not for on the fly compression */
+#define PHP_HTTP_BROTLI_QUALITY_DEF 4
+
+#define PHP_HTTP_BROTLI_OPERATION(f) \
+	(((f) & (PHP_HTTP_ENCODING_STREAM_FLUSH_SYNC|PHP_HTTP_ENCODING_STREAM_FLUSH_FULL)) ? BROTLI_OPERATION_FLUSH : BROTLI_OPERATION_PROCESS)
+
+static ZEND_RESULT_CODE brotli_encode_process(BrotliEncoderState *ctx, BrotliEncoderOperation op, const char *data, size_t data_len, php_http_buffer_t *encoded)
+{
+	const uint8_t *next_in = (const uint8_t *) data;
+	size_t avail_in = data_len;
+
+	do {
+		uint8_t *next_out;
+		size_t avail_out;
+
+		if (PHP_HTTP_BUFFER_NOMEM == php_http_buffer_resize(encoded, MAX(PHP_HTTP_DEFLATE_BUFFER_SIZE_GUESS(avail_in), PHP_HTTP_INFLATE_BUFFER_SIZE))) {
+			return FAILURE;
+		}
+		next_out = (uint8_t *) encoded->data + encoded->used;
+		avail_out = encoded->free;
+
+		if (!BrotliEncoderCompressStream(ctx, op, &avail_in, &next_in, &avail_out, &next_out, NULL)) {
+			return FAILURE;
+		}
+		php_http_buffer_account(encoded, encoded->free - avail_out);
+	} while (avail_in || BrotliEncoderHasMoreOutput(ctx) || (op == BROTLI_OPERATION_FINISH && !BrotliEncoderIsFinished(ctx)));
+
+	return SUCCESS;
+}
+
+static php_http_encoding_stream_t *brotli_encode_init(php_http_encoding_stream_t *s)
+{
+	int quality;
+	BrotliEncoderState *ctx;
+	TSRMLS_FETCH_FROM_CTX(s->ts);
+
+	if ((ctx = BrotliEncoderCreateInstance(NULL, NULL, NULL))) {
+		switch (s->flags & 0xf) {
+			case PHP_HTTP_DEFLATE_LEVEL_DEF:
+				quality = PHP_HTTP_BROTLI_QUALITY_DEF;
+				break;
+			default:
+				quality = s->flags & 0xf;
+				break;
+		}
+		if (BrotliEncoderSetParameter(ctx, BROTLI_PARAM_QUALITY, MIN(quality, BROTLI_MAX_QUALITY))) {
+			s->ctx = ctx;
+			return s;
+		}
+		BrotliEncoderDestroyInstance(ctx);
+	}
+	php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to initialize brotli encoding stream");
+	return NULL;
+}
+
+static ZEND_RESULT_CODE brotli_encode_update_buffer(php_http_encoding_stream_t *s, const char *data, size_t data_len, php_http_buffer_t *encoded)
+{
+	TSRMLS_FETCH_FROM_CTX(s->ts);
+
+	if (SUCCESS == brotli_encode_process(s->ctx, PHP_HTTP_BROTLI_OPERATION(s->flags), data, data_len, encoded)) {
+		return SUCCESS;
+	}
+	php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to update brotli encoding stream");
+	return FAILURE;
+}
+
+static ZEND_RESULT_CODE brotli_encode_flush(php_http_encoding_stream_t *s, char **encoded, size_t *encoded_len)
+{
+	php_http_buffer_t buf;
+	TSRMLS_FETCH_FROM_CTX(s->ts);
+
+	php_http_buffer_init(&buf);
+	if (SUCCESS == brotli_encode_process(s->ctx, BROTLI_OPERATION_FLUSH, NULL, 0, &buf)) {
+		php_http_buffer_fix(&buf);
+		*encoded = buf.data;
+		*encoded_len = buf.used;
+		return SUCCESS;
+	}
+	php_http_buffer_dtor(&buf);
+	*encoded = NULL;
+	*encoded_len = 0;
+	php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to flush brotli encoding stream");
+	return FAILURE;
+}
+
+static zend_bool brotli_encode_done(php_http_encoding_stream_t *s)
+{
+	return !BrotliEncoderHasMoreOutput(s->ctx);
+}
+
+static ZEND_RESULT_CODE brotli_encode_finish(php_http_encoding_stream_t *s, char **encoded, size_t *encoded_len)
+{
+	php_http_buffer_t buf;
+	TSRMLS_FETCH_FROM_CTX(s->ts);
+
+	php_http_buffer_init(&buf);
+	if (SUCCESS == brotli_encode_process(s->ctx, BROTLI_OPERATION_FINISH, NULL, 0, &buf)) {
+		php_http_buffer_fix(&buf);
+		*encoded = buf.data;
+		*encoded_len = buf.used;
+		return SUCCESS;
+	}
+	php_http_buffer_dtor(&buf);
+	*encoded = NULL;
+	*encoded_len = 0;
+	php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to finish brotli encoding stream");
+	return FAILURE;
+}
+
+static void brotli_encode_dtor(php_http_encoding_stream_t *s)
+{
+	if (s->ctx) {
+		BrotliEncoderDestroyInstance(s->ctx);
+		s->ctx = NULL;
+	}
+}
+
+static php_http_encoding_stream_t *brotli_decode_init(php_http_encoding_stream_t *s)
+{
+	BrotliDecoderState *ctx;
+	TSRMLS_FETCH_FROM_CTX(s->ts);
+
+	if ((ctx = BrotliDecoderCreateInstance(NULL, NULL, NULL))) {
+		s->ctx = ctx;
+		return s;
+	}
+	php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to initialize brotli decoding stream");
+	return NULL;
+}
+
+static ZEND_RESULT_CODE brotli_decode_update_buffer(php_http_encoding_stream_t *s, const char *data, size_t data_len, php_http_buffer_t *decoded)
+{
+	BrotliDecoderResult rc;
+	const uint8_t *next_in = (const uint8_t *) data;
+	size_t avail_in = data_len;
+	TSRMLS_FETCH_FROM_CTX(s->ts);
+
+	/* the decoder keeps incomplete input itself */
+	do {
+		uint8_t *next_out;
+		size_t avail_out;
+
+		if (PHP_HTTP_BUFFER_NOMEM == php_http_buffer_resize(decoded, MAX(PHP_HTTP_INFLATE_BUFFER_SIZE_GUESS(avail_in), PHP_HTTP_INFLATE_BUFFER_SIZE))) {
+			php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to update brotli decoding stream: out of memory");
+			return FAILURE;
+		}
+		next_out = (uint8_t *) decoded->data + decoded->used;
+		avail_out = decoded->free;
+
+		rc = BrotliDecoderDecompressStream(s->ctx, &avail_in, &next_in, &avail_out, &next_out, NULL);
+		php_http_buffer_account(decoded, decoded->free - avail_out);
+	} while (BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT == rc);
+
+	if (BROTLI_DECODER_RESULT_ERROR == rc) {
+		php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to update brotli decoding stream: %s", BrotliDecoderErrorString(BrotliDecoderGetErrorCode(s->ctx)));
+		return FAILURE;
+	}
+	return SUCCESS;
+}
+
+static zend_bool brotli_decode_done(php_http_encoding_stream_t *s)
+{
+	return BrotliDecoderIsFinished(s->ctx);
+}
+
+static ZEND_RESULT_CODE brotli_decode_finish(php_http_encoding_stream_t *s, char **decoded, size_t *decoded_len)
+{
+	TSRMLS_FETCH_FROM_CTX(s->ts);
+
+	/* everything decodable has already been passed on by update */
+	*decoded = NULL;
+	*decoded_len = 0;
+
+	if (BrotliDecoderIsFinished(s->ctx)) {
+		return SUCCESS;
+	}
+	php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to finish brotli decoding stream: unexpected end of data");
+	return FAILURE;
+}
+
+static void brotli_decode_dtor(php_http_encoding_stream_t *s)
+{
+	if (s->ctx) {
+		BrotliDecoderDestroyInstance(s->ctx);
+		s->ctx = NULL;
+	}
+}
+
+static php_http_encoding_stream_ops_t php_http_encoding_brotli_encode_ops = {
+	brotli_encode_init,
+	NULL,
+	NULL,
+	brotli_encode_flush,
+	brotli_encode_done,
+	brotli_encode_finish,
+	brotli_encode_dtor,
+	brotli_encode_update_buffer
+};
+
+php_http_encoding_stream_ops_t *php_http_encoding_stream_get_brotli_encode_ops(void)
+{
+	return &php_http_encoding_brotli_encode_ops;
+}
+
+static php_http_encoding_stream_ops_t php_http_encoding_brotli_decode_ops = {
+	brotli_decode_init,
+	NULL,
+	NULL,
+	NULL,
+	brotli_decode_done,
+	brotli_decode_finish,
+	brotli_decode_dtor,
+	brotli_decode_update_buffer
+};
+
+php_http_encoding_stream_ops_t *php_http_encoding_stream_get_brotli_decode_ops(void)
+{
+	return &php_http_encoding_brotli_decode_ops;
+}
+
+#endif /* PHP_HTTP_HAVE_BROTLI */
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noet sw=4 ts=4 fdm=marker
+ * vim<600: noet sw=4 ts=4
+ */
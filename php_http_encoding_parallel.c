@@ -0,0 +1,531 @@
+/*
+    +--------------------------------------------------------------------+
+    | PECL :: http                                                       |
+    +--------------------------------------------------------------------+
+    | Redistribution and use in source and binary forms, with or without |
+    | modification, are permitted provided that the conditions mentioned |
+    | in the accompanying LICENSE file are met.                          |
+    +--------------------------------------------------------------------+
+    | Copyright (c) 2004-2014, Michael Wallner <mike@php.net>            |
+    +--------------------------------------------------------------------+
+*/
+
+#include "php_http_api.h"
+
+#if PHP_HTTP_HAVE_PTHREAD
+#	include <pthread.h>
+#endif
+
+/*
+ * Parallel deflate, the way pigz does it: the input is cut into blocks,
+ * which are compressed independently into raw deflate data, each primed
+ * with the last window of input preceding it as dictionary. Every block
+ * but the last ends on a byte boundary with a sync flush, so the pieces
+ * simply concatenate into one deflate stream, which gets the usual gzip
+ * or zlib header and trailer wrapped around.
+ *
+ * The workers only use zlib and malloc, never the engine.
+ */
+
+#define PHP_HTTP_DEFLATE_PARALLEL_DICT		0x8000
+#define PHP_HTTP_DEFLATE_PARALLEL_THREADS	64
+
+#if PHP_HTTP_DEFLATE_PARALLEL_BLOCK < PHP_HTTP_DEFLATE_PARALLEL_DICT
+#	error "the parallel deflate block size must not be smaller than the deflate window"
+#endif
+
+/* crc32_combine() and adler32_combine() appeared in 1.2.2.1 */
+#define PHP_HTTP_DEFLATE_PARALLEL_COMBINE (ZLIB_VERNUM >= 0x1221)
+
+typedef struct php_http_pdeflate_job {
+	const Bytef *in;
+	uInt in_len;
+	const Bytef *dict;
+	uInt dict_len;
+	int level;
+	int strategy;
+	int type;
+	unsigned last:1;
+
+	Bytef *out;
+	uLong out_len;
+	uLong check;
+	int status;
+} php_http_pdeflate_job_t;
+
+typedef struct php_http_pdeflate {
+	int level;
+	int strategy;
+	int type;
+	unsigned threads;
+
+	uLong check;
+	uLong total;
+	php_http_buffer_t pending;
+
+	uInt dict_len;
+	Bytef dict[PHP_HTTP_DEFLATE_PARALLEL_DICT];
+
+	unsigned header:1;
+} php_http_pdeflate_t;
+
+static void php_http_pdeflate_job_run(php_http_pdeflate_job_t *job)
+{
+	z_stream Z;
+
+	memset(&Z, 0, sizeof(Z));
+	if (Z_OK != (job->status = deflateInit2(&Z, job->level, Z_DEFLATED, PHP_HTTP_WINDOW_BITS_RAW, MAX_MEM_LEVEL, job->strategy))) {
+		return;
+	}
+
+	if (!job->dict_len || Z_OK == (job->status = deflateSetDictionary(&Z, job->dict, job->dict_len))) {
+		/* room for the whole block, so that one call does it */
+		job->out_len = deflateBound(&Z, job->in_len) + 16;
+
+		if (!(job->out = malloc(job->out_len))) {
+			job->status = Z_MEM_ERROR;
+		} else {
+			Z.next_in = (Bytef *) job->in;
+			Z.avail_in = job->in_len;
+			Z.next_out = job->out;
+			Z.avail_out = job->out_len;
+
+			job->status = deflate(&Z, job->last ? Z_FINISH : Z_SYNC_FLUSH);
+
+			if (job->status == (job->last ? Z_STREAM_END : Z_OK) && !Z.avail_in) {
+				job->status = Z_OK;
+				job->out_len = Z.total_out;
+			} else if (job->status == Z_OK || job->status == Z_STREAM_END) {
+				job->status = Z_BUF_ERROR;
+			}
+		}
+	}
+	deflateEnd(&Z);
+
+#if PHP_HTTP_DEFLATE_PARALLEL_COMBINE
+	switch (job->type) {
+		case PHP_HTTP_DEFLATE_TYPE_GZIP:
+			job->check = crc32(0L, job->in, job->in_len);
+			break;
+		case PHP_HTTP_DEFLATE_TYPE_RAW:
+			break;
+		default:
+			job->check = adler32(1L, job->in, job->in_len);
+			break;
+	}
+#endif
+}
+
+#if PHP_HTTP_HAVE_PTHREAD
+typedef struct php_http_pdeflate_pool {
+	pthread_mutex_t lock;
+	php_http_pdeflate_job_t *jobs;
+	size_t count;
+	size_t next;
+} php_http_pdeflate_pool_t;
+
+static void *php_http_pdeflate_worker(void *arg)
+{
+	php_http_pdeflate_pool_t *pool = arg;
+
+	while (1) {
+		size_t i;
+
+		pthread_mutex_lock(&pool->lock);
+		i = pool->next++;
+		pthread_mutex_unlock(&pool->lock);
+
+		if (i >= pool->count) {
+			break;
+		}
+		php_http_pdeflate_job_run(&pool->jobs[i]);
+	}
+	return NULL;
+}
+#endif
+
+static void php_http_pdeflate_run(php_http_pdeflate_job_t *jobs, size_t count, unsigned threads)
+{
+#if PHP_HTTP_HAVE_PTHREAD
+	if (threads > 1 && count > 1) {
+		unsigned i, started = 0;
+		pthread_t tids[PHP_HTTP_DEFLATE_PARALLEL_THREADS];
+		php_http_pdeflate_pool_t pool;
+
+		pool.jobs = jobs;
+		pool.count = count;
+		pool.next = 0;
+		pthread_mutex_init(&pool.lock, NULL);
+
+		/* the calling thread is one of the workers */
+		for (i = 1; i < MIN(threads, count); ++i) {
+			if (0 == pthread_create(&tids[started], NULL, php_http_pdeflate_worker, &pool)) {
+				++started;
+			}
+		}
+		php_http_pdeflate_worker(&pool);
+		for (i = 0; i < started; ++i) {
+			pthread_join(tids[i], NULL);
+		}
+
+		pthread_mutex_destroy(&pool.lock);
+		return;
+	}
+#endif
+	while (count--) {
+		php_http_pdeflate_job_run(jobs++);
+	}
+}
+
+static void php_http_pdeflate_header(php_http_pdeflate_t *ctx, php_http_buffer_t *out)
+{
+	switch (ctx->type) {
+		case PHP_HTTP_DEFLATE_TYPE_GZIP: {
+			char hdr[10] = {0x1f, (char) 0x8b, Z_DEFLATED, 0, 0, 0, 0, 0, 0, 3};
+
+			if (ctx->level == 9) {
+				hdr[8] = 2;
+			} else if (ctx->level == 1) {
+				hdr[8] = 4;
+			}
+			php_http_buffer_append(out, hdr, sizeof(hdr));
+			break;
+		}
+		case PHP_HTTP_DEFLATE_TYPE_RAW:
+			break;
+		default: {
+			unsigned flg;
+			char hdr[2];
+
+			if (ctx->level == 1) {
+				flg = 0;
+			} else if (ctx->level > 1 && ctx->level < 6) {
+				flg = 1;
+			} else if (ctx->level > 6) {
+				flg = 3;
+			} else {
+				flg = 2;
+			}
+			flg <<= 6;
+			flg += 31 - ((0x78 << 8) + flg) % 31;
+
+			hdr[0] = 0x78;
+			hdr[1] = (char) flg;
+			php_http_buffer_append(out, hdr, sizeof(hdr));
+			break;
+		}
+	}
+}
+
+static void php_http_pdeflate_trailer(php_http_pdeflate_t *ctx, php_http_buffer_t *out)
+{
+	char trl[8];
+
+	switch (ctx->type) {
+		case PHP_HTTP_DEFLATE_TYPE_GZIP:
+			trl[0] = (char) (ctx->check & 0xff);
+			trl[1] = (char) ((ctx->check >> 8) & 0xff);
+			trl[2] = (char) ((ctx->check >> 16) & 0xff);
+			trl[3] = (char) ((ctx->check >> 24) & 0xff);
+			trl[4] = (char) (ctx->total & 0xff);
+			trl[5] = (char) ((ctx->total >> 8) & 0xff);
+			trl[6] = (char) ((ctx->total >> 16) & 0xff);
+			trl[7] = (char) ((ctx->total >> 24) & 0xff);
+			php_http_buffer_append(out, trl, 8);
+			break;
+		case PHP_HTTP_DEFLATE_TYPE_RAW:
+			break;
+		default:
+			trl[0] = (char) ((ctx->check >> 24) & 0xff);
+			trl[1] = (char) ((ctx->check >> 16) & 0xff);
+			trl[2] = (char) ((ctx->check >> 8) & 0xff);
+			trl[3] = (char) (ctx->check & 0xff);
+			php_http_buffer_append(out, trl, 4);
+			break;
+	}
+}
+
+/* compress the next len bytes of input, ending the stream if last is set */
+static ZEND_RESULT_CODE php_http_pdeflate_process(php_http_pdeflate_t *ctx, const char *data_str, size_t len, zend_bool last, php_http_buffer_t *out TSRMLS_DC)
+{
+	size_t i, count = (len + PHP_HTTP_DEFLATE_PARALLEL_BLOCK - 1) / PHP_HTTP_DEFLATE_PARALLEL_BLOCK;
+	int status = Z_OK;
+	const Bytef *data = (const Bytef *) data_str;
+	php_http_pdeflate_job_t *jobs;
+
+	if (!count) {
+		if (!last) {
+			return SUCCESS;
+		}
+		/* an empty final block */
+		count = 1;
+	}
+
+	jobs = ecalloc(count, sizeof(*jobs));
+	for (i = 0; i < count; ++i) {
+		php_http_pdeflate_job_t *job = &jobs[i];
+		size_t offset = i * PHP_HTTP_DEFLATE_PARALLEL_BLOCK;
+
+		job->in = data + offset;
+		job->in_len = MIN(PHP_HTTP_DEFLATE_PARALLEL_BLOCK, len - offset);
+		if (i) {
+			job->dict = job->in - PHP_HTTP_DEFLATE_PARALLEL_DICT;
+			job->dict_len = PHP_HTTP_DEFLATE_PARALLEL_DICT;
+		} else {
+			job->dict = ctx->dict;
+			job->dict_len = ctx->dict_len;
+		}
+		job->level = ctx->level;
+		job->strategy = ctx->strategy;
+		job->type = ctx->type;
+		job->last = last && i == count - 1;
+	}
+
+	php_http_pdeflate_run(jobs, count, ctx->threads);
+
+	if (!ctx->header) {
+		php_http_pdeflate_header(ctx, out);
+		ctx->header = 1;
+	}
+	for (i = 0; i < count; ++i) {
+		php_http_pdeflate_job_t *job = &jobs[i];
+
+		if (Z_OK == status && Z_OK != (status = job->status)) {
+			php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to deflate data block: %s", zError(status));
+		}
+		if (Z_OK == status) {
+			php_http_buffer_append(out, (char *) job->out, job->out_len);
+
+			switch (ctx->type) {
+				case PHP_HTTP_DEFLATE_TYPE_GZIP:
+#if PHP_HTTP_DEFLATE_PARALLEL_COMBINE
+					ctx->check = crc32_combine(ctx->check, job->check, job->in_len);
+#else
+					ctx->check = crc32(ctx->check, job->in, job->in_len);
+#endif
+					break;
+				case PHP_HTTP_DEFLATE_TYPE_RAW:
+					break;
+				default:
+#if PHP_HTTP_DEFLATE_PARALLEL_COMBINE
+					ctx->check = adler32_combine(ctx->check, job->check, job->in_len);
+#else
+					ctx->check = adler32(ctx->check, job->in, job->in_len);
+#endif
+					break;
+			}
+			ctx->total += job->in_len;
+		}
+		if (job->out) {
+			free(job->out);
+		}
+	}
+	efree(jobs);
+
+	if (Z_OK != status) {
+		return FAILURE;
+	}
+
+	/* remember the window for the next block */
+	if (len >= PHP_HTTP_DEFLATE_PARALLEL_DICT) {
+		memcpy(ctx->dict, data + len - PHP_HTTP_DEFLATE_PARALLEL_DICT, PHP_HTTP_DEFLATE_PARALLEL_DICT);
+		ctx->dict_len = PHP_HTTP_DEFLATE_PARALLEL_DICT;
+	} else if (len) {
+		uInt keep = MIN(ctx->dict_len, PHP_HTTP_DEFLATE_PARALLEL_DICT - len);
+
+		memmove(ctx->dict, ctx->dict + ctx->dict_len - keep, keep);
+		memcpy(ctx->dict + keep, data, len);
+		ctx->dict_len = keep + len;
+	}
+
+	if (last) {
+		php_http_pdeflate_trailer(ctx, out);
+	}
+	return SUCCESS;
+}
+
+static php_http_encoding_stream_t *pdeflate_init(php_http_encoding_stream_t *s)
+{
+	int p = (s->flags & PHP_HTTP_ENCODING_STREAM_PERSISTENT);
+	long threads;
+	php_http_pdeflate_t *ctx = pecalloc(1, sizeof(*ctx), p);
+	TSRMLS_FETCH_FROM_CTX(s->ts);
+
+	PHP_HTTP_DEFLATE_LEVEL_SET(s->flags, ctx->level);
+	PHP_HTTP_DEFLATE_STRATEGY_SET(s->flags, ctx->strategy);
+	switch ((ctx->type = s->flags & 0xf0)) {
+		case PHP_HTTP_DEFLATE_TYPE_GZIP:
+			ctx->check = crc32(0L, Z_NULL, 0);
+			break;
+		case PHP_HTTP_DEFLATE_TYPE_RAW:
+			break;
+		default:
+			ctx->type = PHP_HTTP_DEFLATE_TYPE_ZLIB;
+			ctx->check = adler32(0L, Z_NULL, 0);
+			break;
+	}
+
+	threads = PHP_HTTP_G->encoding.deflate_threads;
+	ctx->threads = MAX(1, MIN(threads, PHP_HTTP_DEFLATE_PARALLEL_THREADS));
+
+	php_http_buffer_init_ex(&ctx->pending, PHP_HTTP_DEFLATE_PARALLEL_BLOCK, p ? PHP_HTTP_BUFFER_INIT_PERSISTENT : 0);
+
+	s->ctx = ctx;
+	return s;
+}
+
+static php_http_encoding_stream_t *pdeflate_copy(php_http_encoding_stream_t *from, php_http_encoding_stream_t *to)
+{
+	int p = (from->flags & PHP_HTTP_ENCODING_STREAM_PERSISTENT);
+	php_http_pdeflate_t *from_ctx = from->ctx, *to_ctx = pemalloc(sizeof(*to_ctx), p);
+
+	memcpy(to_ctx, from_ctx, sizeof(*to_ctx));
+	php_http_buffer_init_ex(&to_ctx->pending, MAX(from_ctx->pending.used, PHP_HTTP_DEFLATE_PARALLEL_BLOCK), p ? PHP_HTTP_BUFFER_INIT_PERSISTENT : 0);
+	php_http_buffer_append(&to_ctx->pending, from_ctx->pending.data, from_ctx->pending.used);
+
+	to->ctx = to_ctx;
+	return to;
+}
+
+static ZEND_RESULT_CODE pdeflate_update_buffer(php_http_encoding_stream_t *s, const char *data, size_t data_len, php_http_buffer_t *encoded)
+{
+	php_http_pdeflate_t *ctx = s->ctx;
+	size_t batch = ctx->threads * PHP_HTTP_DEFLATE_PARALLEL_BLOCK;
+	TSRMLS_FETCH_FROM_CTX(s->ts);
+
+	php_http_buffer_append(&ctx->pending, data, data_len);
+
+	if (PHP_HTTP_ENCODING_STREAM_FLUSH_FLAG(s->flags) != Z_NO_FLUSH) {
+		if (SUCCESS != php_http_pdeflate_process(ctx, ctx->pending.data, ctx->pending.used, 0, encoded TSRMLS_CC)) {
+			return FAILURE;
+		}
+		php_http_buffer_reset(&ctx->pending);
+		if (s->flags & PHP_HTTP_ENCODING_STREAM_FLUSH_FULL) {
+			ctx->dict_len = 0;
+		}
+		return SUCCESS;
+	}
+
+	/* wait until there's a full block for each worker */
+	if (ctx->pending.used >= batch) {
+		size_t len = ctx->pending.used - ctx->pending.used % batch;
+
+		if (SUCCESS != php_http_pdeflate_process(ctx, ctx->pending.data, len, 0, encoded TSRMLS_CC)) {
+			return FAILURE;
+		}
+		php_http_buffer_cut(&ctx->pending, 0, len);
+	}
+	return SUCCESS;
+}
+
+static ZEND_RESULT_CODE pdeflate_flush(php_http_encoding_stream_t *s, char **encoded, size_t *encoded_len)
+{
+	php_http_buffer_t buf;
+	php_http_pdeflate_t *ctx = s->ctx;
+	TSRMLS_FETCH_FROM_CTX(s->ts);
+
+	php_http_buffer_init(&buf);
+	if (SUCCESS == php_http_pdeflate_process(ctx, ctx->pending.data, ctx->pending.used, 0, &buf TSRMLS_CC)) {
+		php_http_buffer_reset(&ctx->pending);
+		php_http_buffer_fix(&buf);
+		*encoded = buf.data;
+		*encoded_len = buf.used;
+		return SUCCESS;
+	}
+	php_http_buffer_dtor(&buf);
+	*encoded = NULL;
+	*encoded_len = 0;
+	return FAILURE;
+}
+
+static zend_bool pdeflate_done(php_http_encoding_stream_t *s)
+{
+	return !((php_http_pdeflate_t *) s->ctx)->pending.used;
+}
+
+static ZEND_RESULT_CODE pdeflate_finish(php_http_encoding_stream_t *s, char **encoded, size_t *encoded_len)
+{
+	php_http_buffer_t buf;
+	php_http_pdeflate_t *ctx = s->ctx;
+	TSRMLS_FETCH_FROM_CTX(s->ts);
+
+	php_http_buffer_init(&buf);
+	if (SUCCESS == php_http_pdeflate_process(ctx, ctx->pending.data, ctx->pending.used, 1, &buf TSRMLS_CC)) {
+		php_http_buffer_reset(&ctx->pending);
+		php_http_buffer_fix(&buf);
+		*encoded = buf.data;
+		*encoded_len = buf.used;
+
+		/* ready for another round */
+		ctx->header = 0;
+		ctx->total = 0;
+		ctx->dict_len = 0;
+		ctx->check = ctx->type == PHP_HTTP_DEFLATE_TYPE_GZIP ? crc32(0L, Z_NULL, 0) : adler32(0L, Z_NULL, 0);
+		return SUCCESS;
+	}
+	php_http_buffer_dtor(&buf);
+	*encoded = NULL;
+	*encoded_len = 0;
+	return FAILURE;
+}
+
+static void pdeflate_dtor(php_http_encoding_stream_t *s)
+{
+	if (s->ctx) {
+		php_http_pdeflate_t *ctx = s->ctx;
+
+		php_http_buffer_dtor(&ctx->pending);
+		pefree(ctx, (s->flags & PHP_HTTP_ENCODING_STREAM_PERSISTENT));
+		s->ctx = NULL;
+	}
+}
+
+static php_http_encoding_stream_ops_t php_http_encoding_parallel_deflate_ops = {
+	pdeflate_init,
+	pdeflate_copy,
+	NULL,
+	pdeflate_flush,
+	pdeflate_done,
+	pdeflate_finish,
+	pdeflate_dtor,
+	pdeflate_update_buffer
+};
+
+php_http_encoding_stream_ops_t *php_http_encoding_stream_get_parallel_deflate_ops(void)
+{
+	return &php_http_encoding_parallel_deflate_ops;
+}
+
+ZEND_RESULT_CODE php_http_encoding_deflate_parallel(int flags, const char *data, size_t data_len, char **encoded, size_t *encoded_len TSRMLS_DC)
+{
+	ZEND_RESULT_CODE rv = FAILURE;
+	php_http_buffer_t buf;
+	php_http_encoding_stream_t s;
+
+	*encoded = NULL;
+	*encoded_len = 0;
+
+	if (php_http_encoding_stream_init(&s, &php_http_encoding_parallel_deflate_ops, flags & ~PHP_HTTP_ENCODING_STREAM_PERSISTENT TSRMLS_CC)) {
+		php_http_buffer_init_ex(&buf, PHP_HTTP_DEFLATE_BUFFER_SIZE_GUESS(data_len), 0);
+
+		/* the input is all there, so it does not need to go through pending */
+		if (SUCCESS == (rv = php_http_pdeflate_process(s.ctx, data, data_len, 1, &buf TSRMLS_CC))) {
+			php_http_buffer_fix(&buf);
+			*encoded = buf.data;
+			*encoded_len = buf.used;
+		} else {
+			php_http_buffer_dtor(&buf);
+		}
+		php_http_encoding_stream_dtor(&s);
+	}
+	return rv;
+}
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noet sw=4 ts=4 fdm=marker
+ * vim<600: noet sw=4 ts=4
+ */
@@ -0,0 +1,266 @@
+/*
+    +--------------------------------------------------------------------+
+    | PECL :: http                                                       |
+    +--------------------------------------------------------------------+
+    | Redistribution and use in source and binary forms, with or without |
+    | modification, are permitted provided that the conditions mentioned |
+    | in the accompanying LICENSE file are met.                          |
+    +--------------------------------------------------------------------+
+    | Copyright (c) 2004-2014, Michael Wallner <mike@php.net>            |
+    +--------------------------------------------------------------------+
+*/
+
+#include "php_http_api.h"
+
+#if PHP_HTTP_HAVE_ZSTD
+
+#include <zstd.h>
+#include <zstd_errors.h>
+
+#define PHP_HTTP_ZSTD_DIRECTIVE(f) \
+	(((f) & (PHP_HTTP_ENCODING_STREAM_FLUSH_SYNC|PHP_HTTP_ENCODING_STREAM_FLUSH_FULL)) ? ZSTD_e_flush : ZSTD_e_continue)
+
+struct zstd_decode_ctx {
+	ZSTD_DCtx *dctx;
+	unsigned done:1; /* at the end of a frame */
+};
+
+static size_t zstd_encode_process(ZSTD_CCtx *ctx, ZSTD_EndDirective end, const char *data, size_t data_len, php_http_buffer_t *encoded)
+{
+	size_t rc;
+	ZSTD_inBuffer in;
+	ZSTD_outBuffer out;
+
+	in.src = data;
+	in.size = data_len;
+	in.pos = 0;
+
+	do {
+		if (PHP_HTTP_BUFFER_NOMEM == php_http_buffer_resize(encoded, ZSTD_CStreamOutSize())) {
+			/* an error code, as ZSTD_isError() understands it */
+			return (size_t) -ZSTD_error_memory_allocation;
+		}
+		out.dst = encoded->data + encoded->used;
+		out.size = encoded->free;
+		out.pos = 0;
+
+		rc = ZSTD_compressStream2(ctx, &out, &in, end);
+		php_http_buffer_account(encoded, out.pos);
+
+		if (ZSTD_isError(rc)) {
+			return rc;
+		}
+	/* rc tells how much is left to flush, which only matters when flushing */
+	} while (in.pos < in.size || (end != ZSTD_e_continue && rc));
+
+	return rc;
+}
+
+static php_http_encoding_stream_t *zstd_encode_init(php_http_encoding_stream_t *s)
+{
+	int level;
+	ZSTD_CCtx *ctx;
+	TSRMLS_FETCH_FROM_CTX(s->ts);
+
+	if ((ctx = ZSTD_createCCtx())) {
+		switch (s->flags & 0xf) {
+			case PHP_HTTP_DEFLATE_LEVEL_DEF:
+				level = ZSTD_CLEVEL_DEFAULT;
+				break;
+			default:
+				level = s->flags & 0xf;
+				break;
+		}
+		if (!ZSTD_isError(ZSTD_CCtx_setParameter(ctx, ZSTD_c_compressionLevel, level))) {
+			s->ctx = ctx;
+			return s;
+		}
+		ZSTD_freeCCtx(ctx);
+	}
+	php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to initialize zstd encoding stream");
+	return NULL;
+}
+
+static ZEND_RESULT_CODE zstd_encode_update_buffer(php_http_encoding_stream_t *s, const char *data, size_t data_len, php_http_buffer_t *encoded)
+{
+	size_t rc = zstd_encode_process(s->ctx, PHP_HTTP_ZSTD_DIRECTIVE(s->flags), data, data_len, encoded);
+	TSRMLS_FETCH_FROM_CTX(s->ts);
+
+	if (!ZSTD_isError(rc)) {
+		return SUCCESS;
+	}
+	php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to update zstd encoding stream: %s", ZSTD_getErrorName(rc));
+	return FAILURE;
+}
+
+static ZEND_RESULT_CODE zstd_encode_flush(php_http_encoding_stream_t *s, char **encoded, size_t *encoded_len)
+{
+	size_t rc;
+	php_http_buffer_t buf;
+	TSRMLS_FETCH_FROM_CTX(s->ts);
+
+	php_http_buffer_init(&buf);
+	if (!ZSTD_isError(rc = zstd_encode_process(s->ctx, ZSTD_e_flush, NULL, 0, &buf))) {
+		php_http_buffer_fix(&buf);
+		*encoded = buf.data;
+		*encoded_len = buf.used;
+		return SUCCESS;
+	}
+	php_http_buffer_dtor(&buf);
+	*encoded = NULL;
+	*encoded_len = 0;
+	php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to flush zstd encoding stream: %s", ZSTD_getErrorName(rc));
+	return FAILURE;
+}
+
+static ZEND_RESULT_CODE zstd_encode_finish(php_http_encoding_stream_t *s, char **encoded, size_t *encoded_len)
+{
+	size_t rc;
+	php_http_buffer_t buf;
+	TSRMLS_FETCH_FROM_CTX(s->ts);
+
+	php_http_buffer_init(&buf);
+	if (!ZSTD_isError(rc = zstd_encode_process(s->ctx, ZSTD_e_end, NULL, 0, &buf))) {
+		php_http_buffer_fix(&buf);
+		*encoded = buf.data;
+		*encoded_len = buf.used;
+		return SUCCESS;
+	}
+	php_http_buffer_dtor(&buf);
+	*encoded = NULL;
+	*encoded_len = 0;
+	php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to finish zstd encoding stream: %s", ZSTD_getErrorName(rc));
+	return FAILURE;
+}
+
+static void zstd_encode_dtor(php_http_encoding_stream_t *s)
+{
+	if (s->ctx) {
+		ZSTD_freeCCtx(s->ctx);
+		s->ctx = NULL;
+	}
+}
+
+static php_http_encoding_stream_t *zstd_decode_init(php_http_encoding_stream_t *s)
+{
+	int p = (s->flags & PHP_HTTP_ENCODING_STREAM_PERSISTENT);
+	struct zstd_decode_ctx *ctx = pecalloc(1, sizeof(*ctx), p);
+	TSRMLS_FETCH_FROM_CTX(s->ts);
+
+	if ((ctx->dctx = ZSTD_createDCtx())) {
+		s->ctx = ctx;
+		return s;
+	}
+	pefree(ctx, p);
+	php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to initialize zstd decoding stream");
+	return NULL;
+}
+
+static ZEND_RESULT_CODE zstd_decode_update_buffer(php_http_encoding_stream_t *s, const char *data, size_t data_len, php_http_buffer_t *decoded)
+{
+	size_t rc;
+	ZSTD_inBuffer in;
+	ZSTD_outBuffer out;
+	struct zstd_decode_ctx *ctx = s->ctx;
+	TSRMLS_FETCH_FROM_CTX(s->ts);
+
+	in.src = data;
+	in.size = data_len;
+	in.pos = 0;
+
+	/* the decoder keeps incomplete input itself */
+	do {
+		if (PHP_HTTP_BUFFER_NOMEM == php_http_buffer_resize(decoded, ZSTD_DStreamOutSize())) {
+			php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to update zstd decoding stream: out of memory");
+			return FAILURE;
+		}
+		out.dst = decoded->data + decoded->used;
+		out.size = decoded->free;
+		out.pos = 0;
+
+		rc = ZSTD_decompressStream(ctx->dctx, &out, &in);
+		php_http_buffer_account(decoded, out.pos);
+
+		if (ZSTD_isError(rc)) {
+			php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to update zstd decoding stream: %s", ZSTD_getErrorName(rc));
+			return FAILURE;
+		}
+		ctx->done = !rc;
+	} while (in.pos < in.size || out.pos == out.size);
+
+	return SUCCESS;
+}
+
+static zend_bool zstd_decode_done(php_http_encoding_stream_t *s)
+{
+	return ((struct zstd_decode_ctx *) s->ctx)->done;
+}
+
+static ZEND_RESULT_CODE zstd_decode_finish(php_http_encoding_stream_t *s, char **decoded, size_t *decoded_len)
+{
+	TSRMLS_FETCH_FROM_CTX(s->ts);
+
+	/* everything decodable has already been passed on by update */
+	*decoded = NULL;
+	*decoded_len = 0;
+
+	if (zstd_decode_done(s)) {
+		return SUCCESS;
+	}
+	php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to finish zstd decoding stream: unexpected end of data");
+	return FAILURE;
+}
+
+static void zstd_decode_dtor(php_http_encoding_stream_t *s)
+{
+	if (s->ctx) {
+		struct zstd_decode_ctx *ctx = s->ctx;
+
+		ZSTD_freeDCtx(ctx->dctx);
+		pefree(ctx, (s->flags & PHP_HTTP_ENCODING_STREAM_PERSISTENT));
+		s->ctx = NULL;
+	}
+}
+
+static php_http_encoding_stream_ops_t php_http_encoding_zstd_encode_ops = {
+	zstd_encode_init,
+	NULL,
+	NULL,
+	zstd_encode_flush,
+	NULL,
+	zstd_encode_finish,
+	zstd_encode_dtor,
+	zstd_encode_update_buffer
+};
+
+php_http_encoding_stream_ops_t *php_http_encoding_stream_get_zstd_encode_ops(void)
+{
+	return &php_http_encoding_zstd_encode_ops;
+}
+
+static php_http_encoding_stream_ops_t php_http_encoding_zstd_decode_ops = {
+	zstd_decode_init,
+	NULL,
+	NULL,
+	NULL,
+	zstd_decode_done,
+	zstd_decode_finish,
+	zstd_decode_dtor,
+	zstd_decode_update_buffer
+};
+
+php_http_encoding_stream_ops_t *php_http_encoding_stream_get_zstd_decode_ops(void)
+{
+	return &php_http_encoding_zstd_decode_ops;
+}
+
+#endif /* PHP_HTTP_HAVE_ZSTD */
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noet sw=4 ts=4 fdm=marker
+ * vim<600: noet sw=4 ts=4
+ */
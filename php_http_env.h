@@ -24,6 +24,12 @@ struct php_http_env_globals {
 		HashTable *headers;
 		php_http_message_body_t *body;
 	} request;
+
+	struct {
+		long size;
+		size_t used;
+		HashTable *entries;
+	} encoding_cache;
 };
 
 typedef enum php_http_content_encoding {
@@ -263,6 +263,119 @@ static size_t output(void *context, char *buf, size_t len TSRMLS_DC)
 	return len;
 }
 
+/*
+ * encoded bodies keyed by the digest and length of their source, kept across
+ * requests in http.encoding.cache_size bytes, evicting the oldest entries first
+ */
+typedef struct php_http_env_response_cache_entry {
+	size_t len;
+	char data[1];
+} php_http_env_response_cache_entry_t;
+
+static void php_http_env_response_cache_entry_dtor(void *ptr)
+{
+	pefree(*(php_http_env_response_cache_entry_t **) ptr, 1);
+}
+
+static php_http_env_response_cache_entry_t *php_http_env_response_cache_find(const char *key_str, size_t key_len TSRMLS_DC)
+{
+	php_http_env_response_cache_entry_t **entry;
+	HashTable *entries = PHP_HTTP_G->env.encoding_cache.entries;
+
+	if (entries && SUCCESS == zend_hash_find(entries, key_str, key_len + 1, (void *) &entry)) {
+		return *entry;
+	}
+	return NULL;
+}
+
+static void php_http_env_response_cache_store(const char *key_str, size_t key_len, const char *data_str, size_t data_len TSRMLS_DC)
+{
+	php_http_env_response_cache_entry_t *entry;
+	HashTable *entries = PHP_HTTP_G->env.encoding_cache.entries;
+	size_t *used = &PHP_HTTP_G->env.encoding_cache.used, size = PHP_HTTP_G->env.encoding_cache.size;
+
+	if (data_len > size) {
+		return;
+	}
+	if (!entries) {
+		entries = PHP_HTTP_G->env.encoding_cache.entries = pemalloc(sizeof(*entries), 1);
+		zend_hash_init(entries, 0, NULL, php_http_env_response_cache_entry_dtor, 1);
+	}
+
+	while (*used + data_len > size && zend_hash_num_elements(entries)) {
+		char *old_str;
+		uint old_len;
+		ulong h;
+		php_http_env_response_cache_entry_t **old;
+
+		zend_hash_internal_pointer_reset(entries);
+		zend_hash_get_current_data(entries, (void *) &old);
+		*used -= (*old)->len;
+		zend_hash_get_current_key_ex(entries, &old_str, &old_len, &h, 0, NULL);
+		zend_hash_del(entries, old_str, old_len);
+	}
+
+	entry = pemalloc(sizeof(*entry) + data_len, 1);
+	entry->len = data_len;
+	memcpy(entry->data, data_str, data_len);
+
+	if (SUCCESS == zend_hash_add(entries, key_str, key_len + 1, &entry, sizeof(entry), NULL)) {
+		*used += data_len;
+	} else {
+		pefree(entry, 1);
+	}
+}
+
+static void php_http_env_response_cache_lookup(php_http_env_response_t *r)
+{
+	char *digest;
+	php_http_etag_t *etag;
+	php_http_message_body_t *body;
+	php_http_env_response_cache_entry_t *entry;
+	TSRMLS_FETCH_FROM_CTX(r->ts);
+
+	/* a body too large to ever be stored is not worth hashing */
+	if (r->content.length > (size_t) PHP_HTTP_G->env.encoding_cache.size) {
+		return;
+	}
+
+	/* key on the very bytes to encode, not on what the application claims about them */
+	if (!(body = get_body(r->options TSRMLS_CC)) || !(etag = php_http_etag_init("sha1" TSRMLS_CC))) {
+		return;
+	}
+	php_http_message_body_to_callback(body, (php_http_pass_callback_t) php_http_etag_update, etag, 0, 0);
+	digest = php_http_etag_finish(etag);
+
+	r->content.cache.key_len = spprintf(&r->content.cache.key, 0, "%s;%zu;%s;%x", digest, php_http_message_body_size(body), r->content.encoding, r->content.encoder->flags);
+	efree(digest);
+
+	if ((entry = php_http_env_response_cache_find(r->content.cache.key, r->content.cache.key_len TSRMLS_CC))) {
+		if (SUCCESS == r->ops->set_header(r, "Content-Length: %zu", entry->len)) {
+			/* copy, because sending might reenter and evict the entry */
+			php_http_buffer_reset(&r->content.encoded);
+			php_http_buffer_append(&r->content.encoded, entry->data, entry->len);
+			php_http_encoding_stream_free(&r->content.encoder);
+		}
+		PTR_SET(r->content.cache.key, NULL);
+	} else {
+		r->content.cache.data = php_http_buffer_init(NULL);
+	}
+}
+
+static void php_http_env_response_cache_collect(php_http_env_response_t *r, const char *data_str, size_t data_len)
+{
+	TSRMLS_FETCH_FROM_CTX(r->ts);
+
+	if (r->content.cache.data) {
+		if (r->content.cache.data->used + data_len > (size_t) PHP_HTTP_G->env.encoding_cache.size) {
+			php_http_buffer_free(&r->content.cache.data);
+			PTR_SET(r->content.cache.key, NULL);
+		} else {
+			php_http_buffer_append(r->content.cache.data, data_str, data_len);
+		}
+	}
+}
+
 #define php_http_env_response_send_done(r) php_http_env_response_send_data((r), NULL, 0)
 static ZEND_RESULT_CODE php_http_env_response_send_data(php_http_env_response_t *r, const char *buf, size_t len)
 {
@@ -274,20 +387,34 @@ static ZEND_RESULT_CODE php_http_env_response_send_data(php_http_env_response_t
 		size_t enc_len = 0;
 
 		if (buf) {
-			if (SUCCESS != php_http_encoding_stream_update(r->content.encoder, buf, len, &enc_str, &enc_len)) {
+			/* encode into our scratch buffer, which is reused for every piece of the body */
+			php_http_buffer_reset(&r->content.encoded);
+			if (SUCCESS != php_http_encoding_stream_update_buffer(r->content.encoder, buf, len, &r->content.encoded)) {
 				return FAILURE;
 			}
+			if (!r->content.encoded.used) {
+				return SUCCESS;
+			}
+			php_http_env_response_cache_collect(r, r->content.encoded.data, r->content.encoded.used);
+			chunks_sent = php_http_buffer_chunked_output(&r->buffer, r->content.encoded.data, r->content.encoded.used, chunk, output, r TSRMLS_CC);
 		} else {
 			if (SUCCESS != php_http_encoding_stream_finish(r->content.encoder, &enc_str, &enc_len)) {
 				return FAILURE;
 			}
+			if (enc_str) {
+				php_http_env_response_cache_collect(r, enc_str, enc_len);
+			}
+			if (r->content.cache.data) {
+				php_http_env_response_cache_store(r->content.cache.key, r->content.cache.key_len, r->content.cache.data->data, r->content.cache.data->used TSRMLS_CC);
+				php_http_buffer_free(&r->content.cache.data);
+				PTR_SET(r->content.cache.key, NULL);
+			}
+			if (!enc_str) {
+				return SUCCESS;
+			}
+			chunks_sent = php_http_buffer_chunked_output(&r->buffer, enc_str, enc_len, 0, output, r TSRMLS_CC);
+			PTR_FREE(enc_str);
 		}
-
-		if (!enc_str) {
-			return SUCCESS;
-		}
-		chunks_sent = php_http_buffer_chunked_output(&r->buffer, enc_str, enc_len, buf ? chunk : 0, output, r TSRMLS_CC);
-		PTR_FREE(enc_str);
 	} else {
 		chunks_sent = php_http_buffer_chunked_output(&r->buffer, buf, len, buf ? chunk : 0, output, r TSRMLS_CC);
 	}
@@ -311,6 +438,7 @@ php_http_env_response_t *php_http_env_response_init(php_http_env_response_t *r,
 	}
 
 	r->buffer = php_http_buffer_init(NULL);
+	php_http_buffer_init(&r->content.encoded);
 
 	Z_ADDREF_P(options);
 	r->options = options;
@@ -341,6 +469,11 @@ void php_http_env_response_dtor(php_http_env_response_t *r)
 	if (r->content.encoder) {
 		php_http_encoding_stream_free(&r->content.encoder);
 	}
+	php_http_buffer_dtor(&r->content.encoded);
+	PTR_FREE(r->content.cache.key);
+	if (r->content.cache.data) {
+		php_http_buffer_free(&r->content.cache.data);
+	}
 }
 
 void php_http_env_response_free(php_http_env_response_t **r)
@@ -513,25 +646,27 @@ static ZEND_RESULT_CODE php_http_env_response_send_head(php_http_env_response_t
 					INIT_PZVAL(&zsupported);
 					array_init(&zsupported);
 					add_next_index_stringl(&zsupported, ZEND_STRL("none"), 1);
-					add_next_index_stringl(&zsupported, ZEND_STRL("gzip"), 1);
-					add_next_index_stringl(&zsupported, ZEND_STRL("deflate"), 1);
+					php_http_encoding_codec_list(Z_ARRVAL(zsupported), 1 TSRMLS_CC);
 
 					if ((result = php_http_negotiate_encoding(Z_ARRVAL(zsupported), request TSRMLS_CC))) {
 						char *key_str = NULL;
 						uint key_len = 0;
+						php_http_encoding_codec_t codec;
 
 						zend_hash_internal_pointer_reset(result);
 						if (HASH_KEY_IS_STRING == zend_hash_get_current_key_ex(result, &key_str, &key_len, NULL, 0, NULL)) {
-							if (!strcmp(key_str, "gzip")) {
-								if (!(r->content.encoder = php_http_encoding_stream_init(NULL, php_http_encoding_stream_get_deflate_ops(), PHP_HTTP_DEFLATE_TYPE_GZIP TSRMLS_CC))) {
-									ret = FAILURE;
-								} else if (SUCCESS == (ret = r->ops->set_header(r, "Content-Encoding: gzip"))) {
-									r->content.encoding = estrndup(key_str, key_len - 1);
+							if (SUCCESS == php_http_encoding_codec_get(key_str, key_len - 1, &codec) && codec.encoder) {
+								/* spread large bodies over the deflate workers */
+								if (codec.encoder == php_http_encoding_stream_get_deflate_ops()
+								&&	PHP_HTTP_G->encoding.deflate_threads > 1
+								&&	r->content.length >= PHP_HTTP_DEFLATE_PARALLEL_MIN
+								) {
+									codec.encoder = php_http_encoding_stream_get_parallel_deflate_ops();
+									codec.encoder_flags |= PHP_HTTP_DEFLATE_PARALLEL;
 								}
-							} else if (!strcmp(key_str, "deflate")) {
-								if (!(r->content.encoder = php_http_encoding_stream_init(NULL, php_http_encoding_stream_get_deflate_ops(), PHP_HTTP_DEFLATE_TYPE_ZLIB TSRMLS_CC))) {
+								if (!(r->content.encoder = php_http_encoding_stream_init(NULL, codec.encoder, codec.encoder_flags TSRMLS_CC))) {
 									ret = FAILURE;
-								} else if (SUCCESS == (ret = r->ops->set_header(r, "Content-Encoding: deflate"))) {
+								} else if (SUCCESS == (ret = r->ops->set_header(r, "Content-Encoding: %s", codec.name_str))) {
 									r->content.encoding = estrndup(key_str, key_len - 1);
 								}
 							} else {
@@ -606,6 +741,10 @@ static ZEND_RESULT_CODE php_http_env_response_send_head(php_http_env_response_t
 		}
 	}
 
+	if (SUCCESS == ret && !r->done && r->content.encoder && r->range.status != PHP_HTTP_RANGE_OK && PHP_HTTP_G->env.encoding_cache.size > 0) {
+		php_http_env_response_cache_lookup(r);
+	}
+
 	return ret;
 }
 
@@ -634,7 +773,13 @@ static ZEND_RESULT_CODE php_http_env_response_send_body(php_http_env_response_t
 			zval_ptr_dtor(&zoption);
 		}
 
-		if (r->range.status == PHP_HTTP_RANGE_OK) {
+		if (!r->content.encoder && r->content.encoded.used) {
+			/* pre-encoded body from the encoding cache */
+			ret = php_http_env_response_send_data(r, r->content.encoded.data, r->content.encoded.used);
+			if (ret == SUCCESS) {
+				ret = php_http_env_response_send_done(r);
+			}
+		} else if (r->range.status == PHP_HTTP_RANGE_OK) {
 			if (zend_hash_num_elements(&r->range.values) == 1) {
 				/* single range */
 				zval **range, **begin, **end;
@@ -1502,6 +1647,25 @@ PHP_MINIT_FUNCTION(http_env_response)
 	return SUCCESS;
 }
 
+void php_http_env_response_cache_dtor(struct php_http_env_globals *G)
+{
+	HashTable *entries = G->encoding_cache.entries;
+
+	if (entries) {
+		zend_hash_destroy(entries);
+		pefree(entries, 1);
+		G->encoding_cache.entries = NULL;
+		G->encoding_cache.used = 0;
+	}
+}
+
+PHP_MSHUTDOWN_FUNCTION(http_env_response)
+{
+	php_http_env_response_cache_dtor(&PHP_HTTP_G->env);
+
+	return SUCCESS;
+}
+
 
 /*
  * Local variables:
@@ -57,6 +57,13 @@ struct php_http_env_response {
 		char *encoding;
 
 		php_http_encoding_stream_t *encoder;
+		php_http_buffer_t encoded;
+
+		struct {
+			char *key;
+			size_t key_len;
+			php_http_buffer_t *data;
+		} cache;
 	} content;
 
 	zend_bool done;
@@ -74,8 +81,12 @@ PHP_HTTP_API void php_http_env_response_free(php_http_env_response_t **r);
 PHP_HTTP_API php_http_cache_status_t php_http_env_is_response_cached_by_etag(zval *options, const char *header_str, size_t header_len, php_http_message_t *request TSRMLS_DC);
 PHP_HTTP_API php_http_cache_status_t php_http_env_is_response_cached_by_last_modified(zval *options, const char *header_str, size_t header_len, php_http_message_t *request TSRMLS_DC);
 
+/* frees the encoding cache of one thread's globals */
+PHP_HTTP_API void php_http_env_response_cache_dtor(struct php_http_env_globals *G);
+
 PHP_HTTP_API zend_class_entry *php_http_env_response_class_entry;
 PHP_MINIT_FUNCTION(http_env_response);
+PHP_MSHUTDOWN_FUNCTION(http_env_response);
 
 #endif
 
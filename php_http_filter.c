@@ -70,150 +70,96 @@ PHP_MINIT_FUNCTION(http_filter)
 		php_stream_bucket_append(buckets_out, __buck TSRMLS_CC); \
 	}
 
-typedef struct _http_chunked_decode_filter_buffer_t {
-	php_http_buffer_t	buffer;
-	ulong	hexlen;
-} PHP_HTTP_FILTER_BUFFER(chunked_decode);
+typedef php_http_encoding_dechunker_t PHP_HTTP_FILTER_BUFFER(chunked_decode);
 
 typedef php_http_encoding_stream_t PHP_HTTP_FILTER_BUFFER(zlib);
 
+struct chunked_decode_pass_arg {
+	php_stream *stream;
+	php_stream_filter *filter;
+	php_stream_bucket *bucket;
+	php_stream_bucket_brigade *buckets_out;
+	int out_avail;
+#ifdef ZTS
+	void ***ts;
+#endif
+};
+
+static size_t chunked_decode_pass(void *opaque, const char *str, size_t len)
+{
+	struct chunked_decode_pass_arg *arg = opaque;
+	php_stream_bucket *buck;
+	TSRMLS_FETCH_FROM_CTX(arg->ts);
+
+	if (arg->bucket && str == arg->bucket->buf && len == arg->bucket->buflen) {
+		/* the bucket carries chunk data only, pass it on as is */
+		buck = arg->bucket;
+		arg->bucket = NULL;
+	} else {
+		char *data = pemalloc(len, arg->filter->is_persistent);
+
+		memcpy(data, str, len);
+		if (!(buck = php_stream_bucket_new(arg->stream, data, len, 1, arg->filter->is_persistent TSRMLS_CC))) {
+			pefree(data, arg->filter->is_persistent);
+			return -1;
+		}
+	}
+
+	php_stream_bucket_append(arg->buckets_out, buck TSRMLS_CC);
+	arg->out_avail = 1;
+	return len;
+}
+
 static PHP_HTTP_FILTER_FUNCTION(chunked_decode)
 {
-	int out_avail = 0;
 	php_stream_bucket *ptr, *nxt;
 	PHP_HTTP_FILTER_BUFFER(chunked_decode) *buffer = (PHP_HTTP_FILTER_BUFFER(chunked_decode) *) (this->abstract);
-	
+	struct chunked_decode_pass_arg arg;
+
+	arg.stream = stream;
+	arg.filter = this;
+	arg.bucket = NULL;
+	arg.buckets_out = buckets_out;
+	arg.out_avail = 0;
+	TSRMLS_SET_CTX(arg.ts);
+
 	if (bytes_consumed) {
 		*bytes_consumed = 0;
 	}
-	
-	/* fetch available bucket data */
+
+	/* decode each bucket in place, only a split chunk size line is buffered */
 	for (ptr = buckets_in->head; ptr; ptr = nxt) {
+		zend_bool zeroed = buffer->zeroed;
+		size_t consumed;
+
+		nxt = ptr->next;
 		if (bytes_consumed) {
 			*bytes_consumed += ptr->buflen;
 		}
 
-		if (PHP_HTTP_BUFFER_NOMEM == php_http_buffer_append(PHP_HTTP_BUFFER(buffer), ptr->buf, ptr->buflen)) {
-			return PSFS_ERR_FATAL;
-		}
-
-		nxt = ptr->next;
 		php_stream_bucket_unlink(ptr TSRMLS_CC);
-		php_stream_bucket_delref(ptr TSRMLS_CC);
-	}
-	
-	if (!php_http_buffer_fix(PHP_HTTP_BUFFER(buffer))) {
-		return PSFS_ERR_FATAL;
-	}
+		arg.bucket = ptr;
+		consumed = php_http_encoding_dechunker_update(buffer, ptr->buf, ptr->buflen, chunked_decode_pass, &arg TSRMLS_CC);
+		if (arg.bucket) {
+			php_stream_bucket_delref(arg.bucket TSRMLS_CC);
+		}
 
-	/* we have data in our buffer */
-	while (PHP_HTTP_BUFFER(buffer)->used) {
-	
-		/* we already know the size of the chunk and are waiting for data */
-		if (buffer->hexlen) {
-		
-			/* not enough data buffered */
-			if (PHP_HTTP_BUFFER(buffer)->used < buffer->hexlen) {
-			
-				/* flush anyway? */
-				if (flags & PSFS_FLAG_FLUSH_INC) {
-				
-					/* flush all data (should only be chunk data) */
-					out_avail = 1;
-					NEW_BUCKET(PHP_HTTP_BUFFER(buffer)->data, PHP_HTTP_BUFFER(buffer)->used);
-					
-					/* waiting for less data now */
-					buffer->hexlen -= PHP_HTTP_BUFFER(buffer)->used;
-					/* no more buffered data */
-					php_http_buffer_reset(PHP_HTTP_BUFFER(buffer));
-					/* break */
-				} 
-				
-				/* we have too less data and don't need to flush */
-				else {
-					break;
-				}
-			} 
-			
-			/* we seem to have all data of the chunk */
-			else {
-				out_avail = 1;
-				NEW_BUCKET(PHP_HTTP_BUFFER(buffer)->data, buffer->hexlen);
-				
-				/* remove outgoing data from the buffer */
-				php_http_buffer_cut(PHP_HTTP_BUFFER(buffer), 0, buffer->hexlen);
-				/* reset hexlen */
-				buffer->hexlen = 0;
-				/* continue */
-			}
-		} 
-		
-		/* we don't know the length of the chunk yet */
-		else {
-			size_t off = 0;
-			
-			/* ignore preceeding CRLFs (too loose?) */
-			while (off < PHP_HTTP_BUFFER(buffer)->used && (
-					PHP_HTTP_BUFFER(buffer)->data[off] == '\n' || 
-					PHP_HTTP_BUFFER(buffer)->data[off] == '\r')) {
-				++off;
-			}
-			if (off) {
-				php_http_buffer_cut(PHP_HTTP_BUFFER(buffer), 0, off);
-			}
-			
-			/* still data there? */
-			if (PHP_HTTP_BUFFER(buffer)->used) {
-				int eollen;
-				const char *eolstr;
-				
-				/* we need eol, so we can be sure we have all hex digits */
-				php_http_buffer_fix(PHP_HTTP_BUFFER(buffer));
-				if ((eolstr = php_http_locate_bin_eol(PHP_HTTP_BUFFER(buffer)->data, PHP_HTTP_BUFFER(buffer)->used, &eollen))) {
-					char *stop = NULL;
-					
-					/* read in chunk size */
-					buffer->hexlen = strtoul(PHP_HTTP_BUFFER(buffer)->data, &stop, 16);
-					
-					/*	if strtoul() stops at the beginning of the buffered data
-						there's something oddly wrong, i.e. bad input */
-					if (stop == PHP_HTTP_BUFFER(buffer)->data) {
-						return PSFS_ERR_FATAL;
-					}
-					
-					/* cut out <chunk size hex><chunk extension><eol> */
-					php_http_buffer_cut(PHP_HTTP_BUFFER(buffer), 0, eolstr + eollen - PHP_HTTP_BUFFER(buffer)->data);
-					/* buffer->hexlen is 0 now or contains the size of the next chunk */
-					if (!buffer->hexlen) {
-						php_stream_notify_info(stream->context, PHP_STREAM_NOTIFY_COMPLETED, NULL, 0);
-						break;
-					}
-					/* continue */
-				} else {
-					/* we have not enough data buffered to read in chunk size */
-					break;
-				}
-			}
-			/* break */
+		if (consumed == (size_t) -1) {
+			return PSFS_ERR_FATAL;
+		}
+		if (buffer->zeroed && !zeroed) {
+			php_stream_notify_info(stream->context, PHP_STREAM_NOTIFY_COMPLETED, NULL, 0);
 		}
 	}
-	
-	/* flush before close, but only if we are already waiting for more data */
-	if (PHP_HTTP_FILTER_IS_CLOSING(stream, flags) && buffer->hexlen && PHP_HTTP_BUFFER(buffer)->used) {
-		out_avail = 1;
-		NEW_BUCKET(PHP_HTTP_BUFFER(buffer)->data, PHP_HTTP_BUFFER(buffer)->used);
-		php_http_buffer_reset(PHP_HTTP_BUFFER(buffer));
-		buffer->hexlen = 0;
-	}
-	
-	return out_avail ? PSFS_PASS_ON : PSFS_FEED_ME;
+
+	return arg.out_avail ? PSFS_PASS_ON : PSFS_FEED_ME;
 }
 
 static PHP_HTTP_FILTER_DESTRUCTOR(chunked_decode)
 {
 	PHP_HTTP_FILTER_BUFFER(chunked_decode) *b = (PHP_HTTP_FILTER_BUFFER(chunked_decode) *) (this->abstract);
 	
-	php_http_buffer_dtor(PHP_HTTP_BUFFER(b));
+	php_http_encoding_dechunker_dtor(b);
 	pefree(b, this->is_persistent);
 }
 
@@ -403,9 +349,9 @@ static php_stream_filter *http_filter_create(const char *name, zval *params, int
 	if (!strcasecmp(name, "http.chunked_decode")) {
 		PHP_HTTP_FILTER_BUFFER(chunked_decode) *b = NULL;
 		
-		if ((b = pecalloc(1, sizeof(PHP_HTTP_FILTER_BUFFER(chunked_decode)), p))) {
-			php_http_buffer_init_ex(PHP_HTTP_BUFFER(b), 4096, p ? PHP_HTTP_BUFFER_INIT_PERSISTENT : 0);
+		if ((b = php_http_encoding_dechunker_init(NULL, p))) {
 			if (!(f = php_stream_filter_alloc(&PHP_HTTP_FILTER_OP(chunked_decode), b, p))) {
+				php_http_encoding_dechunker_dtor(b);
 				pefree(b, p);
 			}
 		}
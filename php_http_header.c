@@ -109,6 +109,207 @@ zval *php_http_header_value_to_string(zval *header TSRMLS_DC)
 	return ret;
 }
 
+/* well-known header names, resolved without allocating or prettifying a key */
+static const char *php_http_header_name_list[] = {
+	"Accept",
+	"Accept-Charset",
+	"Accept-Encoding",
+	"Accept-Language",
+	"Accept-Ranges",
+	"Access-Control-Allow-Credentials",
+	"Access-Control-Allow-Headers",
+	"Access-Control-Allow-Methods",
+	"Access-Control-Allow-Origin",
+	"Access-Control-Expose-Headers",
+	"Access-Control-Max-Age",
+	"Access-Control-Request-Headers",
+	"Access-Control-Request-Method",
+	"Age",
+	"Allow",
+	"Alt-Svc",
+	"Authorization",
+	"Cache-Control",
+	"Connection",
+	"Content-Disposition",
+	"Content-Encoding",
+	"Content-Language",
+	"Content-Length",
+	"Content-Location",
+	"Content-Md5",
+	"Content-Range",
+	"Content-Security-Policy",
+	"Content-Type",
+	"Cookie",
+	"Date",
+	"Dnt",
+	"Etag",
+	"Expect",
+	"Expires",
+	"Forwarded",
+	"From",
+	"Host",
+	"If-Match",
+	"If-Modified-Since",
+	"If-None-Match",
+	"If-Range",
+	"If-Unmodified-Since",
+	"Keep-Alive",
+	"Last-Modified",
+	"Link",
+	"Location",
+	"Max-Forwards",
+	"Origin",
+	"P3p",
+	"Pragma",
+	"Proxy-Authenticate",
+	"Proxy-Authorization",
+	"Proxy-Connection",
+	"Range",
+	"Referer",
+	"Refresh",
+	"Retry-After",
+	"Server",
+	"Set-Cookie",
+	"Status",
+	"Strict-Transport-Security",
+	"Te",
+	"Trailer",
+	"Transfer-Encoding",
+	"Upgrade",
+	"Upgrade-Insecure-Requests",
+	"User-Agent",
+	"Vary",
+	"Via",
+	"Warning",
+	"Www-Authenticate",
+	"X-Content-Type-Options",
+	"X-Forwarded-For",
+	"X-Forwarded-Host",
+	"X-Forwarded-Proto",
+	"X-Frame-Options",
+	"X-Original-Content-Encoding",
+	"X-Original-Content-Length",
+	"X-Original-Transfer-Encoding",
+	"X-Powered-By",
+	"X-Requested-With",
+	"X-Xss-Protection",
+	NULL
+};
+
+#define PHP_HTTP_HEADER_NAME_COUNT (sizeof(php_http_header_name_list)/sizeof(char *) - 1)
+#define PHP_HTTP_HEADER_NAME_SLOTS 1024
+#define PHP_HTTP_HEADER_NAME_NORM(c) (((c) >= 'A' && (c) <= 'Z') ? ((c) | 0x20) : ((c) == '_' ? '-' : (c)))
+
+static php_http_header_name_t php_http_header_names[PHP_HTTP_HEADER_NAME_COUNT];
+/* slot -> index + 1 into php_http_header_names, 0 if empty */
+static unsigned char php_http_header_name_slots[PHP_HTTP_HEADER_NAME_SLOTS];
+static unsigned php_http_header_name_seed;
+static size_t php_http_header_name_maxlen;
+
+static inline unsigned php_http_header_name_slot(const char *str, size_t len, unsigned seed)
+{
+	unsigned h = 2166136261U ^ seed;
+	size_t i;
+
+	/* case insensitive, and '_' equals '-', like php_http_pretty_key() would see it */
+	for (i = 0; i < len; ++i) {
+		h = (h ^ (unsigned char) PHP_HTTP_HEADER_NAME_NORM(str[i])) * 16777619U;
+	}
+	return (h ^ (h >> 16)) & (PHP_HTTP_HEADER_NAME_SLOTS - 1);
+}
+
+static zend_bool php_http_header_name_build(unsigned seed)
+{
+	size_t i;
+
+	memset(php_http_header_name_slots, 0, sizeof(php_http_header_name_slots));
+	for (i = 0; i < PHP_HTTP_HEADER_NAME_COUNT; ++i) {
+		unsigned slot = php_http_header_name_slot(php_http_header_names[i].str, php_http_header_names[i].len, seed);
+
+		if (php_http_header_name_slots[slot]) {
+			return 0;
+		}
+		php_http_header_name_slots[slot] = i + 1;
+	}
+	return 1;
+}
+
+const php_http_header_name_t *php_http_header_name_find(const char *str, size_t len)
+{
+	const php_http_header_name_t *name;
+	unsigned char idx;
+	size_t i;
+
+	if (!len || len > php_http_header_name_maxlen) {
+		return NULL;
+	}
+	if (!(idx = php_http_header_name_slots[php_http_header_name_slot(str, len, php_http_header_name_seed)])) {
+		return NULL;
+	}
+
+	name = &php_http_header_names[idx - 1];
+	if (name->len != len) {
+		return NULL;
+	}
+	for (i = 0; i < len; ++i) {
+		if (PHP_HTTP_HEADER_NAME_NORM(str[i]) != PHP_HTTP_HEADER_NAME_NORM(name->str[i])) {
+			return NULL;
+		}
+	}
+	return name;
+}
+
+static void php_http_header_name_init(TSRMLS_D)
+{
+	size_t i;
+	unsigned seed;
+
+	for (i = 0; i < PHP_HTTP_HEADER_NAME_COUNT; ++i) {
+		php_http_header_name_t *name = &php_http_header_names[i];
+		char *str;
+
+		name->len = strlen(php_http_header_name_list[i]);
+		str = php_http_pretty_key(pestrndup(php_http_header_name_list[i], name->len, 1), name->len, 1, 1);
+#if PHP_VERSION_ID >= 50400
+		name->str = zend_new_interned_string(str, name->len + 1, 0 TSRMLS_CC);
+		if (name->str != str) {
+			pefree(str, 1);
+		}
+#else
+		name->str = str;
+#endif
+		name->h = zend_inline_hash_func(name->str, name->len + 1);
+
+		if (name->len > php_http_header_name_maxlen) {
+			php_http_header_name_maxlen = name->len;
+		}
+	}
+
+	/* find a seed which maps every name to its own slot */
+	for (seed = 0; seed < 0x10000; ++seed) {
+		if (php_http_header_name_build(seed)) {
+			php_http_header_name_seed = seed;
+			return;
+		}
+	}
+	/* no luck; lookups will simply miss */
+	memset(php_http_header_name_slots, 0, sizeof(php_http_header_name_slots));
+}
+
+static void php_http_header_name_shutdown(void)
+{
+	size_t i;
+
+	memset(php_http_header_name_slots, 0, sizeof(php_http_header_name_slots));
+	for (i = 0; i < PHP_HTTP_HEADER_NAME_COUNT; ++i) {
+#if PHP_VERSION_ID >= 50400
+		if (!IS_INTERNED(php_http_header_names[i].str))
+#endif
+		pefree((char *) php_http_header_names[i].str, 1);
+		php_http_header_names[i].str = NULL;
+	}
+}
+
 ZEND_BEGIN_ARG_INFO_EX(ai_HttpHeader___construct, 0, 0, 0)
 	ZEND_ARG_INFO(0, name)
 	ZEND_ARG_INFO(0, value)
@@ -369,6 +570,15 @@ PHP_MINIT_FUNCTION(http_header)
 	zend_declare_property_null(php_http_header_class_entry, ZEND_STRL("name"), ZEND_ACC_PUBLIC TSRMLS_CC);
 	zend_declare_property_null(php_http_header_class_entry, ZEND_STRL("value"), ZEND_ACC_PUBLIC TSRMLS_CC);
 
+	php_http_header_name_init(TSRMLS_C);
+
+	return SUCCESS;
+}
+
+PHP_MSHUTDOWN_FUNCTION(http_header)
+{
+	php_http_header_name_shutdown();
+
 	return SUCCESS;
 }
 
@@ -22,8 +22,18 @@ PHP_HTTP_API void php_http_header_to_string(php_http_buffer_t *str, HashTable *h
 
 PHP_HTTP_API zval *php_http_header_value_to_string(zval *header TSRMLS_DC);
 
+typedef struct php_http_header_name {
+	const char *str;
+	size_t len;
+	ulong h;
+} php_http_header_name_t;
+
+/* pretty, possibly interned name and its hash, if str is a well-known header name */
+PHP_HTTP_API const php_http_header_name_t *php_http_header_name_find(const char *str, size_t len);
+
 PHP_HTTP_API zend_class_entry *php_http_header_class_entry;
 PHP_MINIT_FUNCTION(http_header);
+PHP_MSHUTDOWN_FUNCTION(http_header);
 
 #endif
 
@@ -37,6 +37,13 @@ php_http_header_parser_t *php_http_header_parser_init(php_http_header_parser_t *
 	}
 	memset(parser, 0, sizeof(*parser));
 
+	if (PHP_HTTP_G->parser.header_bytes > 0) {
+		parser->limit.bytes = PHP_HTTP_G->parser.header_bytes;
+	}
+	if (PHP_HTTP_G->parser.header_count > 0) {
+		parser->limit.count = PHP_HTTP_G->parser.header_count;
+	}
+
 	TSRMLS_SET_CTX(parser->ts);
 
 	return parser;
@@ -115,72 +122,98 @@ static void php_http_header_parser_error(size_t valid_len, char *str, size_t len
 	efree(escaped_str);
 }
 
-php_http_header_parser_state_t php_http_header_parser_parse(php_http_header_parser_t *parser, php_http_buffer_t *buffer, unsigned flags, HashTable *headers, php_http_info_callback_t callback_func, void *callback_arg)
+/* data not yet consumed, the buffer is only compacted once parsing stops */
+#define PHP_HTTP_HEADER_PARSER_DATA (buffer->data + *off)
+#define PHP_HTTP_HEADER_PARSER_USED (buffer->used - *off)
+/* whether the header block would exceed the byte limit with len more bytes */
+#define PHP_HTTP_HEADER_PARSER_EXCEEDS(len) (parser->limit.bytes && parser->_seen.bytes + *off + (len) > parser->limit.bytes)
+
+static php_http_header_parser_state_t php_http_header_parser_exceeded(php_http_header_parser_t *parser, const char *what, size_t limit TSRMLS_DC)
+{
+	php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to parse headers: exceeded the limit of %zu %s", limit, what);
+	return php_http_header_parser_state_push(parser, 1, PHP_HTTP_HEADER_PARSER_STATE_FAILURE);
+}
+
+static php_http_header_parser_state_t php_http_header_parser_parse_ex(php_http_header_parser_t *parser, php_http_buffer_t *buffer, size_t *off, unsigned flags, HashTable *headers, php_http_info_callback_t callback_func, void *callback_arg)
 {
 	TSRMLS_FETCH_FROM_CTX(parser->ts);
 
-	while (buffer->used || !php_http_header_parser_states[php_http_header_parser_state_is(parser)].need_data) {
+	while (PHP_HTTP_HEADER_PARSER_USED || !php_http_header_parser_states[php_http_header_parser_state_is(parser)].need_data) {
 #if DBG_PARSER
 		const char *state[] = {"START", "KEY", "VALUE", "VALUE_EX", "HEADER_DONE", "DONE"};
-		fprintf(stderr, "#HP: %s (avail:%zu, num:%d cleanup:%u)\n", php_http_header_parser_state_is(parser) < 0 ? "FAILURE" : state[php_http_header_parser_state_is(parser)], buffer->used, headers?zend_hash_num_elements(headers):0, flags);
-		_dpf(0, buffer->data, buffer->used);
+		fprintf(stderr, "#HP: %s (avail:%zu, num:%d cleanup:%u)\n", php_http_header_parser_state_is(parser) < 0 ? "FAILURE" : state[php_http_header_parser_state_is(parser)], PHP_HTTP_HEADER_PARSER_USED, headers?zend_hash_num_elements(headers):0, flags);
+		_dpf(0, PHP_HTTP_HEADER_PARSER_DATA, PHP_HTTP_HEADER_PARSER_USED);
 #endif
+		if (PHP_HTTP_HEADER_PARSER_EXCEEDS(0)) {
+			return php_http_header_parser_exceeded(parser, "bytes", parser->limit.bytes TSRMLS_CC);
+		}
+
 		switch (php_http_header_parser_state_pop(parser)) {
 			case PHP_HTTP_HEADER_PARSER_STATE_FAILURE:
 				php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to parse headers");
 				return php_http_header_parser_state_push(parser, 1, PHP_HTTP_HEADER_PARSER_STATE_FAILURE);
 
 			case PHP_HTTP_HEADER_PARSER_STATE_START: {
-				char *ptr = buffer->data;
+				const char *ptr = PHP_HTTP_HEADER_PARSER_DATA, *end = ptr + PHP_HTTP_HEADER_PARSER_USED;
 
-				while (ptr - buffer->data < buffer->used && PHP_HTTP_IS_CTYPE(space, *ptr)) {
+				while (ptr < end && PHP_HTTP_IS_CTYPE(space, *ptr)) {
 					++ptr;
 				}
 
-				php_http_buffer_cut(buffer, 0, ptr - buffer->data);
+				*off += ptr - PHP_HTTP_HEADER_PARSER_DATA;
 				php_http_header_parser_state_push(parser, 1, PHP_HTTP_HEADER_PARSER_STATE_KEY);
 				break;
 			}
 
 			case PHP_HTTP_HEADER_PARSER_STATE_KEY: {
-				const char *colon, *eol_str = NULL;
+				const char *data, *colon, *eol_str = NULL;
+				size_t used;
 				int eol_len = 0;
 
 				/* fix buffer here, so eol_str pointer doesn't become obsolete afterwards */
 				php_http_buffer_fix(buffer);
+				data = PHP_HTTP_HEADER_PARSER_DATA;
+				used = PHP_HTTP_HEADER_PARSER_USED;
 
-				if (buffer->data == (eol_str = php_http_locate_bin_eol(buffer->data, buffer->used, &eol_len))) {
+				if (data == (eol_str = php_http_locate_bin_eol(data, used, &eol_len))) {
 					/* end of headers */
-					php_http_buffer_cut(buffer, 0, eol_len);
+					*off += eol_len;
 					php_http_header_parser_state_push(parser, 1, PHP_HTTP_HEADER_PARSER_STATE_DONE);
-				} else if (php_http_info_parse(&parser->info, buffer->data TSRMLS_CC)) {
+				} else if (php_http_info_parse(&parser->info, data TSRMLS_CC)) {
 					/* new message starting with request/response line */
 					if (callback_func) {
 						callback_func(callback_arg, &headers, &parser->info TSRMLS_CC);
 					}
 					php_http_info_dtor(&parser->info);
-					php_http_buffer_cut(buffer, 0, eol_str + eol_len - buffer->data);
+					*off += eol_str + eol_len - data;
 					php_http_header_parser_state_push(parser, 1, PHP_HTTP_HEADER_PARSER_STATE_HEADER_DONE);
-				} else if ((colon = memchr(buffer->data, ':', buffer->used)) && (!eol_str || eol_str > colon)) {
+				} else if ((colon = memchr(data, ':', eol_str ? eol_str - data : used))) {
 					/* header: string */
-					size_t valid_len;
+					size_t key_len = colon - data, valid_len;
 
-					parser->_key.len = colon - buffer->data;
-					parser->_key.str = estrndup(buffer->data, parser->_key.len);
+					valid_len = php_http_scan_token(data, key_len);
+					if (valid_len != key_len) {
+						char *key_str = estrndup(data, key_len);
 
-					valid_len = strspn(parser->_key.str, PHP_HTTP_HEADER_NAME_CHARS);
-					if (valid_len != parser->_key.len) {
-						php_http_header_parser_error(valid_len, parser->_key.str, parser->_key.len, eol_str TSRMLS_CC);
-						PTR_SET(parser->_key.str, NULL);
+						php_http_header_parser_error(valid_len, key_str, key_len, eol_str TSRMLS_CC);
+						efree(key_str);
 						return php_http_header_parser_state_push(parser, 1, PHP_HTTP_HEADER_PARSER_STATE_FAILURE);
 					}
+					/* well-known names need neither a copy nor prettifying */
+					if (!(parser->_name = php_http_header_name_find(data, key_len))) {
+						parser->_key.len = key_len;
+						parser->_key.str = estrndup(data, key_len);
+					}
 					while (PHP_HTTP_IS_CTYPE(space, *++colon) && *colon != '\n' && *colon != '\r');
-					php_http_buffer_cut(buffer, 0, colon - buffer->data);
+					*off += colon - data;
 					php_http_header_parser_state_push(parser, 1, PHP_HTTP_HEADER_PARSER_STATE_VALUE);
 				} else if (eol_str || (flags & PHP_HTTP_HEADER_PARSER_CLEANUP)) {
 					/* neither reqeust/response line nor 'header:' string, or injected new line or NUL etc. */
-					php_http_header_parser_error(strspn(buffer->data, PHP_HTTP_HEADER_NAME_CHARS), buffer->data, buffer->used, eol_str TSRMLS_CC);
+					php_http_header_parser_error(php_http_scan_token(data, used), (char *) data, used, eol_str TSRMLS_CC);
 					return php_http_header_parser_state_push(parser, 1, PHP_HTTP_HEADER_PARSER_STATE_FAILURE);
+				} else if (PHP_HTTP_HEADER_PARSER_EXCEEDS(used)) {
+					/* reject an endless line early */
+					return php_http_header_parser_exceeded(parser, "bytes", parser->limit.bytes TSRMLS_CC);
 				} else {
 					/* keep feeding */
 					return php_http_header_parser_state_push(parser, 1, PHP_HTTP_HEADER_PARSER_STATE_KEY);
@@ -194,7 +227,7 @@ php_http_header_parser_state_t php_http_header_parser_parse(php_http_header_pars
 
 #define SET_ADD_VAL(slen, eol_len) \
 	do { \
-		const char *ptr = buffer->data; \
+		const char *ptr = PHP_HTTP_HEADER_PARSER_DATA; \
 		size_t len = slen; \
 		 \
 		while (len > 0 && PHP_HTTP_IS_CTYPE(space, *ptr)) { \
@@ -217,17 +250,19 @@ php_http_header_parser_state_t php_http_header_parser_parse(php_http_header_pars
 				parser->_val.str = estrndup(ptr, len); \
 			} \
 		} \
-		php_http_buffer_cut(buffer, 0, slen + eol_len); \
+		*off += slen + eol_len; \
 	} while (0)
 
-				if ((eol_str = php_http_locate_bin_eol(buffer->data, buffer->used, &eol_len))) {
-					SET_ADD_VAL(eol_str - buffer->data, eol_len);
+				if ((eol_str = php_http_locate_bin_eol(PHP_HTTP_HEADER_PARSER_DATA, PHP_HTTP_HEADER_PARSER_USED, &eol_len))) {
+					SET_ADD_VAL(eol_str - PHP_HTTP_HEADER_PARSER_DATA, eol_len);
 					php_http_header_parser_state_push(parser, 1, PHP_HTTP_HEADER_PARSER_STATE_VALUE_EX);
 				} else if (flags & PHP_HTTP_HEADER_PARSER_CLEANUP) {
-					if (buffer->used) {
-						SET_ADD_VAL(buffer->used, 0);
+					if (PHP_HTTP_HEADER_PARSER_USED) {
+						SET_ADD_VAL(PHP_HTTP_HEADER_PARSER_USED, 0);
 					}
 					php_http_header_parser_state_push(parser, 1, PHP_HTTP_HEADER_PARSER_STATE_HEADER_DONE);
+				} else if (PHP_HTTP_HEADER_PARSER_EXCEEDS(PHP_HTTP_HEADER_PARSER_USED)) {
+					return php_http_header_parser_exceeded(parser, "bytes", parser->limit.bytes TSRMLS_CC);
 				} else {
 					return php_http_header_parser_state_push(parser, 1, PHP_HTTP_HEADER_PARSER_STATE_VALUE);
 				}
@@ -235,9 +270,9 @@ php_http_header_parser_state_t php_http_header_parser_parse(php_http_header_pars
 			}
 
 			case PHP_HTTP_HEADER_PARSER_STATE_VALUE_EX:
-				if (buffer->used && (*buffer->data == ' ' || *buffer->data == '\t')) {
+				if (PHP_HTTP_HEADER_PARSER_USED && (*PHP_HTTP_HEADER_PARSER_DATA == ' ' || *PHP_HTTP_HEADER_PARSER_DATA == '\t')) {
 					php_http_header_parser_state_push(parser, 1, PHP_HTTP_HEADER_PARSER_STATE_VALUE);
-				} else if (buffer->used || (flags & PHP_HTTP_HEADER_PARSER_CLEANUP)) {
+				} else if (PHP_HTTP_HEADER_PARSER_USED || (flags & PHP_HTTP_HEADER_PARSER_CLEANUP)) {
 					php_http_header_parser_state_push(parser, 1, PHP_HTTP_HEADER_PARSER_STATE_HEADER_DONE);
 				} else {
 					/* keep feeding */
@@ -246,7 +281,7 @@ php_http_header_parser_state_t php_http_header_parser_parse(php_http_header_pars
 				break;
 
 			case PHP_HTTP_HEADER_PARSER_STATE_HEADER_DONE:
-				if (parser->_key.str && parser->_val.str) {
+				if ((parser->_name || parser->_key.str) && parser->_val.str) {
 					zval array, **exist;
 					size_t valid_len = strlen(parser->_val.str);
 
@@ -254,27 +289,52 @@ php_http_header_parser_state_t php_http_header_parser_parse(php_http_header_pars
 					if (valid_len != parser->_val.len) {
 						php_http_header_parser_error(valid_len, parser->_val.str, parser->_val.len, NULL TSRMLS_CC);
 
+						parser->_name = NULL;
 						PTR_SET(parser->_key.str, NULL);
 						PTR_SET(parser->_val.str, NULL);
 
 						return php_http_header_parser_state_push(parser, 1, PHP_HTTP_HEADER_PARSER_STATE_FAILURE);
 					}
 
+					if (parser->limit.count && ++parser->_seen.count > parser->limit.count) {
+						parser->_name = NULL;
+						PTR_SET(parser->_key.str, NULL);
+						PTR_SET(parser->_val.str, NULL);
+
+						return php_http_header_parser_exceeded(parser, "headers", parser->limit.count TSRMLS_CC);
+					}
+
 					if (!headers && callback_func) {
 						callback_func(callback_arg, &headers, NULL TSRMLS_CC);
 					}
 
-					INIT_PZVAL_ARRAY(&array, headers);
-					php_http_pretty_key(parser->_key.str, parser->_key.len, 1, 1);
-					if (SUCCESS == zend_symtable_find(headers, parser->_key.str, parser->_key.len + 1, (void *) &exist)) {
-						convert_to_array(*exist);
-						add_next_index_stringl(*exist, parser->_val.str, parser->_val.len, 0);
+					if (parser->_name) {
+						const php_http_header_name_t *name = parser->_name;
+
+						if (SUCCESS == zend_hash_quick_find(headers, name->str, name->len + 1, name->h, (void *) &exist)) {
+							convert_to_array(*exist);
+							add_next_index_stringl(*exist, parser->_val.str, parser->_val.len, 0);
+						} else {
+							zval *val;
+
+							MAKE_STD_ZVAL(val);
+							ZVAL_STRINGL(val, parser->_val.str, parser->_val.len, 0);
+							zend_hash_quick_update(headers, name->str, name->len + 1, name->h, (void *) &val, sizeof(zval *), NULL);
+						}
 					} else {
-						add_assoc_stringl_ex(&array, parser->_key.str, parser->_key.len + 1, parser->_val.str, parser->_val.len, 0);
+						INIT_PZVAL_ARRAY(&array, headers);
+						php_http_pretty_key(parser->_key.str, parser->_key.len, 1, 1);
+						if (SUCCESS == zend_symtable_find(headers, parser->_key.str, parser->_key.len + 1, (void *) &exist)) {
+							convert_to_array(*exist);
+							add_next_index_stringl(*exist, parser->_val.str, parser->_val.len, 0);
+						} else {
+							add_assoc_stringl_ex(&array, parser->_key.str, parser->_key.len + 1, parser->_val.str, parser->_val.len, 0);
+						}
 					}
 					parser->_val.str = NULL;
 				}
 
+				parser->_name = NULL;
 				PTR_SET(parser->_key.str, NULL);
 				PTR_SET(parser->_val.str, NULL);
 
@@ -282,6 +342,9 @@ php_http_header_parser_state_t php_http_header_parser_parse(php_http_header_pars
 				break;
 
 			case PHP_HTTP_HEADER_PARSER_STATE_DONE:
+				/* the limits apply per header block */
+				parser->_seen.bytes = 0;
+				parser->_seen.count = 0;
 				return PHP_HTTP_HEADER_PARSER_STATE_DONE;
 		}
 	}
@@ -289,6 +352,22 @@ php_http_header_parser_state_t php_http_header_parser_parse(php_http_header_pars
 	return php_http_header_parser_state_is(parser);
 }
 
+php_http_header_parser_state_t php_http_header_parser_parse(php_http_header_parser_t *parser, php_http_buffer_t *buffer, unsigned flags, HashTable *headers, php_http_info_callback_t callback_func, void *callback_arg)
+{
+	size_t off = 0;
+	php_http_header_parser_state_t state = php_http_header_parser_parse_ex(parser, buffer, &off, flags, headers, callback_func, callback_arg);
+
+	/* compact once, instead of after every line */
+	if (off) {
+		php_http_buffer_cut(buffer, 0, off);
+
+		if (state != PHP_HTTP_HEADER_PARSER_STATE_DONE) {
+			parser->_seen.bytes += off;
+		}
+	}
+	return state;
+}
+
 php_http_header_parser_state_t php_http_header_parser_parse_stream(php_http_header_parser_t *parser, php_http_buffer_t *buf, php_stream *s, unsigned flags, HashTable *headers, php_http_info_callback_t callback_func, void *callback_arg)
 {
 	php_http_header_parser_state_t state = PHP_HTTP_HEADER_PARSER_STATE_START;
@@ -34,10 +34,20 @@ typedef struct php_http_header_parser {
 		char *str;
 		size_t len;
 	} _key;
+	const struct php_http_header_name *_name;
 	struct {
 		char *str;
 		size_t len;
 	} _val;
+	/* 0 means unlimited; initialized from http.parser.header_* */
+	struct {
+		size_t bytes;
+		unsigned count;
+	} limit;
+	struct {
+		size_t bytes;
+		unsigned count;
+	} _seen;
 #ifdef ZTS
 	void ***ts;
 #endif
@@ -162,15 +162,22 @@ php_http_message_t *php_http_message_parse(php_http_message_t *msg, const char *
 zval *php_http_message_header(php_http_message_t *msg, const char *key_str, size_t key_len, int join)
 {
 	zval *ret = NULL, **header;
-	char *key;
+	const php_http_header_name_t *name;
+	char *key = NULL;
+	ZEND_RESULT_CODE rv;
 	ALLOCA_FLAG(free_key);
 
-	key = do_alloca(key_len + 1, free_key);
-	memcpy(key, key_str, key_len);
-	key[key_len] = '\0';
-	php_http_pretty_key(key, key_len, 1, 1);
+	if ((name = php_http_header_name_find(key_str, key_len))) {
+		rv = zend_hash_quick_find(&msg->hdrs, name->str, name->len + 1, name->h, (void *) &header);
+	} else {
+		key = do_alloca(key_len + 1, free_key);
+		memcpy(key, key_str, key_len);
+		key[key_len] = '\0';
+		php_http_pretty_key(key, key_len, 1, 1);
+		rv = zend_symtable_find(&msg->hdrs, key, key_len + 1, (void *) &header);
+	}
 
-	if (SUCCESS == zend_symtable_find(&msg->hdrs, key, key_len + 1, (void *) &header)) {
+	if (SUCCESS == rv) {
 		if (join && Z_TYPE_PP(header) == IS_ARRAY) {
 			TSRMLS_FETCH_FROM_CTX(msg->ts);
 
@@ -181,67 +188,226 @@ zval *php_http_message_header(php_http_message_t *msg, const char *key_str, size
 		}
 	}
 
-	free_alloca(key, free_key);
+	if (key) {
+		free_alloca(key, free_key);
+	}
 
 	return ret;
 }
 
-zend_bool php_http_message_is_multipart(php_http_message_t *msg, char **boundary)
+static void php_http_message_header_cache_dtor(php_http_message_header_cache_t *cache)
 {
-	zval *ct = php_http_message_header(msg, ZEND_STRL("Content-Type"), 1);
-	zend_bool is_multipart = 0;
+	PTR_FREE(cache->raw_str);
+	PTR_FREE(cache->boundary);
+	memset(cache, 0, sizeof(*cache));
+}
+
+/* resolved lazily, a failed lookup falls back to a plain symtable find */
+static struct {
+	const php_http_header_name_t *length;
+	const php_http_header_name_t *type;
+	const php_http_header_name_t *transfer_encoding;
+	const php_http_header_name_t *content_encoding;
+} php_http_message_header_names;
+
+typedef void (*php_http_message_header_derive_t)(php_http_message_header_cache_t *cache TSRMLS_DC);
+
+static php_http_message_header_cache_t *php_http_message_header_cached(php_http_message_t *msg, php_http_message_header_cache_t *cache, const php_http_header_name_t **name, const char *name_str, size_t name_len, php_http_message_header_derive_t derive)
+{
+	zval **header, *value = NULL;
+	const char *str;
+	size_t len;
+	char num[MAX_LENGTH_OF_LONG + 1];
+	ZEND_RESULT_CODE rv;
 	TSRMLS_FETCH_FROM_CTX(msg->ts);
 
-	if (ct) {
-		php_http_params_opts_t popts;
-		HashTable params;
-
-		ZEND_INIT_SYMTABLE(&params);
-		php_http_params_opts_default_get(&popts);
-		popts.input.str = Z_STRVAL_P(ct);
-		popts.input.len = Z_STRLEN_P(ct);
-
-		if (php_http_params_parse(&params, &popts TSRMLS_CC)) {
-			zval **cur, **arg;
-			char *ct_str;
-
-			zend_hash_internal_pointer_reset(&params);
-
-			if (SUCCESS == zend_hash_get_current_data(&params, (void *) &cur)
-			&&	Z_TYPE_PP(cur) == IS_ARRAY
-			&&	HASH_KEY_IS_STRING == zend_hash_get_current_key(&params, &ct_str, NULL, 0)
-			) {
-				if (php_http_match(ct_str, "multipart", PHP_HTTP_MATCH_WORD)) {
-					is_multipart = 1;
-
-					/* get boundary */
-					if (boundary
-					&&	SUCCESS == zend_hash_find(Z_ARRVAL_PP(cur), ZEND_STRS("arguments"), (void *) &arg)
-					&&	Z_TYPE_PP(arg) == IS_ARRAY
-					) {
-						zval **val;
-						HashPosition pos;
-						php_http_array_hashkey_t key = php_http_array_hashkey_init(0);
-
-						FOREACH_KEYVAL(pos, *arg, key, val) {
-							if (key.type == HASH_KEY_IS_STRING && !strcasecmp(key.str, "boundary")) {
-								zval *bnd = php_http_ztyp(IS_STRING, *val);
-
-								if (Z_STRLEN_P(bnd)) {
-									*boundary = estrndup(Z_STRVAL_P(bnd), Z_STRLEN_P(bnd));
-								}
-								zval_ptr_dtor(&bnd);
+	if (!*name) {
+		*name = php_http_header_name_find(name_str, name_len);
+	}
+	if (*name) {
+		rv = zend_hash_quick_find(&msg->hdrs, (*name)->str, (*name)->len + 1, (*name)->h, (void *) &header);
+	} else {
+		rv = zend_symtable_find(&msg->hdrs, name_str, name_len + 1, (void *) &header);
+	}
+	if (SUCCESS != rv) {
+		php_http_message_header_cache_dtor(cache);
+		return NULL;
+	}
+
+	switch (Z_TYPE_PP(header)) {
+		case IS_STRING:
+			str = Z_STRVAL_PP(header);
+			len = Z_STRLEN_PP(header);
+			break;
+		case IS_LONG:
+		{
+			unsigned long u = Z_LVAL_PP(header) < 0 ? -(unsigned long) Z_LVAL_PP(header) : (unsigned long) Z_LVAL_PP(header);
+			char *ptr = &num[sizeof(num)];
+
+			do {
+				*--ptr = '0' + (u % 10);
+			} while (u /= 10);
+			if (Z_LVAL_PP(header) < 0) {
+				*--ptr = '-';
+			}
+			str = ptr;
+			len = &num[sizeof(num)] - ptr;
+			break;
+		}
+		default:
+			value = php_http_header_value_to_string(*header TSRMLS_CC);
+			str = Z_STRVAL_P(value);
+			len = Z_STRLEN_P(value);
+			break;
+	}
+
+	/* derive the typed value only if the raw value changed */
+	if (!cache->valid || cache->raw_len != len || memcmp(cache->raw_str, str, len)) {
+		php_http_message_header_cache_dtor(cache);
+		cache->raw_str = estrndup(str, len);
+		cache->raw_len = len;
+		derive(cache TSRMLS_CC);
+		cache->valid = 1;
+	}
+
+	if (value) {
+		zval_ptr_dtor(&value);
+	}
+	return cache;
+}
+
+static void php_http_message_derive_length(php_http_message_header_cache_t *cache TSRMLS_DC)
+{
+	char *stop;
+
+	cache->num = strtol(cache->raw_str, &stop, 10);
+	if (stop == cache->raw_str) {
+		/* not a number at all */
+		cache->num = -1;
+	}
+}
+
+static void php_http_message_derive_encoding(php_http_message_header_cache_t *cache TSRMLS_DC)
+{
+	const char *ptr = cache->raw_str, *end = ptr + cache->raw_len;
+
+	cache->num = 0;
+	while (ptr < end) {
+		const char *tok;
+		size_t len;
+
+		while (ptr < end && (*ptr == ',' || PHP_HTTP_IS_CTYPE(space, *ptr))) {
+			++ptr;
+		}
+		tok = ptr;
+		while (ptr < end && *ptr != ',' && *ptr != ';' && !PHP_HTTP_IS_CTYPE(space, *ptr)) {
+			++ptr;
+		}
+		if (!(len = ptr - tok)) {
+			break;
+		}
+
+		if (len == lenof("chunked") && !strncasecmp(tok, "chunked", len)) {
+			cache->num |= PHP_HTTP_MESSAGE_ENCODING_CHUNKED;
+		} else if ((len == lenof("gzip") && !strncasecmp(tok, "gzip", len)) || (len == lenof("x-gzip") && !strncasecmp(tok, "x-gzip", len))) {
+			cache->num |= PHP_HTTP_MESSAGE_ENCODING_GZIP;
+		} else if (len == lenof("deflate") && !strncasecmp(tok, "deflate", len)) {
+			cache->num |= PHP_HTTP_MESSAGE_ENCODING_DEFLATE;
+		} else if (len != lenof("identity") || strncasecmp(tok, "identity", len)) {
+			cache->num |= PHP_HTTP_MESSAGE_ENCODING_OTHER;
+		}
+
+		/* skip parameters */
+		while (ptr < end && *ptr != ',') {
+			++ptr;
+		}
+	}
+}
+
+static void php_http_message_derive_type(php_http_message_header_cache_t *cache TSRMLS_DC)
+{
+	php_http_params_opts_t popts;
+	HashTable params;
+
+	ZEND_INIT_SYMTABLE(&params);
+	php_http_params_opts_default_get(&popts);
+	popts.input.str = cache->raw_str;
+	popts.input.len = cache->raw_len;
+
+	if (php_http_params_parse(&params, &popts TSRMLS_CC)) {
+		zval **cur, **arg;
+		char *ct_str;
+
+		zend_hash_internal_pointer_reset(&params);
+
+		if (SUCCESS == zend_hash_get_current_data(&params, (void *) &cur)
+		&&	Z_TYPE_PP(cur) == IS_ARRAY
+		&&	HASH_KEY_IS_STRING == zend_hash_get_current_key(&params, &ct_str, NULL, 0)
+		) {
+			if (php_http_match(ct_str, "multipart", PHP_HTTP_MATCH_WORD)) {
+				cache->multipart = 1;
+
+				/* get boundary */
+				if (SUCCESS == zend_hash_find(Z_ARRVAL_PP(cur), ZEND_STRS("arguments"), (void *) &arg)
+				&&	Z_TYPE_PP(arg) == IS_ARRAY
+				) {
+					zval **val;
+					HashPosition pos;
+					php_http_array_hashkey_t key = php_http_array_hashkey_init(0);
+
+					FOREACH_KEYVAL(pos, *arg, key, val) {
+						if (key.type == HASH_KEY_IS_STRING && !strcasecmp(key.str, "boundary")) {
+							zval *bnd = php_http_ztyp(IS_STRING, *val);
+
+							if (Z_STRLEN_P(bnd)) {
+								PTR_SET(cache->boundary, estrndup(Z_STRVAL_P(bnd), Z_STRLEN_P(bnd)));
 							}
+							zval_ptr_dtor(&bnd);
 						}
 					}
 				}
 			}
 		}
-		zend_hash_destroy(&params);
-		zval_ptr_dtor(&ct);
 	}
+	zend_hash_destroy(&params);
+}
+
+zend_bool php_http_message_is_multipart(php_http_message_t *msg, char **boundary)
+{
+	php_http_message_header_cache_t *ct = php_http_message_header_cached(msg, &msg->cache.type, &php_http_message_header_names.type, ZEND_STRL("Content-Type"), php_http_message_derive_type);
+
+	if (ct && ct->multipart) {
+		if (boundary && ct->boundary) {
+			*boundary = estrdup(ct->boundary);
+		}
+		return 1;
+	}
+	return 0;
+}
+
+zend_bool php_http_message_content_length(php_http_message_t *msg, long *length)
+{
+	php_http_message_header_cache_t *cl = php_http_message_header_cached(msg, &msg->cache.length, &php_http_message_header_names.length, ZEND_STRL("Content-Length"), php_http_message_derive_length);
+
+	if (cl && cl->num >= 0) {
+		*length = cl->num;
+		return 1;
+	}
+	return 0;
+}
+
+unsigned php_http_message_transfer_encoding(php_http_message_t *msg)
+{
+	php_http_message_header_cache_t *te = php_http_message_header_cached(msg, &msg->cache.transfer_encoding, &php_http_message_header_names.transfer_encoding, ZEND_STRL("Transfer-Encoding"), php_http_message_derive_encoding);
 
-	return is_multipart;
+	return te ? te->num : 0;
+}
+
+unsigned php_http_message_content_encoding(php_http_message_t *msg)
+{
+	php_http_message_header_cache_t *ce = php_http_message_header_cached(msg, &msg->cache.content_encoding, &php_http_message_header_names.content_encoding, ZEND_STRL("Content-Encoding"), php_http_message_derive_encoding);
+
+	return ce ? ce->num : 0;
 }
 
 /* */
@@ -292,45 +458,45 @@ void php_http_message_set_info(php_http_message_t *message, php_http_info_t *inf
 
 void php_http_message_update_headers(php_http_message_t *msg)
 {
-	zval *h;
+	zval *h, **cur;
 	size_t size;
+	long length;
 
 	if (php_http_message_body_stream(msg->body)->readfilters.head) {
 		/* if a read stream filter is attached to the body the caller must also care for the headers */
-	} else if ((h = php_http_message_header(msg, ZEND_STRL("Content-Range"), 0))) {
+	} else if (SUCCESS == zend_hash_find(&msg->hdrs, ZEND_STRS("Content-Range"), (void *) &cur)) {
 		/* don't mess around with a Content-Range message */
-		zval_ptr_dtor(&h);
 	} else if ((size = php_http_message_body_size(msg->body))) {
-		MAKE_STD_ZVAL(h);
-		ZVAL_LONG(h, size);
-		zend_hash_update(&msg->hdrs, "Content-Length", sizeof("Content-Length"), &h, sizeof(zval *), NULL);
+		/* only replace Content-Length if it is out of date */
+		if (SUCCESS != zend_hash_find(&msg->hdrs, ZEND_STRS("Content-Length"), (void *) &cur)
+		||	Z_TYPE_PP(cur) != IS_LONG
+		||	Z_LVAL_PP(cur) != (long) size
+		) {
+			MAKE_STD_ZVAL(h);
+			ZVAL_LONG(h, size);
+			zend_hash_update(&msg->hdrs, "Content-Length", sizeof("Content-Length"), &h, sizeof(zval *), NULL);
+		}
 
 		if (msg->body->boundary) {
+			php_http_message_header_cache_t *ct = php_http_message_header_cached(msg, &msg->cache.type, &php_http_message_header_names.type, ZEND_STRL("Content-Type"), php_http_message_derive_type);
 			char *str;
 			size_t len;
 
-			if (!(h = php_http_message_header(msg, ZEND_STRL("Content-Type"), 1))) {
+			if (!ct) {
 				len = spprintf(&str, 0, "multipart/form-data; boundary=\"%s\"", msg->body->boundary);
 				MAKE_STD_ZVAL(h);
 				ZVAL_STRINGL(h, str, len, 0);
 				zend_hash_update(&msg->hdrs, "Content-Type", sizeof("Content-Type"), &h, sizeof(zval *), NULL);
-			} else if (!php_http_match(Z_STRVAL_P(h), "boundary=", PHP_HTTP_MATCH_WORD)) {
-				zval_dtor(h);
-				Z_STRLEN_P(h) = spprintf(&Z_STRVAL_P(h), 0, "%s; boundary=\"%s\"", Z_STRVAL_P(h), msg->body->boundary);
+			} else if (!php_http_match(ct->raw_str, "boundary=", PHP_HTTP_MATCH_WORD)) {
+				len = spprintf(&str, 0, "%s; boundary=\"%s\"", ct->raw_str, msg->body->boundary);
+				MAKE_STD_ZVAL(h);
+				ZVAL_STRINGL(h, str, len, 0);
 				zend_hash_update(&msg->hdrs, "Content-Type", sizeof("Content-Type"), &h, sizeof(zval *), NULL);
-			} else {
-				zval_ptr_dtor(&h);
 			}
 		}
-	} else if ((h = php_http_message_header(msg, ZEND_STRL("Content-Length"), 1))) {
-		zval *h_cpy = php_http_ztyp(IS_LONG, h);
-
-		zval_ptr_dtor(&h);
-		if (Z_LVAL_P(h_cpy)) {
-			/* body->size == 0, so get rid of old Content-Length */
-			zend_hash_del(&msg->hdrs, "Content-Length", sizeof("Content-Length"));
-		}
-		zval_ptr_dtor(&h_cpy);
+	} else if (php_http_message_content_length(msg, &length) && length) {
+		/* body->size == 0, so get rid of old Content-Length */
+		zend_hash_del(&msg->hdrs, "Content-Length", sizeof("Content-Length"));
 	}
 }
 
@@ -499,6 +665,10 @@ void php_http_message_dtor(php_http_message_t *message)
 {
 	if (message) {
 		zend_hash_destroy(&message->hdrs);
+		php_http_message_header_cache_dtor(&message->cache.length);
+		php_http_message_header_cache_dtor(&message->cache.type);
+		php_http_message_header_cache_dtor(&message->cache.transfer_encoding);
+		php_http_message_header_cache_dtor(&message->cache.content_encoding);
 		php_http_message_body_free(&message->body);
 		
 		switch (message->type) {
@@ -896,6 +1066,11 @@ void php_http_message_object_free(void *object TSRMLS_DC)
 	efree(o);
 }
 
+zend_object_handlers *php_http_message_object_get_handlers(void)
+{
+	return &php_http_message_object_handlers;
+}
+
 static zval *php_http_message_object_read_prop(zval *object, zval *member, int type PHP_HTTP_ZEND_LITERAL_DC TSRMLS_DC)
 {
 	php_http_message_object_t *obj = zend_object_store_get_object(object TSRMLS_CC);
@@ -1868,10 +2043,11 @@ static PHP_METHOD(HttpMessage, splitMultipartBody)
 		return;
 	}
 
-	php_http_expect(msg = php_http_message_body_split(obj->message->body, boundary), bad_message, return);
-
+	msg = php_http_message_body_split(obj->message->body, boundary);
 	PTR_FREE(boundary);
 
+	php_http_expect(msg, bad_message, return);
+
 	RETURN_OBJVAL(php_http_message_object_new_ex(php_http_message_class_entry, msg, NULL TSRMLS_CC), 0);
 }
 
@@ -22,9 +22,30 @@
 typedef php_http_info_type_t php_http_message_type_t;
 typedef struct php_http_message php_http_message_t;
 
+#define PHP_HTTP_MESSAGE_ENCODING_CHUNKED	0x01
+#define PHP_HTTP_MESSAGE_ENCODING_GZIP		0x02
+#define PHP_HTTP_MESSAGE_ENCODING_DEFLATE	0x04
+#define PHP_HTTP_MESSAGE_ENCODING_OTHER		0x80
+
+/* typed value of a header, revalidated against its raw value in hdrs on access */
+typedef struct php_http_message_header_cache {
+	char *raw_str;
+	size_t raw_len;
+	long num; /* Content-Length, or PHP_HTTP_MESSAGE_ENCODING_* flags */
+	char *boundary;
+	unsigned multipart:1;
+	unsigned valid:1;
+} php_http_message_header_cache_t;
+
 struct php_http_message {
 	PHP_HTTP_INFO_IMPL(http, type)
 	HashTable hdrs;
+	struct {
+		php_http_message_header_cache_t length;
+		php_http_message_header_cache_t type;
+		php_http_message_header_cache_t transfer_encoding;
+		php_http_message_header_cache_t content_encoding;
+	} cache;
 	php_http_message_body_t *body;
 	php_http_message_t *parent;
 	void *opaque;
@@ -49,6 +70,9 @@ PHP_HTTP_API void php_http_message_update_headers(php_http_message_t *msg);
 
 PHP_HTTP_API zval *php_http_message_header(php_http_message_t *msg, const char *key_str, size_t key_len, int join);
 PHP_HTTP_API zend_bool php_http_message_is_multipart(php_http_message_t *msg, char **boundary);
+PHP_HTTP_API zend_bool php_http_message_content_length(php_http_message_t *msg, long *length);
+PHP_HTTP_API unsigned php_http_message_transfer_encoding(php_http_message_t *msg);
+PHP_HTTP_API unsigned php_http_message_content_encoding(php_http_message_t *msg);
 
 PHP_HTTP_API void php_http_message_to_string(php_http_message_t *msg, char **string, size_t *length);
 PHP_HTTP_API void php_http_message_to_struct(php_http_message_t *msg, zval *strct);
@@ -89,6 +113,7 @@ zend_object_value php_http_message_object_new(zend_class_entry *ce TSRMLS_DC);
 zend_object_value php_http_message_object_new_ex(zend_class_entry *ce, php_http_message_t *msg, php_http_message_object_t **ptr TSRMLS_DC);
 zend_object_value php_http_message_object_clone(zval *object TSRMLS_DC);
 void php_http_message_object_free(void *object TSRMLS_DC);
+zend_object_handlers *php_http_message_object_get_handlers(void);
 
 #endif
 
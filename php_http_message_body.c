@@ -62,6 +62,45 @@ php_http_message_body_t *php_http_message_body_init(php_http_message_body_t **bo
 	return body;
 }
 
+php_http_message_body_t *php_http_message_body_init_sink(php_http_message_body_t **body_ptr, size_t limit TSRMLS_DC)
+{
+	php_stream *stream;
+	php_http_message_body_t *body;
+
+	if (body_ptr && *body_ptr) {
+		return php_http_message_body_init(body_ptr, NULL TSRMLS_CC);
+	}
+	if (!(stream = php_http_message_body_sink_create(limit TSRMLS_CC))) {
+		return php_http_message_body_init(body_ptr, NULL TSRMLS_CC);
+	}
+
+	body = php_http_message_body_init(body_ptr, stream TSRMLS_CC);
+	/* the body holds the only reference */
+	zend_list_delete(stream->rsrc_id);
+
+	return body;
+}
+
+php_http_message_body_t *php_http_message_body_init_view(php_http_message_body_t **body_ptr, php_http_message_body_t *from, off_t offset, size_t length)
+{
+	php_stream *stream;
+	php_http_message_body_t *body;
+	TSRMLS_FETCH_FROM_CTX(from->ts);
+
+	if (body_ptr && *body_ptr) {
+		return php_http_message_body_init(body_ptr, NULL TSRMLS_CC);
+	}
+	if (!(stream = php_http_message_body_view_create(from, offset, length TSRMLS_CC))) {
+		return NULL;
+	}
+
+	body = php_http_message_body_init(body_ptr, stream TSRMLS_CC);
+	/* the body holds the only reference */
+	zend_list_delete(stream->rsrc_id);
+
+	return body;
+}
+
 unsigned php_http_message_body_addref(php_http_message_body_t *body)
 {
 	return ++body->refcount;
@@ -133,7 +172,7 @@ char *php_http_message_body_etag(php_http_message_body_t *body)
 	TSRMLS_FETCH_FROM_CTX(body->ts);
 
 	/* real file or temp buffer ? */
-	if (s->ops != &php_stream_temp_ops && s->ops != &php_stream_memory_ops) {
+	if (s->ops != &php_stream_temp_ops && s->ops != &php_stream_memory_ops && s->ops != &php_http_message_body_sink_ops) {
 		php_stream_stat(php_http_message_body_stream(body), &body->ssb);
 
 		if (body->ssb.sb.st_mtime) {
@@ -234,6 +273,603 @@ size_t php_http_message_body_append(php_http_message_body_t *body, const char *b
 	return len;
 }
 
+/* segmented in-memory sink */
+
+#define PHP_HTTP_SINK_SEGMENT_MIN 0x400
+#define PHP_HTTP_SINK_SEGMENT_MAX 0x10000
+
+typedef struct php_http_message_body_sink_segment {
+	struct php_http_message_body_sink_segment *next;
+	size_t size;
+	size_t used;
+	char data[1];
+} php_http_message_body_sink_segment_t;
+
+typedef struct php_http_message_body_sink {
+	php_http_message_body_sink_segment_t *head;
+	php_http_message_body_sink_segment_t *tail;
+
+	/* segment and its start offset the cursor is in */
+	struct {
+		php_http_message_body_sink_segment_t *seg;
+		size_t base;
+	} cur;
+
+	size_t size;
+	size_t pos;
+	size_t limit;
+
+	php_stream *spill;
+} php_http_message_body_sink_t;
+
+static void php_http_message_body_sink_free_segments(php_http_message_body_sink_segment_t *seg)
+{
+	while (seg) {
+		php_http_message_body_sink_segment_t *next = seg->next;
+
+		efree(seg);
+		seg = next;
+	}
+}
+
+/* move the cursor to the segment containing pos */
+static php_http_message_body_sink_segment_t *php_http_message_body_sink_locate(php_http_message_body_sink_t *sink, size_t pos, size_t *offset)
+{
+	php_http_message_body_sink_segment_t *seg = sink->cur.seg;
+	size_t base = sink->cur.base;
+
+	if (!seg || pos < base) {
+		seg = sink->head;
+		base = 0;
+	}
+	while (seg && pos >= base + seg->used && seg->next) {
+		base += seg->used;
+		seg = seg->next;
+	}
+
+	sink->cur.seg = seg;
+	sink->cur.base = base;
+	*offset = pos - base;
+
+	return seg;
+}
+
+static size_t php_http_message_body_sink_append_segments(php_http_message_body_sink_t *sink, const char *buf, size_t len)
+{
+	size_t left = len;
+
+	while (left) {
+		php_http_message_body_sink_segment_t *seg = sink->tail;
+		size_t copy;
+
+		if (!seg || seg->used == seg->size) {
+			size_t size = seg ? MIN(seg->size << 1, PHP_HTTP_SINK_SEGMENT_MAX) : PHP_HTTP_SINK_SEGMENT_MIN;
+
+			/* fit larger chunks as a whole */
+			if (size < left) {
+				size = left;
+			}
+			seg = emalloc(sizeof(*seg) + size - 1);
+			seg->next = NULL;
+			seg->size = size;
+			seg->used = 0;
+
+			if (sink->tail) {
+				sink->tail->next = seg;
+			} else {
+				sink->head = seg;
+			}
+			sink->tail = seg;
+		}
+
+		copy = MIN(left, seg->size - seg->used);
+		memcpy(&seg->data[seg->used], buf, copy);
+		seg->used += copy;
+		buf += copy;
+		left -= copy;
+	}
+
+	sink->size += len;
+	return len;
+}
+
+static ZEND_RESULT_CODE php_http_message_body_sink_spill(php_http_message_body_sink_t *sink, php_stream *stream TSRMLS_DC)
+{
+	php_http_message_body_sink_segment_t *seg;
+	php_stream *spill;
+
+	if (!(spill = php_stream_temp_create(TEMP_STREAM_DEFAULT, 0))) {
+		return FAILURE;
+	}
+
+	/* the segments stay the body until everything has been moved */
+	for (seg = sink->head; seg; seg = seg->next) {
+		if (seg->used != php_stream_write(spill, seg->data, seg->used)) {
+			php_stream_close(spill);
+			return FAILURE;
+		}
+	}
+	php_stream_seek(spill, sink->pos, SEEK_SET);
+
+	sink->spill = spill;
+	php_stream_encloses(stream, sink->spill);
+
+	php_http_message_body_sink_free_segments(sink->head);
+	sink->head = sink->tail = sink->cur.seg = NULL;
+	sink->cur.base = 0;
+
+	return SUCCESS;
+}
+
+static size_t php_http_message_body_sink_write(php_stream *stream, const char *buf, size_t len TSRMLS_DC)
+{
+	php_http_message_body_sink_t *sink = stream->abstract;
+	size_t written = 0;
+
+	if (!sink->spill && sink->limit && sink->pos + len > sink->limit) {
+		if (SUCCESS != php_http_message_body_sink_spill(sink, stream TSRMLS_CC)) {
+			/* the body is still complete in memory; keep it there instead of trying again */
+			sink->limit = 0;
+		}
+	}
+	if (sink->spill) {
+		written = php_stream_write(sink->spill, buf, len);
+		if ((sink->pos += written) > sink->size) {
+			sink->size = sink->pos;
+		}
+		return written;
+	}
+
+	/* overwrite */
+	while (sink->pos < sink->size && written < len) {
+		size_t offset, copy;
+		php_http_message_body_sink_segment_t *seg = php_http_message_body_sink_locate(sink, sink->pos, &offset);
+
+		copy = MIN(len - written, seg->used - offset);
+		memcpy(&seg->data[offset], buf + written, copy);
+		written += copy;
+		sink->pos += copy;
+	}
+	/* append */
+	if (written < len) {
+		written += php_http_message_body_sink_append_segments(sink, buf + written, len - written);
+		sink->pos = sink->size;
+	}
+
+	return written;
+}
+
+static size_t php_http_message_body_sink_read(php_stream *stream, char *buf, size_t len TSRMLS_DC)
+{
+	php_http_message_body_sink_t *sink = stream->abstract;
+	size_t read = 0;
+
+	if (sink->spill) {
+		read = php_stream_read(sink->spill, buf, len);
+		sink->pos += read;
+		if (php_stream_eof(sink->spill)) {
+			stream->eof = 1;
+		}
+		return read;
+	}
+
+	if (sink->pos >= sink->size) {
+		stream->eof = 1;
+		return 0;
+	}
+
+	while (read < len && sink->pos < sink->size) {
+		size_t offset, copy;
+		php_http_message_body_sink_segment_t *seg = php_http_message_body_sink_locate(sink, sink->pos, &offset);
+
+		copy = MIN(len - read, seg->used - offset);
+		memcpy(buf + read, &seg->data[offset], copy);
+		read += copy;
+		sink->pos += copy;
+	}
+
+	return read;
+}
+
+static int php_http_message_body_sink_close(php_stream *stream, int close_handle TSRMLS_DC)
+{
+	php_http_message_body_sink_t *sink = stream->abstract;
+
+	if (sink->spill) {
+		php_stream_free_enclosed(sink->spill, PHP_STREAM_FREE_CLOSE | (close_handle ? 0 : PHP_STREAM_FREE_PRESERVE_HANDLE));
+	}
+	php_http_message_body_sink_free_segments(sink->head);
+	efree(sink);
+	stream->abstract = NULL;
+
+	return 0;
+}
+
+static int php_http_message_body_sink_flush(php_stream *stream TSRMLS_DC)
+{
+	php_http_message_body_sink_t *sink = stream->abstract;
+
+	return sink->spill ? php_stream_flush(sink->spill) : 0;
+}
+
+static int php_http_message_body_sink_seek(php_stream *stream, off_t offset, int whence, off_t *newoffset TSRMLS_DC)
+{
+	php_http_message_body_sink_t *sink = stream->abstract;
+	off_t pos;
+
+	if (sink->spill) {
+		if (0 != php_stream_seek(sink->spill, offset, whence)) {
+			return -1;
+		}
+		*newoffset = sink->pos = php_stream_tell(sink->spill);
+		stream->eof = 0;
+		return 0;
+	}
+
+	switch (whence) {
+		case SEEK_SET:
+			pos = offset;
+			break;
+		case SEEK_CUR:
+			pos = sink->pos + offset;
+			break;
+		case SEEK_END:
+			pos = sink->size + offset;
+			break;
+		default:
+			return -1;
+	}
+	if (pos < 0 || (size_t) pos > sink->size) {
+		*newoffset = sink->pos;
+		return -1;
+	}
+
+	*newoffset = sink->pos = pos;
+	stream->eof = 0;
+	return 0;
+}
+
+static int php_http_message_body_sink_stat(php_stream *stream, php_stream_statbuf *ssb TSRMLS_DC)
+{
+	php_http_message_body_sink_t *sink = stream->abstract;
+
+	if (sink->spill) {
+		return php_stream_stat(sink->spill, ssb);
+	}
+
+	/* like php://memory */
+	memset(ssb, 0, sizeof(*ssb));
+	ssb->sb.st_mode = S_IFREG | 0666;
+	ssb->sb.st_size = sink->size;
+	ssb->sb.st_nlink = 1;
+	ssb->sb.st_rdev = -1;
+	ssb->sb.st_dev = 0xC;
+#ifdef HAVE_ST_BLKSIZE
+	ssb->sb.st_blksize = -1;
+#endif
+#ifdef HAVE_ST_BLOCKS
+	ssb->sb.st_blocks = -1;
+#endif
+
+	return 0;
+}
+
+static int php_http_message_body_sink_set_option(php_stream *stream, int option, int value, void *ptrparam TSRMLS_DC)
+{
+	php_http_message_body_sink_t *sink = stream->abstract;
+	size_t newsize;
+
+	if (option != PHP_STREAM_OPTION_TRUNCATE_API) {
+		return sink->spill ? php_stream_set_option(sink->spill, option, value, ptrparam) : PHP_STREAM_OPTION_RETURN_NOTIMPL;
+	}
+
+	switch (value) {
+		case PHP_STREAM_TRUNCATE_SUPPORTED:
+			return PHP_STREAM_OPTION_RETURN_OK;
+
+		case PHP_STREAM_TRUNCATE_SET_SIZE:
+			newsize = *(size_t *) ptrparam;
+
+			if (sink->spill) {
+				if (php_stream_truncate_set_size(sink->spill, newsize)) {
+					return PHP_STREAM_OPTION_RETURN_ERR;
+				}
+				sink->size = newsize;
+				return PHP_STREAM_OPTION_RETURN_OK;
+			}
+
+			if (newsize < sink->size) {
+				size_t offset;
+				php_http_message_body_sink_segment_t *seg = php_http_message_body_sink_locate(sink, newsize, &offset);
+
+				if (seg) {
+					seg->used = offset;
+					php_http_message_body_sink_free_segments(seg->next);
+					seg->next = NULL;
+					sink->tail = seg;
+				}
+				sink->size = newsize;
+			} else while (newsize > sink->size) {
+				static const char zeros[0x100] = {0};
+
+				php_http_message_body_sink_append_segments(sink, zeros, MIN(sizeof(zeros), newsize - sink->size));
+			}
+			if (sink->pos > sink->size) {
+				sink->pos = sink->size;
+			}
+			return PHP_STREAM_OPTION_RETURN_OK;
+	}
+
+	return PHP_STREAM_OPTION_RETURN_NOTIMPL;
+}
+
+php_stream_ops php_http_message_body_sink_ops = {
+	php_http_message_body_sink_write,
+	php_http_message_body_sink_read,
+	php_http_message_body_sink_close,
+	php_http_message_body_sink_flush,
+	"http\\Message\\Body",
+	php_http_message_body_sink_seek,
+	NULL, /* cast */
+	php_http_message_body_sink_stat,
+	php_http_message_body_sink_set_option
+};
+
+php_stream *php_http_message_body_sink_create(size_t limit TSRMLS_DC)
+{
+	php_http_message_body_sink_t *sink = ecalloc(1, sizeof(*sink));
+	php_stream *stream;
+
+	sink->limit = limit;
+
+	if (!(stream = php_stream_alloc(&php_http_message_body_sink_ops, sink, NULL, "w+b"))) {
+		efree(sink);
+		return NULL;
+	}
+	stream->flags |= PHP_STREAM_FLAG_NO_BUFFER;
+
+	return stream;
+}
+
+void php_http_message_body_sink_set_limit(php_stream *stream, size_t limit)
+{
+	php_http_message_body_sink_t *sink = stream->abstract;
+
+	sink->limit = limit;
+}
+
+size_t php_http_message_body_sink_append(php_stream *stream, const char *buf, size_t len TSRMLS_DC)
+{
+	php_http_message_body_sink_t *sink = stream->abstract;
+
+	/* skip the stream layer and its seek, but keep its position in sync */
+	if (!sink->spill && (!sink->limit || sink->size + len <= sink->limit)) {
+		php_http_message_body_sink_append_segments(sink, buf, len);
+	} else {
+		if (sink->pos != sink->size) {
+			php_stream_seek(stream, 0, SEEK_END);
+		}
+		len = php_stream_write(stream, buf, len);
+	}
+	stream->position = sink->pos = sink->size;
+
+	return len;
+}
+
+/* read-only window into another body, which gets copied on the first write */
+
+typedef struct php_http_message_body_view {
+	php_http_message_body_t *body;
+	off_t offset;
+	size_t length;
+	size_t pos;
+
+	php_stream *copy;
+} php_http_message_body_view_t;
+
+static ZEND_RESULT_CODE php_http_message_body_view_materialize(php_http_message_body_view_t *view, php_stream *stream TSRMLS_DC)
+{
+	if (!(view->copy = php_stream_temp_create(TEMP_STREAM_DEFAULT, 0xffff))) {
+		return FAILURE;
+	}
+	php_stream_encloses(stream, view->copy);
+
+	if (view->length && SUCCESS != php_http_message_body_to_stream(view->body, view->copy, view->offset, view->length)) {
+		php_stream_free_enclosed(view->copy, PHP_STREAM_FREE_CLOSE);
+		view->copy = NULL;
+		return FAILURE;
+	}
+	php_stream_seek(view->copy, view->pos, SEEK_SET);
+	php_http_message_body_free(&view->body);
+
+	return SUCCESS;
+}
+
+static size_t php_http_message_body_view_write(php_stream *stream, const char *buf, size_t len TSRMLS_DC)
+{
+	php_http_message_body_view_t *view = stream->abstract;
+	size_t written;
+
+	if (!view->copy && SUCCESS != php_http_message_body_view_materialize(view, stream TSRMLS_CC)) {
+		return 0;
+	}
+
+	written = php_stream_write(view->copy, buf, len);
+	if ((view->pos += written) > view->length) {
+		view->length = view->pos;
+	}
+	return written;
+}
+
+static size_t php_http_message_body_view_read(php_stream *stream, char *buf, size_t len TSRMLS_DC)
+{
+	php_http_message_body_view_t *view = stream->abstract;
+	php_stream *s;
+	size_t read;
+
+	if (view->copy) {
+		read = php_stream_read(view->copy, buf, len);
+		view->pos += read;
+		if (php_stream_eof(view->copy)) {
+			stream->eof = 1;
+		}
+		return read;
+	}
+
+	if (view->pos >= view->length) {
+		stream->eof = 1;
+		return 0;
+	}
+
+	/* other views may share the stream, so always seek */
+	s = php_http_message_body_stream(view->body);
+	if (0 != php_stream_seek(s, view->offset + view->pos, SEEK_SET)) {
+		return 0;
+	}
+	read = php_stream_read(s, buf, MIN(len, view->length - view->pos));
+	view->pos += read;
+
+	return read;
+}
+
+static int php_http_message_body_view_close(php_stream *stream, int close_handle TSRMLS_DC)
+{
+	php_http_message_body_view_t *view = stream->abstract;
+
+	if (view->copy) {
+		php_stream_free_enclosed(view->copy, PHP_STREAM_FREE_CLOSE | (close_handle ? 0 : PHP_STREAM_FREE_PRESERVE_HANDLE));
+	}
+	php_http_message_body_free(&view->body);
+	efree(view);
+	stream->abstract = NULL;
+
+	return 0;
+}
+
+static int php_http_message_body_view_flush(php_stream *stream TSRMLS_DC)
+{
+	php_http_message_body_view_t *view = stream->abstract;
+
+	return view->copy ? php_stream_flush(view->copy) : 0;
+}
+
+static int php_http_message_body_view_seek(php_stream *stream, off_t offset, int whence, off_t *newoffset TSRMLS_DC)
+{
+	php_http_message_body_view_t *view = stream->abstract;
+	off_t pos;
+
+	if (view->copy) {
+		if (0 != php_stream_seek(view->copy, offset, whence)) {
+			return -1;
+		}
+		*newoffset = view->pos = php_stream_tell(view->copy);
+		stream->eof = 0;
+		return 0;
+	}
+
+	switch (whence) {
+		case SEEK_SET:
+			pos = offset;
+			break;
+		case SEEK_CUR:
+			pos = view->pos + offset;
+			break;
+		case SEEK_END:
+			pos = view->length + offset;
+			break;
+		default:
+			return -1;
+	}
+	if (pos < 0 || (size_t) pos > view->length) {
+		*newoffset = view->pos;
+		return -1;
+	}
+
+	*newoffset = view->pos = pos;
+	stream->eof = 0;
+	return 0;
+}
+
+static int php_http_message_body_view_stat(php_stream *stream, php_stream_statbuf *ssb TSRMLS_DC)
+{
+	php_http_message_body_view_t *view = stream->abstract;
+
+	if (view->copy) {
+		return php_stream_stat(view->copy, ssb);
+	}
+
+	memset(ssb, 0, sizeof(*ssb));
+	ssb->sb.st_mode = S_IFREG | 0666;
+	ssb->sb.st_size = view->length;
+	ssb->sb.st_nlink = 1;
+	ssb->sb.st_rdev = -1;
+	ssb->sb.st_dev = 0xC;
+#ifdef HAVE_ST_BLKSIZE
+	ssb->sb.st_blksize = -1;
+#endif
+#ifdef HAVE_ST_BLOCKS
+	ssb->sb.st_blocks = -1;
+#endif
+
+	return 0;
+}
+
+static int php_http_message_body_view_set_option(php_stream *stream, int option, int value, void *ptrparam TSRMLS_DC)
+{
+	php_http_message_body_view_t *view = stream->abstract;
+
+	if (option == PHP_STREAM_OPTION_TRUNCATE_API) {
+		switch (value) {
+			case PHP_STREAM_TRUNCATE_SUPPORTED:
+				return PHP_STREAM_OPTION_RETURN_OK;
+
+			case PHP_STREAM_TRUNCATE_SET_SIZE:
+				if (!view->copy && SUCCESS != php_http_message_body_view_materialize(view, stream TSRMLS_CC)) {
+					return PHP_STREAM_OPTION_RETURN_ERR;
+				}
+				if (php_stream_truncate_set_size(view->copy, *(size_t *) ptrparam)) {
+					return PHP_STREAM_OPTION_RETURN_ERR;
+				}
+				view->length = *(size_t *) ptrparam;
+				return PHP_STREAM_OPTION_RETURN_OK;
+		}
+	}
+
+	return view->copy ? php_stream_set_option(view->copy, option, value, ptrparam) : PHP_STREAM_OPTION_RETURN_NOTIMPL;
+}
+
+php_stream_ops php_http_message_body_view_ops = {
+	php_http_message_body_view_write,
+	php_http_message_body_view_read,
+	php_http_message_body_view_close,
+	php_http_message_body_view_flush,
+	"http\\Message\\Body",
+	php_http_message_body_view_seek,
+	NULL, /* cast */
+	php_http_message_body_view_stat,
+	php_http_message_body_view_set_option
+};
+
+php_stream *php_http_message_body_view_create(php_http_message_body_t *body, off_t offset, size_t length TSRMLS_DC)
+{
+	php_http_message_body_view_t *view = ecalloc(1, sizeof(*view));
+	php_stream *stream;
+
+	view->offset = offset;
+	view->length = length;
+
+	if (!(stream = php_stream_alloc(&php_http_message_body_view_ops, view, NULL, "w+b"))) {
+		efree(view);
+		return NULL;
+	}
+	stream->flags |= PHP_STREAM_FLAG_NO_BUFFER;
+
+	php_http_message_body_addref(body);
+	view->body = body;
+
+	return stream;
+}
+
 size_t php_http_message_body_appendf(php_http_message_body_t *body, const char *fmt, ...)
 {
 	va_list argv;
@@ -456,112 +1092,184 @@ static ZEND_RESULT_CODE add_recursive_files(php_http_message_body_t *body, const
 	}
 }
 
+#define PHP_HTTP_MESSAGE_BODY_SPLIT_WINDOW 0x10000
+
 struct splitbody_arg {
-	php_http_buffer_t buf;
-	php_http_message_parser_t *parser;
-	char *boundary_str;
-	size_t boundary_len;
-	size_t consumed;
+	php_http_message_body_t *body;
+	php_stream *s;
+	size_t size;
+	php_http_bmh_t bmh;
+	char *win_str;
+	size_t win_len;
 };
 
-static size_t splitbody(void *opaque, char *buf, size_t len TSRMLS_DC)
+static size_t splitbody_read(struct splitbody_arg *arg, size_t pos, size_t len TSRMLS_DC)
 {
-	struct splitbody_arg *arg = opaque;
-	const char *boundary = NULL;
-	size_t consumed = 0;
-	int first_boundary;
+	size_t read = 0;
 
-	do {
-		first_boundary = !(consumed || arg->consumed);
+	if (0 != php_stream_seek(arg->s, pos, SEEK_SET)) {
+		return 0;
+	}
+	len = MIN(len, arg->win_len);
+	while (read < len) {
+		size_t justread = php_stream_read(arg->s, arg->win_str + read, len - read);
 
-		if ((boundary = php_http_locate_str(buf, len, arg->boundary_str + first_boundary, arg->boundary_len - first_boundary))) {
-			size_t real_boundary_len = arg->boundary_len - 1, cut;
-			const char *real_boundary = boundary + !first_boundary;
-			int eol_len = 0;
+		if (!justread) {
+			break;
+		}
+		read += justread;
+	}
+	return read;
+}
 
-			if (buf + len <= real_boundary + real_boundary_len) {
-				/* if we just have enough data for the boundary, it's just a byte too less */
-				arg->consumed += consumed;
-				return consumed;
-			}
+/* offset of the next "\n--boundary" at or after pos, or -1 */
+static size_t splitbody_locate(struct splitbody_arg *arg, size_t pos TSRMLS_DC)
+{
+	while (pos + arg->bmh.len <= arg->size) {
+		size_t read = splitbody_read(arg, pos, arg->win_len TSRMLS_CC);
+		const char *found = php_http_bmh_locate(&arg->bmh, arg->win_str, read);
 
-			if (!first_boundary) {
-				/* this is not the first boundary, read rest of this message */
-				php_http_buffer_append(&arg->buf, buf, real_boundary - buf);
-				php_http_message_parser_parse(arg->parser, &arg->buf, 0, &arg->parser->message);
-			}
+		if (found) {
+			return pos + (found - arg->win_str);
+		}
+		if (read < arg->bmh.len) {
+			break;
+		}
+		/* overlap the windows by a boundary less one byte */
+		pos += read - arg->bmh.len + 1;
+	}
+	return -1;
+}
 
-			/* move after the boundary */
-			cut = real_boundary - buf + real_boundary_len;
-			buf += cut;
-			len -= cut;
-			consumed += cut;
-
-			if (buf == php_http_locate_bin_eol(buf, len, &eol_len)) {
-				/* skip CRLF */
-				buf += eol_len;
-				len -= eol_len;
-				consumed += eol_len;
-
-				if (!first_boundary) {
-					/* advance messages */
-					php_http_message_t *msg;
-
-					msg = php_http_message_init(NULL, 0, NULL TSRMLS_CC);
-					msg->parent = arg->parser->message;
-					arg->parser->message = msg;
-				}
-			} else {
-				/* is this the last boundary? */
-				if (*buf == '-') {
-					/* ignore the rest */
-					consumed += len;
-					len = 0;
-				} else {
-					/* let this be garbage */
-					php_error_docref(NULL TSRMLS_CC, E_WARNING, "Malformed multipart boundary at pos %zu", consumed);
-					return -1;
-				}
-			}
+/* length of the header block at the start of the window, including the empty line, or 0 */
+static size_t splitbody_headers(const char *str, size_t len)
+{
+	const char *ptr = str, *end = str + len;
+
+	/* no headers at all */
+	if (len && *str == '\n') {
+		return 1;
+	}
+	if (len > 1 && str[0] == '\r' && str[1] == '\n') {
+		return 2;
+	}
+
+	while ((ptr = memchr(ptr, '\n', end - ptr))) {
+		if (++ptr < end && *ptr == '\n') {
+			return ptr + 1 - str;
+		}
+		if (ptr + 1 < end && ptr[0] == '\r' && ptr[1] == '\n') {
+			return ptr + 2 - str;
+		}
+	}
+	return 0;
+}
+
+static php_http_message_t *splitbody_part(struct splitbody_arg *arg, size_t pos, size_t end TSRMLS_DC)
+{
+	php_http_message_parser_t parser;
+	php_http_buffer_t buf;
+	php_http_message_t *msg = NULL;
+	size_t hdr_len = 0, read = splitbody_read(arg, pos, end - pos TSRMLS_CC);
+
+	php_http_message_parser_init(&parser TSRMLS_CC);
+	php_http_buffer_init(&buf);
+
+	/* parse nothing but the headers */
+	if (read && (hdr_len = splitbody_headers(arg->win_str, read))) {
+		php_http_buffer_append(&buf, arg->win_str, hdr_len);
+		if (PHP_HTTP_MESSAGE_PARSER_STATE_FAILURE == php_http_message_parser_parse(&parser, &buf, 0, &msg)) {
+			hdr_len = 0;
+		}
+	}
+
+	if (msg && hdr_len && !parser.inflate && !parser.dechunk
+	&&	!zend_hash_exists(&msg->hdrs, ZEND_STRS("X-Original-Content-Length"))
+	&&	!zend_hash_exists(&msg->hdrs, ZEND_STRS("Content-Range"))
+	) {
+		/* a plain body: refer to the original, from right after the headers up to the boundary */
+		php_http_message_body_free(&msg->body);
+		msg->body = php_http_message_body_init_view(NULL, arg->body, pos + hdr_len, end - pos - hdr_len);
+	} else {
+		/* encoded or length delimited body, or overlong headers, which all need the parser to see the whole part */
+		if (msg) {
+			php_http_message_free(&msg);
 		}
-	} while (boundary && len);
+		php_http_message_parser_dtor(&parser);
+		php_http_message_parser_init(&parser TSRMLS_CC);
+		php_http_buffer_reset(&buf);
 
-	/* let there be room for the next boundary */
-	if (len > arg->boundary_len) {
-		consumed += len - arg->boundary_len;
-		php_http_buffer_append(&arg->buf, buf, len - arg->boundary_len);
-		php_http_message_parser_parse(arg->parser, &arg->buf, 0, &arg->parser->message);
+		while (pos < end && (read = splitbody_read(arg, pos, end - pos TSRMLS_CC))) {
+			php_http_buffer_append(&buf, arg->win_str, read);
+			pos += read;
+		}
+		php_http_message_parser_parse(&parser, &buf, 0, &msg);
 	}
 
-	arg->consumed += consumed;
-	return consumed;
+	php_http_buffer_dtor(&buf);
+	php_http_message_parser_dtor(&parser);
+
+	if (!msg) {
+		msg = php_http_message_init(NULL, 0, NULL TSRMLS_CC);
+	}
+	return msg;
 }
 
 php_http_message_t *php_http_message_body_split(php_http_message_body_t *body, const char *boundary)
 {
-	php_stream *s = php_http_message_body_stream(body);
-	php_http_buffer_t *tmp = NULL;
 	php_http_message_t *msg = NULL;
 	struct splitbody_arg arg;
+	char *delim_str;
+	size_t delim_len, pos;
 	TSRMLS_FETCH_FROM_CTX(body->ts);
 
-	php_http_buffer_init(&arg.buf);
-	arg.parser = php_http_message_parser_init(NULL TSRMLS_CC);
-	arg.boundary_len = spprintf(&arg.boundary_str, 0, "\n--%s", boundary);
-	arg.consumed = 0;
-
-	php_stream_rewind(s);
-	while (!php_stream_eof(s)) {
-		php_http_buffer_passthru(&tmp, 0x1000, (php_http_buffer_pass_func_t) _php_stream_read, s, splitbody, &arg TSRMLS_CC);
+	/* a delimiter is "--boundary" at the start of a line */
+	delim_len = spprintf(&delim_str, 0, "\n--%s", boundary);
+	php_http_bmh_init(&arg.bmh, delim_str, delim_len);
+	arg.body = body;
+	arg.s = php_http_message_body_stream(body);
+	arg.size = php_http_message_body_size(body);
+	arg.win_len = MAX(PHP_HTTP_MESSAGE_BODY_SPLIT_WINDOW, delim_len << 1);
+	arg.win_str = emalloc(arg.win_len);
+
+	/* only the very first one may lack the preceding line break */
+	if (delim_len - 1 == splitbody_read(&arg, 0, delim_len - 1 TSRMLS_CC) && !memcmp(arg.win_str, delim_str + 1, delim_len - 1)) {
+		pos = 0;
+	} else if ((size_t) -1 != (pos = splitbody_locate(&arg, 0 TSRMLS_CC))) {
+		++pos;
 	}
 
-	msg = arg.parser->message;
-	arg.parser->message = NULL;
+	while (pos != (size_t) -1) {
+		php_http_message_t *part;
+		size_t read, next;
+		int eol_len = 0;
+
+		/* move after the boundary */
+		pos += delim_len - 1;
+		read = splitbody_read(&arg, pos, 2 TSRMLS_CC);
+
+		if (read && arg.win_str == php_http_locate_bin_eol(arg.win_str, read, &eol_len)) {
+			pos += eol_len;
+		} else if (read && *arg.win_str == '-') {
+			/* the last boundary; ignore the rest */
+			break;
+		} else {
+			/* let this be garbage */
+			php_error_docref(NULL TSRMLS_CC, E_WARNING, "Malformed multipart boundary at pos %zu", pos);
+			break;
+		}
+
+		/* the line break in front of the next delimiter still belongs to this part */
+		next = splitbody_locate(&arg, pos TSRMLS_CC);
+		part = splitbody_part(&arg, pos, next == (size_t) -1 ? arg.size : next + 1 TSRMLS_CC);
+		part->parent = msg;
+		msg = part;
+
+		pos = next == (size_t) -1 ? next : next + 1;
+	}
 
-	php_http_buffer_free(&tmp);
-	php_http_message_parser_free(&arg.parser);
-	php_http_buffer_dtor(&arg.buf);
-	PTR_FREE(arg.boundary_str);
+	efree(arg.win_str);
+	efree(delim_str);
 
 	return msg;
 }
@@ -26,6 +26,8 @@ typedef struct php_http_message_body {
 struct php_http_message;
 
 PHP_HTTP_API php_http_message_body_t *php_http_message_body_init(php_http_message_body_t **body, php_stream *stream TSRMLS_DC);
+PHP_HTTP_API php_http_message_body_t *php_http_message_body_init_sink(php_http_message_body_t **body, size_t limit TSRMLS_DC);
+PHP_HTTP_API php_http_message_body_t *php_http_message_body_init_view(php_http_message_body_t **body, php_http_message_body_t *from, off_t offset, size_t length);
 PHP_HTTP_API unsigned php_http_message_body_addref(php_http_message_body_t *body);
 PHP_HTTP_API php_http_message_body_t *php_http_message_body_copy(php_http_message_body_t *from, php_http_message_body_t *to);
 PHP_HTTP_API ZEND_RESULT_CODE php_http_message_body_add_form(php_http_message_body_t *body, HashTable *fields, HashTable *files);
@@ -45,6 +47,16 @@ PHP_HTTP_API char *php_http_message_body_etag(php_http_message_body_t *body);
 PHP_HTTP_API const char *php_http_message_body_boundary(php_http_message_body_t *body);
 PHP_HTTP_API struct php_http_message *php_http_message_body_split(php_http_message_body_t *body, const char *boundary);
 
+/* segmented in-memory stream, which spills to a temporary file when growing beyond limit (0: never) */
+PHP_HTTP_API php_stream_ops php_http_message_body_sink_ops;
+PHP_HTTP_API php_stream *php_http_message_body_sink_create(size_t limit TSRMLS_DC);
+PHP_HTTP_API void php_http_message_body_sink_set_limit(php_stream *sink, size_t limit);
+PHP_HTTP_API size_t php_http_message_body_sink_append(php_stream *sink, const char *buf, size_t len TSRMLS_DC);
+
+/* offset/length window into another body, copied on the first write */
+PHP_HTTP_API php_stream_ops php_http_message_body_view_ops;
+PHP_HTTP_API php_stream *php_http_message_body_view_create(php_http_message_body_t *body, off_t offset, size_t length TSRMLS_DC);
+
 static inline php_stream *php_http_message_body_stream(php_http_message_body_t *body)
 {
 	TSRMLS_FETCH_FROM_CTX(body->ts);
@@ -52,9 +52,14 @@ php_http_message_parser_t *php_http_message_parser_init(php_http_message_parser_
 	}
 	memset(parser, 0, sizeof(*parser));
 
+	if (PHP_HTTP_G->parser.body_size > 0) {
+		parser->limit.body = PHP_HTTP_G->parser.body_size;
+	}
+
 	TSRMLS_SET_CTX(parser->ts);
 
 	php_http_header_parser_init(&parser->header TSRMLS_CC);
+	php_http_buffer_init(&parser->inflated);
 
 	return parser;
 }
@@ -107,6 +112,7 @@ void php_http_message_parser_dtor(php_http_message_parser_t *parser)
 	if (parser->inflate) {
 		php_http_encoding_stream_free(&parser->inflate);
 	}
+	php_http_buffer_dtor(&parser->inflated);
 }
 
 void php_http_message_parser_free(php_http_message_parser_t **parser)
@@ -118,6 +124,175 @@ void php_http_message_parser_free(php_http_message_parser_t **parser)
 	}
 }
 
+static ZEND_RESULT_CODE php_http_message_parser_body(php_http_message_parser_t *parser, php_http_message_t *message, const char *str, size_t len)
+{
+	ZEND_RESULT_CODE rv = SUCCESS;
+	TSRMLS_FETCH_FROM_CTX(parser->ts);
+
+	/* FIXME: what if we re-use the parser? */
+	if (parser->inflate) {
+		php_http_buffer_reset(&parser->inflated);
+		if (SUCCESS != php_http_encoding_stream_update_buffer(parser->inflate, str, len, &parser->inflated)) {
+			return FAILURE;
+		}
+		str = parser->inflated.data;
+		len = parser->inflated.used;
+	}
+
+	/* count what is actually stored, so inflating cannot blow up either */
+	if (parser->limit.body && (parser->_body += len) > parser->limit.body) {
+		php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to parse message: body exceeded the limit of %zu bytes", parser->limit.body);
+		return FAILURE;
+	}
+
+	if (parser->callback.body) {
+		if (len) {
+			rv = parser->callback.body(parser->callback.arg, message, str, len);
+		}
+	} else {
+		php_stream_write(php_http_message_body_stream(message->body), str, len);
+	}
+
+	return rv;
+}
+
+static ZEND_RESULT_CODE php_http_message_parser_headers(php_http_message_parser_t *parser, php_http_message_t *message)
+{
+	if (parser->callback.headers) {
+		return parser->callback.headers(parser->callback.arg, message);
+	}
+	return SUCCESS;
+}
+
+php_http_message_parser_state_t php_http_message_parser_feed(php_http_message_parser_t *parser, php_http_buffer_t *buffer, const char *data_str, size_t data_len, unsigned flags, php_http_message_t **message)
+{
+	php_http_message_parser_state_t state = php_http_message_parser_state_is(parser);
+
+	while (data_len) {
+		php_http_message_parser_state_t current = php_http_message_parser_state_is(parser);
+
+		if (state == PHP_HTTP_MESSAGE_PARSER_STATE_DONE && !(flags & PHP_HTTP_MESSAGE_PARSER_GREEDY)) {
+			/* keep the rest for later */
+			php_http_buffer_append(buffer, data_str, data_len);
+			break;
+		}
+
+		/* identity encoded bodies are passed on straight from the caller's memory */
+		if (!buffer->used && parser->callback.body && *message
+		&&	(current == PHP_HTTP_MESSAGE_PARSER_STATE_BODY_LENGTH || current == PHP_HTTP_MESSAGE_PARSER_STATE_BODY_DUMB)
+		) {
+			size_t len = current == PHP_HTTP_MESSAGE_PARSER_STATE_BODY_LENGTH ? MIN(parser->body_length, data_len) : data_len;
+
+			if (SUCCESS != php_http_message_parser_body(parser, *message, data_str, len)) {
+				php_http_message_parser_state_pop(parser);
+				return php_http_message_parser_state_push(parser, 1, PHP_HTTP_MESSAGE_PARSER_STATE_FAILURE);
+			}
+			data_str += len;
+			data_len -= len;
+
+			if (current == PHP_HTTP_MESSAGE_PARSER_STATE_BODY_LENGTH && !(parser->body_length -= len)) {
+				php_http_message_parser_state_pop(parser);
+				php_http_message_parser_state_push(parser, 1, PHP_HTTP_MESSAGE_PARSER_STATE_BODY_DONE);
+				state = php_http_message_parser_parse(parser, buffer, flags, message);
+			}
+		} else {
+			/* headers, chunked bodies and partial data need to be buffered */
+			php_http_buffer_append(buffer, data_str, data_len);
+			data_len = 0;
+			state = php_http_message_parser_parse(parser, buffer, flags, message);
+		}
+
+		if (state == PHP_HTTP_MESSAGE_PARSER_STATE_FAILURE) {
+			return state;
+		}
+	}
+
+	if ((flags & PHP_HTTP_MESSAGE_PARSER_CLEANUP) && state != PHP_HTTP_MESSAGE_PARSER_STATE_DONE) {
+		if (!buffer->used && php_http_message_parser_state_is(parser) == PHP_HTTP_MESSAGE_PARSER_STATE_BODY_DUMB) {
+			/* the body has been passed on up to the end of input */
+			php_http_message_parser_state_pop(parser);
+			php_http_message_parser_state_push(parser, 1, PHP_HTTP_MESSAGE_PARSER_STATE_BODY_DONE);
+		}
+		state = php_http_message_parser_parse(parser, buffer, flags, message);
+	}
+
+	return state;
+}
+
+/* size of the slices a string is fed in by parse_all(), so that buffer cuts stay cheap */
+#define PHP_HTTP_MESSAGE_PARSER_SLICE 0x4000
+
+typedef struct php_http_message_parser_batch {
+	php_http_message_t **list;
+	size_t count;
+	size_t size;
+} php_http_message_parser_batch_t;
+
+static ZEND_RESULT_CODE php_http_message_parser_batch_add(void *arg, php_http_message_t **message)
+{
+	php_http_message_parser_batch_t *batch = arg;
+
+	if (batch->count == batch->size) {
+		batch->size = batch->size ? batch->size << 1 : 16;
+		batch->list = erealloc(batch->list, batch->size * sizeof(*batch->list));
+	}
+	batch->list[batch->count++] = *message;
+	*message = NULL;
+
+	return SUCCESS;
+}
+
+ZEND_RESULT_CODE php_http_message_parser_parse_all(const char *str, size_t len, php_stream *s, unsigned flags, php_http_message_t ***list, size_t *count TSRMLS_DC)
+{
+	php_http_message_parser_t parser;
+	php_http_message_parser_batch_t batch = {NULL, 0, 0};
+	php_http_message_parser_state_t state;
+	php_http_message_t *message = NULL;
+	php_http_buffer_t buffer;
+
+	php_http_message_parser_init(&parser TSRMLS_CC);
+	php_http_buffer_init(&buffer);
+
+	/* every completed message is taken off the parser, so there's no parent chain to reverse */
+	parser.callback.message = php_http_message_parser_batch_add;
+	parser.callback.arg = &batch;
+	flags |= PHP_HTTP_MESSAGE_PARSER_GREEDY;
+
+	if (s) {
+		state = php_http_message_parser_parse_stream(&parser, &buffer, s, flags, &message);
+	} else {
+		do {
+			size_t slice = MIN(len, PHP_HTTP_MESSAGE_PARSER_SLICE);
+
+			state = php_http_message_parser_feed(&parser, &buffer, str, slice, flags | (slice == len ? PHP_HTTP_MESSAGE_PARSER_CLEANUP : 0), &message);
+			str += slice;
+			len -= slice;
+		} while (len && state != PHP_HTTP_MESSAGE_PARSER_STATE_FAILURE);
+	}
+
+	/* a trailing incomplete message is returned as far as it has been parsed */
+	if (message) {
+		php_http_message_parser_batch_add(&batch, &message);
+	}
+
+	php_http_message_parser_dtor(&parser);
+	php_http_buffer_dtor(&buffer);
+
+	if (state == PHP_HTTP_MESSAGE_PARSER_STATE_FAILURE) {
+		while (batch.count) {
+			php_http_message_free(&batch.list[--batch.count]);
+		}
+		PTR_FREE(batch.list);
+		*list = NULL;
+		*count = 0;
+		return FAILURE;
+	}
+
+	*list = batch.list;
+	*count = batch.count;
+	return SUCCESS;
+}
+
 php_http_message_parser_state_t php_http_message_parser_parse_stream(php_http_message_parser_t *parser, php_http_buffer_t *buf, php_stream *s, unsigned flags, php_http_message_t **message)
 {
 	php_http_message_parser_state_t state = PHP_HTTP_MESSAGE_PARSER_STATE_START;
@@ -270,7 +445,13 @@ php_http_message_parser_state_t php_http_message_parser_parse(php_http_message_p
 
 			case PHP_HTTP_MESSAGE_PARSER_STATE_HEADER_DONE:
 			{
-				zval *h, *h_loc = NULL, *h_con = NULL, **h_cl = NULL, **h_cr = NULL, **h_te = NULL;
+				zval *h, *h_loc = NULL, *h_con = NULL, **h_cr = NULL;
+				unsigned te = 0;
+				long cl = 0;
+				zend_bool has_cl = 0;
+
+				/* a new body starts */
+				parser->_body = 0;
 
 				/* Content-Range has higher precedence than Content-Length,
 				 * and content-length denotes the original length of the entity,
@@ -278,7 +459,8 @@ php_http_message_parser_state_t php_http_message_parser_parse(php_http_message_p
 				 * change the meaning of the whole message
 				 */
 				if ((h = php_http_message_header(*message, ZEND_STRL("Transfer-Encoding"), 1))) {
-					zend_hash_update(&(*message)->hdrs, "X-Original-Transfer-Encoding", sizeof("X-Original-Transfer-Encoding"), (void *) &h, sizeof(zval *), (void *) &h_te);
+					te = php_http_message_transfer_encoding(*message);
+					zend_hash_update(&(*message)->hdrs, "X-Original-Transfer-Encoding", sizeof("X-Original-Transfer-Encoding"), (void *) &h, sizeof(zval *), NULL);
 					zend_hash_del(&(*message)->hdrs, "Transfer-Encoding", sizeof("Transfer-Encoding"));
 
 					/* reset */
@@ -286,7 +468,8 @@ php_http_message_parser_state_t php_http_message_parser_parse(php_http_message_p
 					ZVAL_LONG(h, 0);
 					zend_hash_update(&(*message)->hdrs, "Content-Length", sizeof("Content-Length"), (void *) &h, sizeof(zval *), NULL);
 				} else if ((h = php_http_message_header(*message, ZEND_STRL("Content-Length"), 1))) {
-					zend_hash_update(&(*message)->hdrs, "X-Original-Content-Length", sizeof("X-Original-Content-Length"), (void *) &h, sizeof(zval *), (void *) &h_cl);
+					has_cl = php_http_message_content_length(*message, &cl);
+					zend_hash_update(&(*message)->hdrs, "X-Original-Content-Length", sizeof("X-Original-Content-Length"), (void *) &h, sizeof(zval *), NULL);
 				}
 
 				if ((h = php_http_message_header(*message, ZEND_STRL("Content-Range"), 1))) {
@@ -308,9 +491,12 @@ php_http_message_parser_state_t php_http_message_parser_parse(php_http_message_p
 				&&	(h_con = php_http_message_header(*message, ZEND_STRL("Connection"), 1))
 				) {
 					if (php_http_match(Z_STRVAL_P(h_con), "close", PHP_HTTP_MATCH_WORD)) {
-						php_http_message_parser_state_push(parser, 1, PHP_HTTP_MESSAGE_PARSER_STATE_DONE);
 						zval_ptr_dtor(&h_loc);
 						zval_ptr_dtor(&h_con);
+						if (SUCCESS != php_http_message_parser_headers(parser, *message)) {
+							return php_http_message_parser_state_push(parser, 1, PHP_HTTP_MESSAGE_PARSER_STATE_FAILURE);
+						}
+						php_http_message_parser_state_push(parser, 1, PHP_HTTP_MESSAGE_PARSER_STATE_DONE);
 						break;
 					}
 				}
@@ -321,15 +507,18 @@ php_http_message_parser_state_t php_http_message_parser_parse(php_http_message_p
 					zval_ptr_dtor(&h_con);
 				}
 
-				if ((h = php_http_message_header(*message, ZEND_STRL("Content-Encoding"), 1))) {
-					if (php_http_match(Z_STRVAL_P(h), "gzip", PHP_HTTP_MATCH_WORD)
-					||	php_http_match(Z_STRVAL_P(h), "x-gzip", PHP_HTTP_MATCH_WORD)
-					||	php_http_match(Z_STRVAL_P(h), "deflate", PHP_HTTP_MATCH_WORD)
-					) {
-						if (parser->inflate) {
+				/* identity or no Content-Encoding at all needs no codec lookup */
+				if (php_http_message_content_encoding(*message) && (h = php_http_message_header(*message, ZEND_STRL("Content-Encoding"), 1))) {
+					php_http_encoding_codec_t codec;
+
+					if (SUCCESS == php_http_encoding_codec_match(Z_STRVAL_P(h), &codec)) {
+						if (parser->inflate && parser->inflate->ops == codec.decoder) {
 							php_http_encoding_stream_reset(&parser->inflate);
 						} else {
-							parser->inflate = php_http_encoding_stream_init(NULL, php_http_encoding_stream_get_inflate_ops(), 0 TSRMLS_CC);
+							if (parser->inflate) {
+								php_http_encoding_stream_free(&parser->inflate);
+							}
+							parser->inflate = php_http_encoding_stream_init(NULL, codec.decoder, codec.decoder_flags TSRMLS_CC);
 						}
 						zend_hash_update(&(*message)->hdrs, "X-Original-Content-Encoding", sizeof("X-Original-Content-Encoding"), &h, sizeof(zval *), NULL);
 						zend_hash_del(&(*message)->hdrs, "Content-Encoding", sizeof("Content-Encoding"));
@@ -338,15 +527,17 @@ php_http_message_parser_state_t php_http_message_parser_parse(php_http_message_p
 					}
 				}
 
+				if (SUCCESS != php_http_message_parser_headers(parser, *message)) {
+					return php_http_message_parser_state_push(parser, 1, PHP_HTTP_MESSAGE_PARSER_STATE_FAILURE);
+				}
+
 				if ((flags & PHP_HTTP_MESSAGE_PARSER_DUMB_BODIES)) {
 					php_http_message_parser_state_push(parser, 1, PHP_HTTP_MESSAGE_PARSER_STATE_BODY_DUMB);
 				} else {
-					if (h_te) {
-						if (strstr(Z_STRVAL_PP(h_te), "chunked")) {
-							parser->dechunk = php_http_encoding_stream_init(parser->dechunk, php_http_encoding_stream_get_dechunk_ops(), 0 TSRMLS_CC);
-							php_http_message_parser_state_push(parser, 1, PHP_HTTP_MESSAGE_PARSER_STATE_BODY_CHUNKED);
-							break;
-						}
+					if (te & PHP_HTTP_MESSAGE_ENCODING_CHUNKED) {
+						parser->dechunk = php_http_encoding_stream_init(parser->dechunk, php_http_encoding_stream_get_dechunk_ops(), 0 TSRMLS_CC);
+						php_http_message_parser_state_push(parser, 1, PHP_HTTP_MESSAGE_PARSER_STATE_BODY_CHUNKED);
+						break;
 					}
 
 					if (h_cr) {
@@ -377,21 +568,10 @@ php_http_message_parser_state_t php_http_message_parser_parse(php_http_message_p
 						}
 					}
 
-					if (h_cl) {
-						char *stop;
-
-						if (Z_TYPE_PP(h_cl) == IS_STRING) {
-							parser->body_length = strtoul(Z_STRVAL_PP(h_cl), &stop, 10);
-
-							if (stop != Z_STRVAL_PP(h_cl)) {
-								php_http_message_parser_state_push(parser, 1, !parser->body_length?PHP_HTTP_MESSAGE_PARSER_STATE_BODY_DONE:PHP_HTTP_MESSAGE_PARSER_STATE_BODY_LENGTH);
-								break;
-							}
-						} else if (Z_TYPE_PP(h_cl) == IS_LONG) {
-							parser->body_length = Z_LVAL_PP(h_cl);
-							php_http_message_parser_state_push(parser, 1, !parser->body_length?PHP_HTTP_MESSAGE_PARSER_STATE_BODY_DONE:PHP_HTTP_MESSAGE_PARSER_STATE_BODY_LENGTH);
-							break;
-						}
+					if (has_cl) {
+						parser->body_length = cl;
+						php_http_message_parser_state_push(parser, 1, !parser->body_length?PHP_HTTP_MESSAGE_PARSER_STATE_BODY_DONE:PHP_HTTP_MESSAGE_PARSER_STATE_BODY_LENGTH);
+						break;
 					}
 
 					if ((*message)->type == PHP_HTTP_REQUEST) {
@@ -405,25 +585,11 @@ php_http_message_parser_state_t php_http_message_parser_parse(php_http_message_p
 
 			case PHP_HTTP_MESSAGE_PARSER_STATE_BODY:
 			{
-				if (len) {
-					/* FIXME: what if we re-use the parser? */
-					if (parser->inflate) {
-						char *dec_str = NULL;
-						size_t dec_len;
-
-						if (SUCCESS != php_http_encoding_stream_update(parser->inflate, str, len, &dec_str, &dec_len)) {
-							return php_http_message_parser_state_push(parser, 1, PHP_HTTP_MESSAGE_PARSER_STATE_FAILURE);
-						}
-
-						if (str != buffer->data) {
-							PTR_FREE(str);
-						}
-						str = dec_str;
-						len = dec_len;
+				if (len && SUCCESS != php_http_message_parser_body(parser, *message, str, len)) {
+					if (str != buffer->data) {
+						PTR_FREE(str);
 					}
-
-					php_stream_write(php_http_message_body_stream((*message)->body), str, len);
-
+					return php_http_message_parser_state_push(parser, 1, PHP_HTTP_MESSAGE_PARSER_STATE_FAILURE);
 				}
 
 				if (cut) {
@@ -452,6 +618,12 @@ php_http_message_parser_state_t php_http_message_parser_parse(php_http_message_p
 
 			case PHP_HTTP_MESSAGE_PARSER_STATE_BODY_LENGTH:
 			{
+				/* reject an announced length beyond the limit before reading any of it */
+				if (parser->limit.body && parser->_body + parser->body_length > parser->limit.body) {
+					php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to parse message: body of %zu bytes exceeds the limit of %zu bytes", parser->_body + parser->body_length, parser->limit.body);
+					return php_http_message_parser_state_push(parser, 1, PHP_HTTP_MESSAGE_PARSER_STATE_FAILURE);
+				}
+
 				len = MIN(parser->body_length, buffer->used);
 				str = buffer->data;
 				cut = len;
@@ -519,6 +691,11 @@ php_http_message_parser_state_t php_http_message_parser_parse(php_http_message_p
 			case PHP_HTTP_MESSAGE_PARSER_STATE_UPDATE_CL:
 			{
 				zval *zcl;
+
+				if (parser->callback.body) {
+					/* the body has been passed on */
+					break;
+				}
 				MAKE_STD_ZVAL(zcl);
 				ZVAL_LONG(zcl, php_http_message_body_size((*message)->body));
 				zend_hash_update(&(*message)->hdrs, "Content-Length", sizeof("Content-Length"), &zcl, sizeof(zval *), NULL);
@@ -534,6 +711,10 @@ php_http_message_parser_state_t php_http_message_parser_parse(php_http_message_p
 				}
 
 				php_http_buffer_cut(buffer, 0, ptr - buffer->data);
+
+				if (parser->callback.message && SUCCESS != parser->callback.message(parser->callback.arg, message)) {
+					return php_http_message_parser_state_push(parser, 1, PHP_HTTP_MESSAGE_PARSER_STATE_FAILURE);
+				}
 				
 				if (!(flags & PHP_HTTP_MESSAGE_PARSER_GREEDY)) {
 					return PHP_HTTP_MESSAGE_PARSER_STATE_DONE;
@@ -579,10 +760,122 @@ zend_object_value php_http_message_parser_object_new_ex(zend_class_entry *ce, ph
 	return o->zv;
 }
 
+static void php_http_message_parser_fcall_dtor(php_http_message_parser_fcall_t *cb)
+{
+	if (cb->fci.size) {
+		zval_ptr_dtor(&cb->fci.function_name);
+		if (cb->fci.object_ptr) {
+			zval_ptr_dtor(&cb->fci.object_ptr);
+		}
+		zend_fcall_info_args_clear(&cb->fci, 1);
+		cb->fci = empty_fcall_info;
+		cb->fcc = empty_fcall_info_cache;
+	}
+}
+
+static void php_http_message_parser_fcall_set(php_http_message_parser_fcall_t *cb, zend_fcall_info *fci, zend_fcall_info_cache *fcc)
+{
+	php_http_message_parser_fcall_dtor(cb);
+	if (fci->size) {
+		Z_ADDREF_P(fci->function_name);
+		if (fci->object_ptr) {
+			Z_ADDREF_P(fci->object_ptr);
+		}
+		cb->fci = *fci;
+		cb->fcc = *fcc;
+	}
+}
+
+static ZEND_RESULT_CODE php_http_message_parser_fcall_call(php_http_message_parser_fcall_t *cb, zval *zarg TSRMLS_DC)
+{
+	ZEND_RESULT_CODE rv;
+	zval *retval = NULL;
+
+	zend_fcall_info_argn(&cb->fci TSRMLS_CC, 1, &zarg);
+	rv = zend_fcall_info_call(&cb->fci, &cb->fcc, &retval, NULL TSRMLS_CC);
+	zend_fcall_info_args_clear(&cb->fci, 0);
+	zval_ptr_dtor(&zarg);
+
+	if (retval) {
+		/* returning false aborts parsing */
+		if (Z_TYPE_P(retval) == IS_BOOL && !Z_BVAL_P(retval)) {
+			rv = FAILURE;
+		}
+		zval_ptr_dtor(&retval);
+	}
+	if (EG(exception)) {
+		rv = FAILURE;
+	}
+	return rv;
+}
+
+static ZEND_RESULT_CODE php_http_message_parser_object_headers(void *arg, php_http_message_t *message)
+{
+	php_http_message_parser_object_t *o = arg;
+	php_http_message_t *copy;
+	php_http_info_t info;
+	zval *zmsg;
+	TSRMLS_FETCH_FROM_CTX(o->parser->ts);
+
+	/* the message is still being parsed, so hand out its info and headers, but not its body */
+	info.type = message->type;
+	info.http = message->http;
+	copy = php_http_message_init(NULL, 0, NULL TSRMLS_CC);
+	php_http_message_set_info(copy, &info);
+	zend_hash_copy(&copy->hdrs, &message->hdrs, (copy_ctor_func_t) zval_add_ref, NULL, sizeof(zval *));
+
+	MAKE_STD_ZVAL(zmsg);
+	ZVAL_OBJVAL(zmsg, php_http_message_object_new_ex(php_http_message_class_entry, copy, NULL TSRMLS_CC), 0);
+	return php_http_message_parser_fcall_call(&o->callback.headers, zmsg TSRMLS_CC);
+}
+
+static ZEND_RESULT_CODE php_http_message_parser_object_body(void *arg, php_http_message_t *message, const char *str, size_t len)
+{
+	php_http_message_parser_object_t *o = arg;
+	zval *zdata;
+	TSRMLS_FETCH_FROM_CTX(o->parser->ts);
+
+	if (o->sink) {
+		php_stream *s = NULL;
+
+		php_stream_from_zval_no_verify(s, &o->sink);
+		if (!s || len != php_stream_write(s, str, len)) {
+			php_error_docref(NULL TSRMLS_CC, E_WARNING, "Failed to write %zu bytes of message body to sink", len);
+			return FAILURE;
+		}
+	}
+	if (!o->callback.body.fci.size) {
+		return SUCCESS;
+	}
+
+	MAKE_STD_ZVAL(zdata);
+	ZVAL_STRINGL(zdata, str, len, 1);
+	return php_http_message_parser_fcall_call(&o->callback.body, zdata TSRMLS_CC);
+}
+
+static ZEND_RESULT_CODE php_http_message_parser_object_message(void *arg, php_http_message_t **message)
+{
+	php_http_message_parser_object_t *o = arg;
+	zval *zmsg;
+	TSRMLS_FETCH_FROM_CTX(o->parser->ts);
+
+	/* hand the message over, so that the parser starts afresh */
+	MAKE_STD_ZVAL(zmsg);
+	ZVAL_OBJVAL(zmsg, php_http_message_object_new_ex(php_http_message_class_entry, *message, NULL TSRMLS_CC), 0);
+	*message = NULL;
+	return php_http_message_parser_fcall_call(&o->callback.message, zmsg TSRMLS_CC);
+}
+
 void php_http_message_parser_object_free(void *object TSRMLS_DC)
 {
 	php_http_message_parser_object_t *o = (php_http_message_parser_object_t *) object;
 
+	php_http_message_parser_fcall_dtor(&o->callback.headers);
+	php_http_message_parser_fcall_dtor(&o->callback.body);
+	php_http_message_parser_fcall_dtor(&o->callback.message);
+	if (o->sink) {
+		zval_ptr_dtor(&o->sink);
+	}
 	if (o->parser) {
 		php_http_message_parser_free(&o->parser);
 	}
@@ -657,10 +950,139 @@ static PHP_METHOD(HttpMessageParser, stream)
 	}
 }
 
+ZEND_BEGIN_ARG_INFO_EX(ai_HttpMessageParser_setCallbacks, 0, 0, 0)
+	ZEND_ARG_INFO(0, headers)
+	ZEND_ARG_INFO(0, body)
+	ZEND_ARG_INFO(0, message)
+ZEND_END_ARG_INFO();
+static PHP_METHOD(HttpMessageParser, setCallbacks)
+{
+	php_http_message_parser_object_t *parser_obj;
+	zend_fcall_info fci[3] = {empty_fcall_info, empty_fcall_info, empty_fcall_info};
+	zend_fcall_info_cache fcc[3] = {empty_fcall_info_cache, empty_fcall_info_cache, empty_fcall_info_cache};
+
+	php_http_expect(SUCCESS == zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "|f!f!f!", &fci[0], &fcc[0], &fci[1], &fcc[1], &fci[2], &fcc[2]), invalid_arg, return);
+
+	parser_obj = zend_object_store_get_object(getThis() TSRMLS_CC);
+
+	php_http_message_parser_fcall_set(&parser_obj->callback.headers, &fci[0], &fcc[0]);
+	php_http_message_parser_fcall_set(&parser_obj->callback.body, &fci[1], &fcc[1]);
+	php_http_message_parser_fcall_set(&parser_obj->callback.message, &fci[2], &fcc[2]);
+
+	parser_obj->parser->callback.headers = fci[0].size ? php_http_message_parser_object_headers : NULL;
+	parser_obj->parser->callback.body = (fci[1].size || parser_obj->sink) ? php_http_message_parser_object_body : NULL;
+	parser_obj->parser->callback.message = fci[2].size ? php_http_message_parser_object_message : NULL;
+	parser_obj->parser->callback.arg = parser_obj;
+
+	RETVAL_ZVAL(getThis(), 1, 0);
+}
+
+ZEND_BEGIN_ARG_INFO_EX(ai_HttpMessageParser_setBodySink, 0, 0, 0)
+	ZEND_ARG_INFO(0, stream)
+ZEND_END_ARG_INFO();
+static PHP_METHOD(HttpMessageParser, setBodySink)
+{
+	php_http_message_parser_object_t *parser_obj;
+	zval *zstream = NULL;
+
+	php_http_expect(SUCCESS == zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "|r!", &zstream), invalid_arg, return);
+
+	parser_obj = zend_object_store_get_object(getThis() TSRMLS_CC);
+
+	if (zstream) {
+		zend_error_handling zeh;
+		php_stream *s;
+
+		zend_replace_error_handling(EH_THROW, php_http_exception_unexpected_val_class_entry, &zeh TSRMLS_CC);
+		php_stream_from_zval(s, &zstream);
+		zend_restore_error_handling(&zeh TSRMLS_CC);
+
+		Z_ADDREF_P(zstream);
+	}
+	if (parser_obj->sink) {
+		zval_ptr_dtor(&parser_obj->sink);
+	}
+	parser_obj->sink = zstream;
+
+	/* body data is written to the sink as it is decoded, instead of into the message body */
+	parser_obj->parser->callback.body = (zstream || parser_obj->callback.body.fci.size) ? php_http_message_parser_object_body : NULL;
+	parser_obj->parser->callback.arg = parser_obj;
+
+	RETVAL_ZVAL(getThis(), 1, 0);
+}
+
+ZEND_BEGIN_ARG_INFO_EX(ai_HttpMessageParser_feed, 0, 0, 1)
+	ZEND_ARG_INFO(0, data)
+	ZEND_ARG_INFO(0, flags)
+ZEND_END_ARG_INFO();
+static PHP_METHOD(HttpMessageParser, feed)
+{
+	php_http_message_parser_object_t *parser_obj;
+	char *data_str;
+	int data_len;
+	long flags = 0;
+
+	php_http_expect(SUCCESS == zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "s|l", &data_str, &data_len, &flags), invalid_arg, return);
+
+	parser_obj = zend_object_store_get_object(getThis() TSRMLS_CC);
+	RETVAL_LONG(php_http_message_parser_feed(parser_obj->parser, parser_obj->buffer, data_str, data_len, flags, &parser_obj->parser->message));
+}
+
+ZEND_BEGIN_ARG_INFO_EX(ai_HttpMessageParser_parseAll, 0, 0, 1)
+	ZEND_ARG_INFO(0, data)
+	ZEND_ARG_INFO(0, flags)
+ZEND_END_ARG_INFO();
+static PHP_METHOD(HttpMessageParser, parseAll)
+{
+	zval *zdata;
+	long flags = 0;
+	php_stream *s = NULL;
+	php_http_message_t **list;
+	size_t i, count;
+	ZEND_RESULT_CODE rv;
+
+	php_http_expect(SUCCESS == zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "z|l", &zdata, &flags), invalid_arg, return);
+
+	if (Z_TYPE_P(zdata) == IS_RESOURCE) {
+		zend_error_handling zeh;
+
+		zend_replace_error_handling(EH_THROW, php_http_exception_unexpected_val_class_entry, &zeh TSRMLS_CC);
+		php_stream_from_zval(s, &zdata);
+		zend_restore_error_handling(&zeh TSRMLS_CC);
+
+		rv = php_http_message_parser_parse_all(NULL, 0, s, flags, &list, &count TSRMLS_CC);
+	} else {
+		zdata = php_http_ztyp(IS_STRING, zdata);
+		rv = php_http_message_parser_parse_all(Z_STRVAL_P(zdata), Z_STRLEN_P(zdata), NULL, flags, &list, &count TSRMLS_CC);
+		zval_ptr_dtor(&zdata);
+	}
+
+	if (SUCCESS != rv) {
+		if (!EG(exception)) {
+			php_http_throw(bad_message, "Could not parse messages", NULL);
+		}
+		return;
+	}
+
+	array_init_size(return_value, count);
+	for (i = 0; i < count; ++i) {
+		zval *zmsg;
+
+		MAKE_STD_ZVAL(zmsg);
+		ZVAL_OBJVAL(zmsg, php_http_message_object_new_ex(php_http_message_class_entry, list[i], NULL TSRMLS_CC), 0);
+		add_next_index_zval(return_value, zmsg);
+	}
+	PTR_FREE(list);
+}
+
 static zend_function_entry php_http_message_parser_methods[] = {
 		PHP_ME(HttpMessageParser, getState, ai_HttpMessageParser_getState, ZEND_ACC_PUBLIC)
 		PHP_ME(HttpMessageParser, parse, ai_HttpMessageParser_parse, ZEND_ACC_PUBLIC)
 		PHP_ME(HttpMessageParser, stream, ai_HttpMessageParser_stream, ZEND_ACC_PUBLIC)
+		PHP_ME(HttpMessageParser, setCallbacks, ai_HttpMessageParser_setCallbacks, ZEND_ACC_PUBLIC)
+		PHP_ME(HttpMessageParser, setBodySink, ai_HttpMessageParser_setBodySink, ZEND_ACC_PUBLIC)
+		PHP_ME(HttpMessageParser, feed, ai_HttpMessageParser_feed, ZEND_ACC_PUBLIC)
+		PHP_ME(HttpMessageParser, parseAll, ai_HttpMessageParser_parseAll, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
 		{NULL, NULL, NULL}
 };
 
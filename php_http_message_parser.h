@@ -36,13 +36,37 @@ typedef enum php_http_message_parser_state {
 #define PHP_HTTP_MESSAGE_PARSER_EMPTY_REDIRECTS	0x4
 #define PHP_HTTP_MESSAGE_PARSER_GREEDY			0x8
 
+struct php_http_message_parser_globals {
+	long header_bytes;
+	long header_count;
+	long body_size;
+};
+
+/* return FAILURE to abort parsing */
+typedef ZEND_RESULT_CODE (*php_http_message_parser_headers_callback_t)(void *arg, php_http_message_t *message);
+typedef ZEND_RESULT_CODE (*php_http_message_parser_body_callback_t)(void *arg, php_http_message_t *message, const char *str, size_t len);
+/* may take over the message by setting *message to NULL */
+typedef ZEND_RESULT_CODE (*php_http_message_parser_message_callback_t)(void *arg, php_http_message_t **message);
+
 typedef struct php_http_message_parser {
 	php_http_header_parser_t header;
 	zend_ptr_stack stack;
 	size_t body_length;
+	/* 0 means unlimited; initialized from http.parser.body_size */
+	struct {
+		size_t body;
+	} limit;
+	size_t _body;
 	php_http_message_t *message;
 	php_http_encoding_stream_t *dechunk;
-	php_http_encoding_stream_t *inflate;
+	php_http_encoding_stream_t *inflate; /* decoder of the Content-Encoding */
+	php_http_buffer_t inflated; /* scratch space for inflate */
+	struct {
+		php_http_message_parser_headers_callback_t headers;
+		php_http_message_parser_body_callback_t body; /* replaces writing to the message body */
+		php_http_message_parser_message_callback_t message;
+		void *arg;
+	} callback;
 #ifdef ZTS
 	void ***ts;
 #endif
@@ -55,13 +79,26 @@ PHP_HTTP_API php_http_message_parser_state_t php_http_message_parser_state_pop(p
 PHP_HTTP_API void php_http_message_parser_dtor(php_http_message_parser_t *parser);
 PHP_HTTP_API void php_http_message_parser_free(php_http_message_parser_t **parser);
 PHP_HTTP_API php_http_message_parser_state_t php_http_message_parser_parse(php_http_message_parser_t *parser, php_http_buffer_t *buffer, unsigned flags, php_http_message_t **message);
+PHP_HTTP_API php_http_message_parser_state_t php_http_message_parser_feed(php_http_message_parser_t *parser, php_http_buffer_t *buffer, const char *data_str, size_t data_len, unsigned flags, php_http_message_t **message);
+PHP_HTTP_API ZEND_RESULT_CODE php_http_message_parser_parse_all(const char *str, size_t len, php_stream *s, unsigned flags, php_http_message_t ***list, size_t *count TSRMLS_DC);
 PHP_HTTP_API php_http_message_parser_state_t php_http_message_parser_parse_stream(php_http_message_parser_t *parser, php_http_buffer_t *buffer, php_stream *s, unsigned flags, php_http_message_t **message);
 
+typedef struct php_http_message_parser_fcall {
+	zend_fcall_info fci;
+	zend_fcall_info_cache fcc;
+} php_http_message_parser_fcall_t;
+
 typedef struct php_http_message_parser_object {
 	zend_object zo;
 	zend_object_value zv;
 	php_http_buffer_t *buffer;
 	php_http_message_parser_t *parser;
+	struct {
+		php_http_message_parser_fcall_t headers;
+		php_http_message_parser_fcall_t body;
+		php_http_message_parser_fcall_t message;
+	} callback;
+	zval *sink;
 } php_http_message_parser_object_t;
 
 PHP_HTTP_API zend_class_entry *php_http_message_parser_class_entry;
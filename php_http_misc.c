@@ -15,6 +15,19 @@
 #include <ext/standard/php_lcg.h>
 #include <zend_exceptions.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define PHP_HTTP_HAVE_SSE2 1
+#	include <emmintrin.h>
+#	ifdef _MSC_VER
+#		include <intrin.h>
+#	endif
+#else
+#	define PHP_HTTP_HAVE_SSE2 0
+#endif
+#if PHP_HTTP_HAVE_AVX2
+#	include <immintrin.h>
+#endif
+
 /* SLEEP */
 
 void php_http_sleep(double s)
@@ -141,6 +154,51 @@ int php_http_select_str(const char *cmp, int argc, ...)
 	return match;
 }
 
+php_http_bmh_t *php_http_bmh_init(php_http_bmh_t *bmh, const char *needle, size_t len)
+{
+	size_t i;
+
+	if (!bmh) {
+		bmh = emalloc(sizeof(*bmh));
+	}
+	bmh->needle = (const unsigned char *) needle;
+	bmh->len = len;
+
+	for (i = 0; i < 256; ++i) {
+		bmh->skip[i] = len;
+	}
+	/* distance of each byte's last occurrence to the end, the final byte excluded */
+	for (i = 0; i + 1 < len; ++i) {
+		bmh->skip[bmh->needle[i]] = len - 1 - i;
+	}
+
+	return bmh;
+}
+
+const char *php_http_bmh_locate(const php_http_bmh_t *bmh, const char *h, size_t h_len)
+{
+	const unsigned char *hay = (const unsigned char *) h, *end;
+	size_t last;
+
+	if (!bmh->len || h_len < bmh->len) {
+		return NULL;
+	}
+
+	last = bmh->len - 1;
+	end = hay + h_len - last;
+
+	while (hay < end) {
+		unsigned char c = hay[last];
+
+		if (c == bmh->needle[last] && !memcmp(hay, bmh->needle, last)) {
+			return (const char *) hay;
+		}
+		hay += bmh->skip[c];
+	}
+
+	return NULL;
+}
+
 
 /* ARRAYS */
 
@@ -271,6 +329,203 @@ size_t php_http_pass_fcall_callback(void *cb_arg, const char *str, size_t len)
 }
 
 
+/* SCANNERS */
+
+/* lookup table of PHP_HTTP_HEADER_NAME_CHARS, filled by php_http_scan_init() */
+static char php_http_token_chars[256];
+
+static const char *php_http_scan_eol_scalar(const char *str, size_t len)
+{
+	register const char *eol = str;
+
+	if (len > 0) {
+		PHP_HTTP_DUFF(len,
+			if (*eol == '\r' || *eol == '\n') {
+				return eol;
+			}
+			++eol;
+		);
+	}
+	return NULL;
+}
+
+static size_t php_http_scan_token_scalar(const char *str, size_t len)
+{
+	const unsigned char *ptr = (const unsigned char *) str, *end = ptr + len;
+
+	while (ptr < end && php_http_token_chars[*ptr]) {
+		++ptr;
+	}
+	return ptr - (const unsigned char *) str;
+}
+
+#if PHP_HTTP_HAVE_SSE2 || PHP_HTTP_HAVE_AVX2
+static inline unsigned php_http_ctz(unsigned mask)
+{
+#	ifdef _MSC_VER
+	unsigned long index;
+
+	_BitScanForward(&index, mask);
+	return index;
+#	else
+	return __builtin_ctz(mask);
+#	endif
+}
+#endif
+
+#if PHP_HTTP_HAVE_SSE2
+/* the token characters as ranges; bytes >= 0x80 are negative and fail every range */
+#	define PHP_HTTP_SSE2_IN(v, lo, hi) \
+	_mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8((lo) - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8((hi) + 1)))
+
+static inline __m128i php_http_sse2_token(__m128i v)
+{
+	__m128i ok = _mm_cmpeq_epi8(v, _mm_set1_epi8('!'));
+
+	ok = _mm_or_si128(ok, PHP_HTTP_SSE2_IN(v, '#', '\''));
+	ok = _mm_or_si128(ok, PHP_HTTP_SSE2_IN(v, '*', '+'));
+	ok = _mm_or_si128(ok, PHP_HTTP_SSE2_IN(v, '-', '.'));
+	ok = _mm_or_si128(ok, PHP_HTTP_SSE2_IN(v, '0', '9'));
+	ok = _mm_or_si128(ok, PHP_HTTP_SSE2_IN(v, 'A', 'Z'));
+	ok = _mm_or_si128(ok, PHP_HTTP_SSE2_IN(v, '^', 'z'));
+	ok = _mm_or_si128(ok, _mm_cmpeq_epi8(v, _mm_set1_epi8('|')));
+	ok = _mm_or_si128(ok, _mm_cmpeq_epi8(v, _mm_set1_epi8('~')));
+
+	return ok;
+}
+
+static const char *php_http_scan_eol_sse2(const char *str, size_t len)
+{
+	const __m128i cr = _mm_set1_epi8('\r'), lf = _mm_set1_epi8('\n');
+	const char *ptr = str, *end = str + len;
+
+	for (; end - ptr >= 16; ptr += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *) ptr);
+		unsigned mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf)));
+
+		if (mask) {
+			return ptr + php_http_ctz(mask);
+		}
+	}
+	return php_http_scan_eol_scalar(ptr, end - ptr);
+}
+
+static size_t php_http_scan_token_sse2(const char *str, size_t len)
+{
+	const char *ptr = str, *end = str + len;
+
+	for (; end - ptr >= 16; ptr += 16) {
+		unsigned mask = ~_mm_movemask_epi8(php_http_sse2_token(_mm_loadu_si128((const __m128i *) ptr))) & 0xffff;
+
+		if (mask) {
+			return ptr - str + php_http_ctz(mask);
+		}
+	}
+	return ptr - str + php_http_scan_token_scalar(ptr, end - ptr);
+}
+#endif
+
+#if PHP_HTTP_HAVE_AVX2
+#	define PHP_HTTP_AVX2_IN(v, lo, hi) \
+	_mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8((lo) - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8((hi) + 1), v))
+
+__attribute__((target("avx2")))
+static const char *php_http_scan_eol_avx2(const char *str, size_t len)
+{
+	const __m256i cr = _mm256_set1_epi8('\r'), lf = _mm256_set1_epi8('\n');
+	const char *ptr = str, *end = str + len;
+
+	for (; end - ptr >= 32; ptr += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *) ptr);
+		unsigned mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, lf)));
+
+		if (mask) {
+			return ptr + php_http_ctz(mask);
+		}
+	}
+	return php_http_scan_eol_scalar(ptr, end - ptr);
+}
+
+__attribute__((target("avx2")))
+static size_t php_http_scan_token_avx2(const char *str, size_t len)
+{
+	const char *ptr = str, *end = str + len;
+
+	for (; end - ptr >= 32; ptr += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *) ptr), ok;
+		unsigned mask;
+
+		ok = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('!'));
+		ok = _mm256_or_si256(ok, PHP_HTTP_AVX2_IN(v, '#', '\''));
+		ok = _mm256_or_si256(ok, PHP_HTTP_AVX2_IN(v, '*', '+'));
+		ok = _mm256_or_si256(ok, PHP_HTTP_AVX2_IN(v, '-', '.'));
+		ok = _mm256_or_si256(ok, PHP_HTTP_AVX2_IN(v, '0', '9'));
+		ok = _mm256_or_si256(ok, PHP_HTTP_AVX2_IN(v, 'A', 'Z'));
+		ok = _mm256_or_si256(ok, PHP_HTTP_AVX2_IN(v, '^', 'z'));
+		ok = _mm256_or_si256(ok, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('|')));
+		ok = _mm256_or_si256(ok, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('~')));
+
+		if ((mask = ~(unsigned) _mm256_movemask_epi8(ok))) {
+			return ptr - str + php_http_ctz(mask);
+		}
+	}
+	return ptr - str + php_http_scan_token_scalar(ptr, end - ptr);
+}
+#endif
+
+static struct {
+	const char *name;
+	const char *(*eol)(const char *str, size_t len);
+	size_t (*token)(const char *str, size_t len);
+} php_http_scan;
+
+/* called once from MINIT; picks the widest implementation the CPU supports, PHP_HTTP_SCAN=scalar|sse2 in the environment caps it */
+void php_http_scan_init(void)
+{
+	const char *force = getenv("PHP_HTTP_SCAN"), *name = "scalar", *chars;
+	const char *(*eol)(const char *, size_t) = php_http_scan_eol_scalar;
+	size_t (*token)(const char *, size_t) = php_http_scan_token_scalar;
+
+	for (chars = PHP_HTTP_HEADER_NAME_CHARS; *chars; ++chars) {
+		php_http_token_chars[(unsigned char) *chars] = 1;
+	}
+
+	if (!force || strcmp(force, "scalar")) {
+#if PHP_HTTP_HAVE_SSE2
+		eol = php_http_scan_eol_sse2;
+		token = php_http_scan_token_sse2;
+		name = "sse2";
+#endif
+#if PHP_HTTP_HAVE_AVX2
+		__builtin_cpu_init();
+		if ((!force || strcmp(force, "sse2")) && __builtin_cpu_supports("avx2")) {
+			eol = php_http_scan_eol_avx2;
+			token = php_http_scan_token_avx2;
+			name = "avx2";
+		}
+#endif
+	}
+
+	php_http_scan.eol = eol;
+	php_http_scan.token = token;
+	php_http_scan.name = name;
+}
+
+const char *php_http_scan_eol(const char *str, size_t len)
+{
+	return php_http_scan.eol(str, len);
+}
+
+size_t php_http_scan_token(const char *str, size_t len)
+{
+	return php_http_scan.token(str, len);
+}
+
+const char *php_http_scan_impl(void)
+{
+	return php_http_scan.name;
+}
+
 /* ZEND */
 
 /*
@@ -109,6 +109,16 @@ static inline const char *php_http_locate_str(register const char *h, size_t h_l
 	return NULL;
 }
 
+/* Boyer-Moore-Horspool search; the needle must outlive the table */
+typedef struct php_http_bmh {
+	const unsigned char *needle;
+	size_t len;
+	size_t skip[256];
+} php_http_bmh_t;
+
+PHP_HTTP_API php_http_bmh_t *php_http_bmh_init(php_http_bmh_t *bmh, const char *needle, size_t len);
+PHP_HTTP_API const char *php_http_bmh_locate(const php_http_bmh_t *bmh, const char *h, size_t h_len);
+
 static inline const char *php_http_locate_eol(const char *line, int *eol_len)
 {
 	const char *eol = strpbrk(line, "\r\n");
@@ -119,22 +129,20 @@ static inline const char *php_http_locate_eol(const char *line, int *eol_len)
 	return eol;
 }
 
+/* vectorized scanners, dispatched on the capabilities of the CPU */
+PHP_HTTP_API void php_http_scan_init(void);
+PHP_HTTP_API const char *php_http_scan_eol(const char *str, size_t len);
+PHP_HTTP_API size_t php_http_scan_token(const char *str, size_t len);
+PHP_HTTP_API const char *php_http_scan_impl(void);
+
 static inline const char *php_http_locate_bin_eol(const char *bin, size_t len, int *eol_len)
 {
-	register const char *eol = bin;
-
-	if (len > 0) {
-		PHP_HTTP_DUFF(len,
-			if (*eol == '\r' || *eol == '\n') {
-				if (eol_len) {
-					*eol_len = ((eol[0] == '\r' && eol[1] == '\n') ? 2 : 1);
-				}
-				return eol;
-			}
-			++eol;
-		);
+	const char *eol = php_http_scan_eol(bin, len);
+
+	if (eol && eol_len) {
+		*eol_len = ((eol[0] == '\r' && eol[1] == '\n') ? 2 : 1);
 	}
-	return NULL;
+	return eol;
 }
 
 /* ZEND */
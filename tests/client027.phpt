@@ -0,0 +1,46 @@
+--TEST--
+client once & wait with epoll
+--SKIPIF--
+<?php
+include "skipif.inc";
+skip_client_test();
+?>
+--FILE--
+<?php
+
+include "helper/server.inc";
+
+echo "Test\n";
+
+server("proxy.inc", function($port) {
+	foreach (array(true, false) as $use_epoll) {
+		$count = 0;
+		$client = new http\Client;
+		$client->configure(array("use_epoll" => $use_epoll));
+		for ($i = 0; $i < 3; ++$i) {
+			$client->enqueue(new http\Client\Request("GET", "http://localhost:$port/$i"), function($response) use(&$count) {
+				++$count;
+				var_dump($response->getResponseCode());
+			});
+		}
+
+		while ($client->once()) {
+			$client->wait(.1);
+		}
+
+		var_dump($count);
+	}
+});
+?>
+Done
+--EXPECT--
+Test
+int(200)
+int(200)
+int(200)
+int(3)
+int(200)
+int(200)
+int(200)
+int(3)
+Done
@@ -0,0 +1,46 @@
+--TEST--
+client debug callback
+--SKIPIF--
+<?php
+include "skipif.inc";
+skip_client_test();
+?>
+--FILE--
+<?php
+
+include "helper/server.inc";
+
+echo "Test\n";
+
+server("proxy.inc", function($port) {
+	$request = new http\Client\Request("GET", "http://localhost:$port/");
+
+	foreach (http\Client::getAvailableDrivers() as $driver) {
+		$types = array();
+		$client = new http\Client($driver);
+		$client->setDebug(function($c, $r, $type, $data) use($client, $request, &$types) {
+			if ($c !== $client || $r !== $request) {
+				var_dump($c, $r);
+			}
+			$types[$type] = true;
+		});
+		$client->enqueue($request)->send();
+
+		var_dump(isset($types[http\Client::DEBUG_OUT|http\Client::DEBUG_HEADER]));
+		var_dump(isset($types[http\Client::DEBUG_IN|http\Client::DEBUG_HEADER]));
+
+		$types = array();
+		$client->setDebug(null);
+		$client->requeue($request)->send();
+
+		var_dump(count($types));
+	}
+});
+?>
+Done
+--EXPECTREGEX--
+Test
+(?:bool\(true\)
+bool\(true\)
+int\(0\)
+)+Done
@@ -0,0 +1,49 @@
+--TEST--
+client response body memory limit
+--SKIPIF--
+<?php
+include "skipif.inc";
+skip_client_test();
+?>
+--FILE--
+<?php
+
+include "helper/server.inc";
+
+echo "Test\n";
+
+server("proxy.inc", function($port) {
+	$data = str_repeat("0123456789abcdef", 0x1000);
+	$bodies = array();
+
+	foreach (array(0, 1024, 0x200000) as $limit) {
+		$request = new http\Client\Request("POST", "http://localhost:$port/");
+		$request->getBody()->append($data);
+		$request->setOptions(array("body_memory_limit" => $limit));
+
+		$client = new http\Client;
+		$response = $client->enqueue($request)->send()->getResponse();
+		$body = $response->getBody();
+
+		var_dump(false !== strpos((string) $body, $data));
+		var_dump($body->stat("size") === strlen((string) $body));
+
+		$stream = $body->getResource();
+		rewind($stream);
+		$bodies[] = stream_get_contents($stream);
+	}
+
+	var_dump(count(array_unique($bodies)));
+});
+?>
+Done
+--EXPECT--
+Test
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+int(1)
+Done
@@ -0,0 +1,64 @@
+--TEST--
+client enqueueMany
+--SKIPIF--
+<?php
+include "skipif.inc";
+skip_client_test();
+?>
+--FILE--
+<?php
+
+include "helper/server.inc";
+
+echo "Test\n";
+
+server("proxy.inc", function($port) {
+	$count = 0;
+	$cb = function($response) use (&$count) {
+		++$count;
+	};
+
+	$client = new http\Client;
+	$client->setOptions(array("timeout" => 10));
+
+	$requests = array();
+	for ($i = 0; $i < 5; ++$i) {
+		$requests[] = new http\Client\Request("GET", "http://localhost:$port/$i");
+	}
+	$requests[] = (new http\Client\Request("GET", "http://localhost:$port/own"))->setOptions(array("timeout" => 5));
+
+	var_dump($client === $client->enqueueMany($requests, $cb));
+	var_dump(count($client));
+
+	$more = array();
+	for ($i = 0; $i < 3; ++$i) {
+		$more[] = new http\Client\Request("GET", "http://localhost:$port/more/$i");
+	}
+	$client->enqueueMany(new ArrayIterator($more), $cb);
+	var_dump(count($client));
+
+	$client->send();
+	var_dump($count);
+
+	try {
+		$client->enqueueMany(array(new http\Client\Request("GET", "http://localhost:$port/"), 1));
+	} catch (http\Exception\InvalidArgumentException $e) {
+		echo $e->getMessage(), "\n";
+	}
+	try {
+		$client->enqueueMany(array($requests[0]));
+	} catch (http\Exception\BadMethodCallException $e) {
+		echo $e->getMessage(), "\n";
+	}
+});
+?>
+Done
+--EXPECT--
+Test
+bool(true)
+int(6)
+int(9)
+int(9)
+Expected instances of http\Client\Request, got integer
+Failed to enqueue request; request already in queue
+Done
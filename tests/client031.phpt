@@ -0,0 +1,75 @@
+--TEST--
+client feed with concurrency limit
+--SKIPIF--
+<?php
+include "skipif.inc";
+skip_client_test();
+?>
+--FILE--
+<?php
+
+include "helper/server.inc";
+
+echo "Test\n";
+
+class Requests implements IteratorAggregate
+{
+	public $pulled = 0;
+	private $port, $count;
+
+	function __construct($port, $count) {
+		$this->port = $port;
+		$this->count = $count;
+	}
+
+	function getIterator() {
+		$requests = array();
+		for ($i = 0; $i < $this->count; ++$i) {
+			$requests[] = new http\Client\Request("GET", "http://localhost:{$this->port}/$i");
+		}
+		return new CallbackFilterIterator(new ArrayIterator($requests), function() {
+			++$this->pulled;
+			return true;
+		});
+	}
+}
+
+server("proxy.inc", function($port) {
+	$requests = new Requests($port, 20);
+	$client = new http\Client;
+	$done = 0;
+	$max = 0;
+
+	$client->feed($requests, 3, function($response) use ($client, &$done, &$max) {
+		++$done;
+		$max = max($max, count($client));
+	}, 2);
+
+	var_dump(count($client));
+	var_dump($requests->pulled <= 6);
+
+	$client->send();
+
+	var_dump($done);
+	var_dump($max <= 3);
+	var_dump(count($client));
+	var_dump($client->getResponse());
+
+	try {
+		$client->feed(array(), 0, function() {});
+	} catch (http\Exception\InvalidArgumentException $e) {
+		echo $e->getMessage(), "\n";
+	}
+});
+?>
+Done
+--EXPECT--
+Test
+int(2)
+bool(true)
+int(20)
+bool(true)
+int(0)
+NULL
+Concurrency must be greater than zero, got 0
+Done
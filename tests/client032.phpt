@@ -0,0 +1,54 @@
+--TEST--
+client progress throttling
+--SKIPIF--
+<?php
+include "skipif.inc";
+skip_client_test();
+?>
+--FILE--
+<?php
+
+include "helper/server.inc";
+
+echo "Test\n";
+
+class CountingObserver implements SplObserver
+{
+	public $count = 0;
+	public $finished = 0;
+
+	function update(SplSubject $client, http\Client\Request $request = null, StdClass $progress = null) {
+		++$this->count;
+		if ($progress->finished) {
+			++$this->finished;
+		}
+	}
+}
+
+server("proxy.inc", function($port) {
+	$counts = array();
+
+	foreach (array(array(), array("progress_interval" => 60, "progress_delta" => 1 << 30)) as $config) {
+		$request = new http\Client\Request("POST", "http://localhost:$port/");
+		$request->getBody()->append(str_repeat("x", 1 << 20));
+
+		$observer = new CountingObserver;
+		$client = new http\Client;
+		$client->configure($config);
+		$client->attach($observer);
+		$client->enqueue($request)->send();
+
+		var_dump($observer->finished);
+		$counts[] = $observer->count;
+	}
+
+	var_dump($counts[1] <= $counts[0]);
+});
+?>
+Done
+--EXPECT--
+Test
+int(1)
+int(1)
+bool(true)
+Done
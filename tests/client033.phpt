@@ -0,0 +1,50 @@
+--TEST--
+client pool stats
+--SKIPIF--
+<?php
+include "skipif.inc";
+skip_client_test();
+?>
+--FILE--
+<?php
+
+include "helper/server.inc";
+
+echo "Test\n";
+
+server("proxy.inc", function($port) {
+	$client = new http\Client("curl", "pool-stats");
+	$client->configure(array("pool_stats" => true));
+	var_dump($client->getPoolStats());
+
+	for ($i = 0; $i < 3; ++$i) {
+		$request = new http\Client\Request("GET", "http://localhost:$port/$i");
+		$client->enqueue($request)->send();
+		$client->dequeue($request);
+	}
+
+	$stats = $client->getPoolStats();
+	var_dump(array_keys($stats) === array("localhost:$port"));
+
+	$stats = current($stats);
+	var_dump($stats["requests"]);
+	var_dump($stats["handle_hits"] + $stats["handle_misses"]);
+	var_dump($stats["handle_hits"] >= 1);
+	var_dump($stats["connections_created"] + $stats["connections_reused"] >= 3);
+	var_dump(is_float($stats["handle_reuse"]));
+	var_dump(isset($stats["pool_used"], $stats["pool_idle"]));
+});
+?>
+Done
+--EXPECT--
+Test
+array(0) {
+}
+bool(true)
+int(3)
+int(3)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+Done
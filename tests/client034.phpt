@@ -0,0 +1,102 @@
+--TEST--
+client latency histograms
+--SKIPIF--
+<?php
+include "skipif.inc";
+skip_client_test();
+?>
+--FILE--
+<?php
+
+include "helper/server.inc";
+
+echo "Test\n";
+
+server("proxy.inc", function($port) {
+	$client = new http\Client;
+	var_dump($client->getLatencyStats());
+
+	$client->configure(array("latency_histograms" => true, "latency_by_host" => true, "pool_stats" => true));
+	for ($i = 0; $i < 5; ++$i) {
+		$client->enqueue(new http\Client\Request("GET", "http://localhost:$port/$i"));
+	}
+	$client->send();
+
+	$stats = $client->getLatencyStats();
+	var_dump(array_keys($stats));
+	var_dump(array_keys($stats["total"]));
+	var_dump($stats["total"]["count"]);
+	var_dump($stats["appconnect"]["count"]);
+	var_dump($stats["total"]["min"] <= $stats["total"]["p50"]);
+	var_dump($stats["total"]["p50"] <= $stats["total"]["p99.9"]);
+	var_dump($stats["total"]["p99.9"] <= $stats["total"]["max"]);
+
+	$stats = $client->getLatencyStats(array(25, 100), "localhost:$port");
+	var_dump(array_keys($stats["starttransfer"]));
+	var_dump($stats["starttransfer"]["count"]);
+	var_dump($stats["starttransfer"]["p100"] == $stats["starttransfer"]["max"]);
+
+	var_dump($client->getLatencyStats(null, "nowhere:80"));
+});
+?>
+Done
+--EXPECT--
+Test
+array(0) {
+}
+array(6) {
+  [0]=>
+  string(10) "namelookup"
+  [1]=>
+  string(7) "connect"
+  [2]=>
+  string(10) "appconnect"
+  [3]=>
+  string(11) "pretransfer"
+  [4]=>
+  string(13) "starttransfer"
+  [5]=>
+  string(5) "total"
+}
+array(8) {
+  [0]=>
+  string(5) "count"
+  [1]=>
+  string(3) "min"
+  [2]=>
+  string(3) "max"
+  [3]=>
+  string(4) "mean"
+  [4]=>
+  string(3) "p50"
+  [5]=>
+  string(3) "p90"
+  [6]=>
+  string(3) "p99"
+  [7]=>
+  string(5) "p99.9"
+}
+int(5)
+int(0)
+bool(true)
+bool(true)
+bool(true)
+array(6) {
+  [0]=>
+  string(5) "count"
+  [1]=>
+  string(3) "min"
+  [2]=>
+  string(3) "max"
+  [3]=>
+  string(4) "mean"
+  [4]=>
+  string(3) "p25"
+  [5]=>
+  string(3) "p100"
+}
+int(5)
+bool(true)
+array(0) {
+}
+Done
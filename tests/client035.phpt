@@ -0,0 +1,40 @@
+--TEST--
+client feed reset in callback
+--SKIPIF--
+<?php
+include "skipif.inc";
+skip_client_test();
+?>
+--FILE--
+<?php
+
+include "helper/server.inc";
+
+echo "Test\n";
+
+server("proxy.inc", function($port) {
+	$requests = array();
+	for ($i = 0; $i < 10; ++$i) {
+		$requests[] = new http\Client\Request("GET", "http://localhost:$port/$i");
+	}
+
+	$client = new http\Client;
+	$done = 0;
+
+	$client->feed($requests, 2, function($response) use ($client, &$done) {
+		if (++$done == 3) {
+			$client->reset();
+		}
+	});
+	$client->send();
+
+	var_dump($done);
+	var_dump(count($client));
+});
+?>
+Done
+--EXPECT--
+Test
+int(3)
+int(0)
+Done
@@ -0,0 +1,47 @@
+--TEST--
+client progress object kept through a reference
+--SKIPIF--
+<?php
+include "skipif.inc";
+skip_client_test();
+?>
+--FILE--
+<?php
+
+include "helper/server.inc";
+
+echo "Test\n";
+
+class KeepingObserver implements SplObserver
+{
+	public $kept = array();
+
+	function update(SplSubject $client, http\Client\Request $request = null, StdClass $progress = null) {
+		/* the reference separates the zval, but not the object */
+		$ref = &$progress;
+		$this->kept[] = $ref;
+	}
+}
+
+server("proxy.inc", function($port) {
+	$request = new http\Client\Request("GET", "http://localhost:$port/");
+	$observer = new KeepingObserver;
+	$client = new http\Client;
+	$client->attach($observer);
+	$client->enqueue($request)->send();
+
+	$hashes = array_map("spl_object_hash", $observer->kept);
+	var_dump(count($observer->kept) > 1);
+	var_dump(count(array_unique($hashes)) === count($hashes));
+	var_dump(end($observer->kept)->finished);
+	var_dump(reset($observer->kept)->finished);
+});
+?>
+Done
+--EXPECT--
+Test
+bool(true)
+bool(true)
+bool(true)
+bool(false)
+Done
@@ -0,0 +1,38 @@
+--TEST--
+client interim response headers
+--SKIPIF--
+<?php
+include "skipif.inc";
+skip_client_test();
+?>
+--FILE--
+<?php
+
+include "helper/server.inc";
+
+echo "Test\n";
+
+server("redirect.inc", function($port) {
+	$request = new http\Client\Request("GET", "http://localhost:$port/redirect");
+	$request->setOptions(array("redirect" => 1));
+
+	$client = new http\Client;
+	$client->enqueue($request)->send();
+	$response = $client->getResponse($request);
+	$interim = $response->getParentMessage();
+
+	var_dump($response->getResponseCode(), (string) $response->getBody());
+	var_dump($response->getHeader("X-Original-Content-Length"));
+	var_dump($interim->getResponseCode());
+	var_dump($interim->getHeader("X-Original-Content-Length"));
+});
+?>
+Done
+--EXPECT--
+Test
+int(200)
+string(5) "final"
+string(1) "5"
+int(302)
+string(1) "5"
+Done
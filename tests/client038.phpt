@@ -0,0 +1,62 @@
+--TEST--
+client progress info phases
+--SKIPIF--
+<?php
+include "skipif.inc";
+skip_client_test();
+?>
+--FILE--
+<?php
+
+include "helper/server.inc";
+
+echo "Test\n";
+
+class PhaseObserver implements SplObserver
+{
+	public $phases = array();
+
+	function update(SplSubject $client, http\Client\Request $request = null, StdClass $progress = null) {
+		if (end($this->phases) !== $progress->info) {
+			$this->phases[] = $progress->info;
+		}
+	}
+}
+
+server("redirect.inc", function($port) {
+	$request = new http\Client\Request("GET", "http://localhost:$port/redirect");
+	$request->setOptions(array("redirect" => 1));
+
+	$observer = new PhaseObserver;
+	$client = new http\Client;
+	$client->attach($observer);
+	$client->enqueue($request)->send();
+
+	$phases = $observer->phases;
+	var_dump(array_slice($phases, 0, 2));
+	var_dump(in_array("redirect", $phases));
+	var_dump(in_array($phases[count($phases) - 2], array("disconnected", "not disconnected")));
+	var_dump(end($phases));
+
+	/* nobody listens anymore */
+	$client->detach($observer);
+	$observer->phases = array();
+	$client->requeue($request)->send();
+	var_dump($observer->phases);
+});
+?>
+Done
+--EXPECT--
+Test
+array(2) {
+  [0]=>
+  string(5) "setup"
+  [1]=>
+  string(5) "start"
+}
+bool(true)
+bool(true)
+string(8) "finished"
+array(0) {
+}
+Done
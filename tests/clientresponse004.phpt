@@ -0,0 +1,59 @@
+--TEST--
+client response lazy transfer info
+--SKIPIF--
+<?php
+include "skipif.inc";
+skip_client_test();
+?>
+--FILE--
+<?php
+
+include "helper/server.inc";
+
+echo "Test\n";
+
+class Response extends http\Client\Response {
+	function info() {
+		return $this->transferInfo;
+	}
+	function hasInfo() {
+		return isset($this->transferInfo);
+	}
+}
+
+server("proxy.inc", function($port) {
+	$client = new http\Client;
+	$client->enqueue($request1 = new http\Client\Request("GET", "http://localhost:$port/1"));
+	$client->enqueue($request2 = new http\Client\Request("GET", "http://localhost:$port/2"));
+	$client->send();
+
+	$response = $client->getResponse($request1);
+	$info = (array) $response->getTransferInfo();
+	var_dump($info["response_code"]);
+	var_dump($info["effective_url"] === "http://localhost:$port/1");
+
+	$clone = clone $client->getResponse($request2);
+	var_dump($clone->getTransferInfo("effective_url") === "http://localhost:$port/2");
+
+	$dump = print_r($clone, true);
+	var_dump(false !== strpos($dump, "[transferInfo:protected] => stdClass Object"));
+
+	$response = new Response;
+	var_dump($response->hasInfo());
+	try {
+		$response->getTransferInfo();
+	} catch (http\Exception\BadMethodCallException $e) {
+		echo $e->getMessage(), "\n";
+	}
+});
+?>
+Done
+--EXPECT--
+Test
+int(200)
+bool(true)
+bool(true)
+bool(true)
+bool(false)
+Incomplete state
+Done
@@ -0,0 +1,39 @@
+--TEST--
+dechunk stream with split size lines
+--SKIPIF--
+<?php
+include "skipif.inc";
+?>
+--FILE--
+<?php
+echo "Test\n";
+
+$file = file(__FILE__);
+$cenc = array_reduce(
+	$file,
+	function($data, $line) {
+		return $data . sprintf("%lx;ext=1\r\n%s\r\n", strlen($line), $line);
+	}
+) . "0\r\n";
+
+foreach (array(1, 2, 3, 7, 64) as $step) {
+	$dech = new http\Encoding\Stream\Dechunk;
+	$data = "";
+	foreach (str_split($cenc, $step) as $part) {
+		$data .= $dech->update($part);
+	}
+	printf("%d: %s %s\n", $step,
+		var_export($dech->done(), true),
+		var_export(implode("", $file) === $data, true));
+}
+
+?>
+DONE
+--EXPECT--
+Test
+1: true true
+2: true true
+3: true true
+7: true true
+64: true true
+DONE
@@ -0,0 +1,44 @@
+--TEST--
+encoding stream zlib reused states
+--SKIPIF--
+<?php
+include "skipif.inc";
+?>
+--FILE--
+<?php
+echo "Test\n";
+
+$file = file_get_contents(__FILE__);
+$types = array(
+	http\Encoding\Stream\Deflate::TYPE_GZIP,
+	http\Encoding\Stream\Deflate::TYPE_ZLIB,
+	http\Encoding\Stream\Deflate::TYPE_RAW,
+);
+
+for ($i = 0; $i < 20; ++$i) {
+	$flags = $types[$i % 3] | ($i % 10);
+
+	/* static, pooled states must come back reset */
+	if ($file !== http\Encoding\Stream\Inflate::decode(http\Encoding\Stream\Deflate::encode($file, $flags))) {
+		printf("static round %d failed\n", $i);
+	}
+
+	/* streams, larger than a single output buffer */
+	$defl = new http\Encoding\Stream\Deflate($flags);
+	$infl = new http\Encoding\Stream\Inflate;
+	$data = "";
+	foreach (str_split(str_repeat($file, 20), 0x3000) as $chunk) {
+		$data .= $infl->update($defl->update($chunk));
+	}
+	$data .= $infl->update($defl->finish());
+	$data .= $infl->finish();
+	if ($data !== str_repeat($file, 20)) {
+		printf("stream round %d failed\n", $i);
+	}
+}
+
+?>
+DONE
+--EXPECT--
+Test
+DONE
@@ -0,0 +1,26 @@
+--TEST--
+encoding stream available codecs
+--SKIPIF--
+<?php
+include "skipif.inc";
+?>
+--FILE--
+<?php
+
+echo "Test\n";
+
+$codecs = http\Encoding\Stream::getAvailableCodecs();
+var_dump(is_array($codecs));
+foreach (array("gzip", "x-gzip", "deflate") as $codec) {
+	var_dump(in_array($codec, $codecs, true));
+}
+
+?>
+DONE
+--EXPECT--
+Test
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+DONE
@@ -0,0 +1,50 @@
+--TEST--
+encoding stream parallel deflate
+--SKIPIF--
+<?php
+include "skipif.inc";
+?>
+--INI--
+http.encoding.deflate_threads=4
+--FILE--
+<?php
+echo "Test\n";
+
+$data = "";
+for ($i = 0; strlen($data) < 0x100000; ++$i) {
+	$data .= md5($i) . str_repeat(" lorem ipsum", $i % 7) . "\n";
+}
+$types = array(
+	http\Encoding\Stream\Deflate::TYPE_GZIP,
+	http\Encoding\Stream\Deflate::TYPE_ZLIB,
+	http\Encoding\Stream\Deflate::TYPE_RAW,
+);
+
+foreach ($types as $type) {
+	$flags = $type | http\Encoding\Stream\Deflate::PARALLEL;
+
+	if ($data !== http\Encoding\Stream\Inflate::decode(http\Encoding\Stream\Deflate::encode($data, $flags))) {
+		printf("static %x failed\n", $type);
+	}
+
+	$defl = new http\Encoding\Stream\Deflate($flags);
+	$infl = new http\Encoding\Stream\Inflate;
+	$back = "";
+	foreach (str_split($data, 0x9000) as $i => $chunk) {
+		$back .= $infl->update($defl->update($chunk));
+		if ($i == 7) {
+			$back .= $infl->update($defl->flush());
+		}
+	}
+	$back .= $infl->update($defl->finish());
+	$back .= $infl->finish();
+	if ($data !== $back) {
+		printf("stream %x failed\n", $type);
+	}
+}
+
+?>
+DONE
+--EXPECT--
+Test
+DONE
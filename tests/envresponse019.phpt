@@ -0,0 +1,34 @@
+--TEST--
+env response brotli
+--SKIPIF--
+<?php
+include "skipif.inc";
+skip_codec_test("br");
+?>
+--GET--
+dummy=1
+--FILE--
+<?php
+
+$req = new http\Env\Request;
+$req->setHeader("Accept-Encoding", "br, gzip");
+
+$res = new http\Env\Response;
+$res->setContentEncoding(http\Env\Response::CONTENT_ENCODING_GZIP);
+$res->getBody()->append(str_repeat("foobar\n", 100));
+$res->setEnvRequest($req);
+
+$out = fopen("php://memory", "w+");
+$res->send($out);
+rewind($out);
+
+$msg = new http\Message(stream_get_contents($out));
+var_dump($msg->getHeader("X-Original-Content-Encoding"));
+var_dump(str_repeat("foobar\n", 100) === (string) $msg->getBody());
+
+?>
+DONE
+--EXPECT--
+string(2) "br"
+bool(true)
+DONE
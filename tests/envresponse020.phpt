@@ -0,0 +1,56 @@
+--TEST--
+env response encoding cache
+--SKIPIF--
+<?php
+include "skipif.inc";
+?>
+--INI--
+http.encoding.cache_size=65536
+--GET--
+dummy=1
+--FILE--
+<?php
+
+echo "Test\n";
+
+function send($etag, $data) {
+	$req = new http\Env\Request;
+	$req->setHeader("Accept-Encoding", "gzip");
+
+	$res = new http\Env\Response;
+	$res->setEnvRequest($req);
+	$res->setEtag($etag);
+	$res->setContentEncoding(http\Env\Response::CONTENT_ENCODING_GZIP);
+	$res->getBody()->append($data);
+
+	$out = fopen("php://memory", "w+");
+	$res->send($out);
+	rewind($out);
+
+	$msg = new http\Message(stream_get_contents($out));
+	printf("%s %s %s\n",
+		$msg->getHeader("X-Original-Content-Length") ? "length" : "chunked",
+		$msg->getHeader("X-Original-Content-Encoding"),
+		$data === (string) $msg->getBody() ? "ok" : "broken"
+	);
+}
+
+$foo = str_repeat("foobar\n", 100);
+$bar = str_repeat("barfoo\n", 100);
+
+send("abc", $foo);
+send("abc", $foo);
+/* same ETag, different bytes */
+send("abc", $bar);
+/* different ETag, same bytes */
+send("W/\"abc\"", $foo);
+
+?>
+DONE
+--EXPECT--
+Test
+chunked gzip ok
+length gzip ok
+chunked gzip ok
+length gzip ok
+DONE
@@ -0,0 +1,46 @@
+--TEST--
+header parser with large header blocks
+--SKIPIF--
+<?php
+include "skipif.inc";
+?>
+--FILE--
+<?php
+echo "Test\n";
+
+$block = "Content-Type: text/plain\n";
+for ($i = 0; $i < 500; ++$i) {
+	$block .= "Set-Cookie: c$i=" . str_repeat("x", $i % 50) . "; Path=/\n";
+	$block .= "X-Folded-$i: one\n two\n\tthree\n";
+}
+$block .= "\n";
+
+$parser = new http\Header\Parser;
+$whole = array();
+var_dump($parser->parse($block, http\Header\Parser::CLEANUP, $whole));
+
+foreach (array(1, 7, 4096) as $size) {
+	$parser = new http\Header\Parser;
+	$split = array();
+	foreach (str_split($block, $size) as $chunk) {
+		$state = $parser->parse($chunk, 0, $split);
+	}
+	var_dump($state, $split === $whole);
+}
+
+var_dump(count($whole), count($whole["Set-Cookie"]), $whole["X-Folded-499"]);
+?>
+===DONE===
+--EXPECT--
+Test
+int(5)
+int(5)
+bool(true)
+int(5)
+bool(true)
+int(5)
+bool(true)
+int(501)
+int(500)
+string(13) "one two three"
+===DONE===
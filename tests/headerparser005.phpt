@@ -0,0 +1,47 @@
+--TEST--
+header parser with long header names
+--SKIPIF--
+<?php
+include "skipif.inc";
+?>
+--INI--
+display_errors=1
+html_errors=0
+--FILE--
+<?php
+echo "Test\n";
+
+$name = "X-" . str_repeat("Abcdefghijklmnopqrstuvwxyz0123456789!#$%&'*+-.^_`|~", 3);
+$parser = new http\Header\Parser;
+var_dump($parser->parse("$name: value\r\n\r\n", http\Header\Parser::CLEANUP, $parsed));
+var_dump(count($parsed), current($parsed));
+
+foreach (array(5, 31, 32, 33, 64, 100) as $pos) {
+	$bad = substr_replace($name, "\x80", $pos, 1);
+	$parser = new http\Header\Parser;
+	$parsed = null;
+	ob_start();
+	$state = $parser->parse("$bad: value\r\n\r\n", http\Header\Parser::CLEANUP, $parsed);
+	$error = ob_get_clean();
+	var_dump($state, (bool) strpos($error, "at pos $pos of"));
+}
+?>
+===DONE===
+--EXPECT--
+Test
+int(5)
+int(1)
+string(5) "value"
+int(-1)
+bool(true)
+int(-1)
+bool(true)
+int(-1)
+bool(true)
+int(-1)
+bool(true)
+int(-1)
+bool(true)
+int(-1)
+bool(true)
+===DONE===
@@ -0,0 +1,60 @@
+--TEST--
+header parser with well-known header names
+--SKIPIF--
+<?php
+include "skipif.inc";
+?>
+--FILE--
+<?php
+echo "Test\n";
+
+$parser = new http\Header\Parser;
+$headers = array();
+$parser->parse(
+	"content-type: text/plain\r\n".
+	"CONTENT_LENGTH: 3\r\n".
+	"set-cookie: a=1\r\n".
+	"Set_Cookie: b=2\r\n".
+	"p3p: CP=\"NOI\"\r\n".
+	"X-Custom_Thing: foo\r\n".
+	"x-forwarded-for: 1.2.3.4\r\n".
+	"X-Forwarded-For: 5.6.7.8\r\n".
+	"\r\n",
+	http\Header\Parser::CLEANUP, $headers);
+var_dump($headers);
+
+$msg = new http\Message("GET / HTTP/1.1\r\nuser-agent: test\r\nx_requested_with: php\r\n\r\n");
+var_dump($msg->getHeader("User-Agent"), $msg->getHeader("USER_AGENT"), $msg->getHeader("x-requested-with"));
+
+?>
+Done
+--EXPECT--
+Test
+array(6) {
+  ["Content-Type"]=>
+  string(10) "text/plain"
+  ["Content-Length"]=>
+  string(1) "3"
+  ["Set-Cookie"]=>
+  array(2) {
+    [0]=>
+    string(3) "a=1"
+    [1]=>
+    string(3) "b=2"
+  }
+  ["P3P"]=>
+  string(8) "CP="NOI""
+  ["X-Custom-Thing"]=>
+  string(3) "foo"
+  ["X-Forwarded-For"]=>
+  array(2) {
+    [0]=>
+    string(7) "1.2.3.4"
+    [1]=>
+    string(7) "5.6.7.8"
+  }
+}
+string(4) "test"
+string(4) "test"
+string(3) "php"
+Done
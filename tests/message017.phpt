@@ -0,0 +1,56 @@
+--TEST--
+message header caches follow header changes
+--SKIPIF--
+<?php
+include "skipif.inc";
+?>
+--FILE--
+<?php
+echo "Test\n";
+
+$m = new http\Message;
+var_dump($m->isMultipart());
+
+$m->setHeader("Content-Type", "multipart/form-data; boundary=abc");
+var_dump($m->isMultipart($b), $b);
+
+$m->setHeader("Content-Type", "multipart/mixed; boundary=\"def\"");
+var_dump($m->isMultipart($b), $b);
+
+$m->setHeader("Content-Type", "text/plain");
+var_dump($m->isMultipart());
+
+$m->setHeaders(array("Content-Type" => array("multipart/mixed; boundary=ghi")));
+var_dump($m->isMultipart($b), $b);
+
+$m->setHeader("Content-Type", null);
+var_dump($m->isMultipart());
+
+$m = new http\Message("HTTP/1.1 200 OK\r\nContent-Length: 3\r\n\r\nfoo");
+$m->getBody()->append("bar");
+echo $m;
+echo $m;
+var_dump($m->getHeader("Content-Length"));
+
+?>
+Done
+--EXPECT--
+Test
+bool(false)
+bool(true)
+string(3) "abc"
+bool(true)
+string(3) "def"
+bool(false)
+bool(true)
+string(3) "ghi"
+bool(false)
+HTTP/1.1 200 OK
+Content-Length: 6
+X-Original-Content-Length: 3
+
+foobarHTTP/1.1 200 OK
+Content-Length: 6
+X-Original-Content-Length: 3
+
+foobarint(6)
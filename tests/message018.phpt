@@ -0,0 +1,44 @@
+--TEST--
+multipart split into body views
+--SKIPIF--
+<?php
+include "skipif.inc";
+?>
+--FILE--
+<?php
+echo "Test\n";
+
+function dump($s) {
+	var_dump(str_replace("\r\n", "|", $s));
+}
+
+$body = "preamble\r\n--b\r\n".
+	"Content-Type: text/plain\r\n\r\nfirst\r\n--b\r\n".
+	"Content-Type: text/html\r\n\r\n<p>second</p>\r\n--b--\r\nepilogue";
+$m = new http\Message("POST / HTTP/1.1\r\nContent-Type: multipart/form-data; boundary=b\r\nContent-Length: ".strlen($body)."\r\n\r\n$body");
+
+$last = $m->splitMultipartBody();
+$first = $last->getParentMessage();
+
+var_dump($first->getHeader("Content-Type"));
+dump($first->getBody()->toString());
+var_dump($last->getHeader("Content-Type"));
+dump($last->getBody()->toString());
+
+$first->getBody()->append("more");
+dump($first->getBody()->toString());
+dump($last->getBody()->toString());
+var_dump($body === $m->getBody()->toString());
+
+?>
+Done
+--EXPECT--
+Test
+string(10) "text/plain"
+string(6) "first|"
+string(9) "text/html"
+string(14) "<p>second</p>|"
+string(10) "first|more"
+string(14) "<p>second</p>|"
+bool(true)
+Done
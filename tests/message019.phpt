@@ -0,0 +1,50 @@
+--TEST--
+multipart split of large parts
+--SKIPIF--
+<?php
+include "skipif.inc";
+?>
+--FILE--
+<?php
+echo "Test\n";
+
+$parts = array(
+	str_repeat("a", 10),
+	str_repeat("0123456789abcdef", 0x50),     /* > 1K */
+	str_repeat("fedcba9876543210", 0x1100),   /* > 64K */
+	str_repeat("x", 0x10000 - 40),            /* headers and body straddle the window */
+);
+
+$body = "";
+foreach ($parts as $i => $data) {
+	$body .= "--b\r\nContent-Type: text/plain\r\nX-Part: $i\r\n\r\n$data\r\n";
+}
+$body .= "--b--\r\n";
+
+$m = new http\Message("POST / HTTP/1.1\r\nContent-Type: multipart/form-data; boundary=b\r\nContent-Length: ".strlen($body)."\r\n\r\n$body");
+
+$split = array();
+for ($part = $m->splitMultipartBody(); $part; $part = $part->getParentMessage()) {
+	array_unshift($split, $part);
+}
+
+var_dump(count($split));
+foreach ($split as $i => $part) {
+	var_dump($part->getHeader("X-Part") == $i);
+	var_dump($part->getBody()->toString() === $parts[$i]."\r\n");
+}
+
+?>
+Done
+--EXPECT--
+Test
+int(4)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+Done
@@ -0,0 +1,35 @@
+--TEST--
+multipart split of parts with a content length
+--SKIPIF--
+<?php
+include "skipif.inc";
+?>
+--FILE--
+<?php
+echo "Test\n";
+
+$body =
+	"--b\r\nContent-Type: text/plain\r\nContent-Length: 5\r\n\r\nhello\r\n".
+	"--b\r\nContent-Type: text/plain\r\n\r\nworld\r\n".
+	"--b--\r\n";
+
+$m = new http\Message("POST / HTTP/1.1\r\nContent-Type: multipart/form-data; boundary=b\r\nContent-Length: ".strlen($body)."\r\n\r\n$body");
+
+$split = array();
+for ($part = $m->splitMultipartBody(); $part; $part = $part->getParentMessage()) {
+	array_unshift($split, $part);
+}
+
+var_dump(count($split));
+foreach ($split as $part) {
+	var_dump(addcslashes($part->getBody()->toString(), "\r\n"));
+}
+
+?>
+Done
+--EXPECT--
+Test
+int(2)
+string(5) "hello"
+string(9) "world\r\n"
+Done
@@ -0,0 +1,48 @@
+--TEST--
+message parser with callbacks
+--SKIPIF--
+<?php
+include "skipif.inc";
+?>
+--FILE--
+<?php
+echo "Test\n";
+
+$data =
+	"POST /a HTTP/1.1\r\nHost: localhost\r\nContent-Length: 5\r\n\r\nhello".
+	"GET /b HTTP/1.1\r\nHost: localhost\r\n\r\n".
+	"PUT /c HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n0\r\n\r\n";
+
+$body = "";
+$parser = new http\Message\Parser;
+$parser->setCallbacks(
+	function($message) {
+		printf("headers %s %s\n", $message->getRequestMethod(), $message->getRequestUrl());
+	},
+	function($chunk) use(&$body) {
+		$body .= $chunk;
+	},
+	function($message) use(&$body) {
+		printf("message %s %s %s %d\n", $message->getRequestMethod(), $message->getRequestUrl(), var_export($body, true), $message->getBody()->stat("size"));
+		$body = "";
+	}
+);
+
+foreach (str_split($data, 7) as $slice) {
+	if (http\Message\Parser::STATE_FAILURE === $parser->feed($slice, http\Message\Parser::GREEDY)) {
+		echo "FAILURE\n";
+	}
+}
+$parser->feed("", http\Message\Parser::GREEDY | http\Message\Parser::CLEANUP);
+
+?>
+Done
+--EXPECT--
+Test
+headers POST /a
+message POST /a 'hello' 0
+headers GET /b
+message GET /b '' 0
+headers PUT /c
+message PUT /c 'abc' 0
+Done
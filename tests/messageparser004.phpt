@@ -0,0 +1,52 @@
+--TEST--
+message parser batch parsing
+--SKIPIF--
+<?php
+include "skipif.inc";
+?>
+--FILE--
+<?php
+echo "Test\n";
+
+$data = "";
+for ($i = 0; $i < 1000; ++$i) {
+	$body = str_repeat("$i", $i % 30);
+	$data .= "POST /$i HTTP/1.1\r\nHost: localhost\r\nContent-Length: ".strlen($body)."\r\n\r\n$body";
+}
+$data .= "GET /last HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+function check(array $messages) {
+	printf("%d messages\n", count($messages));
+	foreach ($messages as $i => $message) {
+		if ($i == 1000) {
+			break;
+		}
+		if ($message->getRequestUrl() !== "/$i"
+		||	(string) $message->getBody() !== str_repeat("$i", $i % 30)
+		||	count($message) !== 1) {
+			printf("mismatch at %d\n", $i);
+		}
+	}
+	printf("%s %s\n", $message->getRequestMethod(), $message->getRequestUrl());
+}
+
+check(http\Message\Parser::parseAll($data));
+
+$stream = fopen("php://memory", "w+");
+fwrite($stream, $data);
+rewind($stream);
+check(http\Message\Parser::parseAll($stream));
+
+var_dump(http\Message\Parser::parseAll(""));
+
+?>
+Done
+--EXPECT--
+Test
+1001 messages
+GET /last
+1001 messages
+GET /last
+array(0) {
+}
+Done
@@ -0,0 +1,47 @@
+--TEST--
+message parser streaming bodies to a sink
+--SKIPIF--
+<?php
+include "skipif.inc";
+?>
+--FILE--
+<?php
+echo "Test\n";
+
+$body = "";
+$data = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+for ($i = 0; $i < 100; ++$i) {
+	$chunk = str_repeat(chr(ord("a") + $i % 26), 1000 + $i);
+	$body .= $chunk;
+	$data .= dechex(strlen($chunk)) . "\r\n$chunk\r\n";
+}
+$data .= "0\r\n\r\n";
+
+$input = fopen("php://temp", "w+");
+fwrite($input, $data);
+rewind($input);
+
+$sink = fopen("php://temp", "w+");
+$parser = new http\Message\Parser;
+$parser->setCallbacks(function($message) use($sink) {
+	printf("headers %d, sink at %d\n", $message->getResponseCode(), ftell($sink));
+});
+$parser->setBodySink($sink);
+
+var_dump(http\Message\Parser::STATE_DONE === $parser->stream($input, 0, $message));
+
+rewind($sink);
+var_dump(stream_get_contents($sink) === $body);
+var_dump($message->getBody()->stat("size"));
+var_dump($message->getHeader("X-Original-Transfer-Encoding"));
+
+?>
+Done
+--EXPECT--
+Test
+headers 200, sink at 0
+bool(true)
+bool(true)
+int(0)
+string(7) "chunked"
+Done
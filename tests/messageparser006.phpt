@@ -0,0 +1,48 @@
+--TEST--
+message parser limits
+--SKIPIF--
+<?php
+include "skipif.inc";
+?>
+--FILE--
+<?php
+echo "Test\n";
+
+function parse($message) {
+	try {
+		$m = new http\Message($message);
+		printf("%d headers, %d bytes\n", count($m->getHeaders()), strlen($m->getBody()));
+	} catch (http\Exception\BadMessageException $e) {
+		echo $e->getMessage(), "\n";
+	}
+}
+
+ini_set("http.parser.header_count", 3);
+parse("GET / HTTP/1.1\r\nA: a\r\nB: b\r\nC: c\r\n\r\n");
+parse("GET / HTTP/1.1\r\nA: a\r\nB: b\r\nC: c\r\nD: d\r\n\r\n");
+ini_set("http.parser.header_count", 0);
+
+ini_set("http.parser.header_bytes", 64);
+parse("GET / HTTP/1.1\r\nA: ".str_repeat("a", 32)."\r\n\r\n");
+parse("GET / HTTP/1.1\r\nA: ".str_repeat("a", 32)."\r\nB: ".str_repeat("b", 32)."\r\n\r\n");
+parse("GET / HTTP/1.1\r\nA: ".str_repeat("a", 128));
+ini_set("http.parser.header_bytes", 0);
+
+ini_set("http.parser.body_size", 10);
+parse("HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\n".str_repeat("x", 10));
+parse("HTTP/1.1 200 OK\r\nContent-Length: 100\r\n\r\n".str_repeat("x", 100));
+parse("HTTP/1.1 200 OK\r\n\r\n".str_repeat("x", 20));
+
+?>
+Done
+--EXPECTF--
+Test
+3 headers, 0 bytes
+%sFailed to parse headers: exceeded the limit of 3 headers
+1 headers, 0 bytes
+%sFailed to parse headers: exceeded the limit of 64 bytes
+%sFailed to parse headers: exceeded the limit of 64 bytes
+2 headers, 10 bytes
+%sFailed to parse message: body of 100 bytes exceeds the limit of 10 bytes
+%sFailed to parse message: body exceeded the limit of 10 bytes
+Done